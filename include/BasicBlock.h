@@ -9,6 +9,7 @@ class BasicBlock
     friend class Instruction;
     friend class ControlFlowGraph;
     friend class Function;
+    friend class FunctionBinary;
 
 public:
     using Vec = std::vector<BasicBlock*>;
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// runs _uNumVariants tasks for each of _uNumInputs inputs on work stealing workers (including the caller).
+// an input is admitted by an idle worker and prepared once, its variant tasks are then queued on that worker and stolen by the others.
+// at most _uMaxInFlight inputs are admitted but not retired, inputs are retired strictly in input order
+// after all their variants completed, which makes the retire callback see the same sequence as a serial run
+class BatchScheduler
+{
+public:
+    // _Prepare(uInput, uWorker) returns false to skip the variants of the input, it is retired nevertheless
+    using PrepareFunc = std::function<bool(uint32_t, uint32_t)>;
+    // _Process(uInput, uVariant, uWorker)
+    using ProcessFunc = std::function<void(uint32_t, uint32_t, uint32_t)>;
+    // _Retire(uInput) is called by one worker at a time
+    using RetireFunc = std::function<void(uint32_t)>;
+
+    BatchScheduler(const uint32_t _uWorkers = 1u, const uint32_t _uMaxInFlight = 1u);
+    ~BatchScheduler() {};
+
+    void Run(const uint32_t _uNumInputs, const uint32_t _uNumVariants, const PrepareFunc& _Prepare, const ProcessFunc& _Process, const RetireFunc& _Retire);
+
+private:
+    struct Task
+    {
+        uint32_t uInput;
+        uint32_t uVariant; // InvalidVariant for the prepare task
+    };
+
+    struct Queue
+    {
+        std::mutex Mutex;
+        std::deque<Task> Tasks; // the owner pops from the back, thieves from the front
+    };
+
+    static constexpr uint32_t InvalidVariant = ~0u;
+
+    void Work(const uint32_t _uWorker);
+
+    // own tasks first, then steal, then admit the next input
+    bool Acquire(const uint32_t _uWorker, Task& _Task);
+
+    void Push(const uint32_t _uWorker, const Task& _Task);
+
+    // the task of _uInput finished, retires all completed inputs at the front
+    void Complete(const uint32_t _uInput);
+
+private:
+    const uint32_t m_uWorkers;
+    const uint32_t m_uMaxInFlight;
+
+    std::vector<std::unique_ptr<Queue>> m_Queues; // one per worker
+
+    // state of the current Run
+    uint32_t m_uNumInputs = 0u;
+    uint32_t m_uNumVariants = 0u;
+    const PrepareFunc* m_pPrepare = nullptr;
+    const ProcessFunc* m_pProcess = nullptr;
+    const RetireFunc* m_pRetire = nullptr;
+
+    // admission, completion and sleeping workers
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    uint32_t m_uNextInput = 0u; // next input to admit
+    uint32_t m_uNextRetire = 0u; // next input to retire
+    uint32_t m_uQueued = 0u; // tasks in all queues
+    std::vector<uint32_t> m_Remaining; // open tasks per in flight input, indexed by input % m_uMaxInFlight
+    std::mutex m_RetireMutex; // serializes the retire callbacks
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LLVM bitstream container: little endian bit fields, nested blocks with 32 bit word lengths.
+// records are written unabbreviated, no abbreviations or blockinfo are defined
+class BitstreamWriter
+{
+public:
+    BitstreamWriter() {};
+    ~BitstreamWriter() {};
+
+    // _uBits <= 32
+    void Emit(const uint32_t _uValue, const uint32_t _uBits);
+    void EmitVBR(uint64_t _uValue, const uint32_t _uBits);
+
+    // pads with zeros to the next 32 bit word
+    void Align32();
+
+    void EnterBlock(const uint32_t _uBlockId, const uint32_t _uAbbrevWidth = 4u);
+    void ExitBlock();
+
+    // UNABBREV_RECORD: code, number of operands and operands as vbr6
+    void EmitRecord(const uint32_t _uCode, const std::vector<uint64_t>& _Operands);
+
+    // all blocks need to be closed
+    const std::vector<uint8_t>& GetBytes() const { return m_Bytes; }
+
+private:
+    void EmitWord(const uint32_t _uWord);
+
+private:
+    enum EAbbrevId : uint32_t
+    {
+        kAbbrevId_EndBlock = 0u,
+        kAbbrevId_EnterSubBlock = 1u,
+        kAbbrevId_UnabbrevRecord = 3u
+    };
+
+    struct Block
+    {
+        uint32_t uOuterAbbrevWidth;
+        size_t uLengthOffset; // byte offset of the length word
+    };
+
+    std::vector<uint8_t> m_Bytes;
+    std::vector<Block> m_Blocks;
+
+    uint64_t m_uCurrent = 0u; // bits not yet written to m_Bytes
+    uint32_t m_uCurrentBits = 0u;
+    uint32_t m_uAbbrevWidth = 2u;
+};
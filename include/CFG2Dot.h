@@ -2,6 +2,7 @@
 
 #include "ControlFlowGraph.h"
 #include "DotGraph.h"
+#include <ostream>
 
 class CFG2Dot
 {
@@ -33,4 +34,95 @@ public:
 
         return dot;
     }
+
+    // writes the same text as DotWriter::WriteToStream(Convert(...)) without building the DotGraph, the format is locked by tests/CFG2DotTest.cpp.
+    // nodes are written in order of their first appearance (source, then its successors), like DotGraph::AddNode creates them
+    static void WriteToStream(const ControlFlowGraph& _CFG, std::ostream& _OutStream, const std::string& _sName = {}, const bool _bIgnoreVirtual = true, const std::string& _sUniformAttribKey = "style", const std::string& _sUniformAttribValue = "dotted")
+    {
+        const size_t uNumBlocks = _CFG.GetNodes().size();
+
+        std::vector<InstrId> Order;
+        std::vector<bool> Added(uNumBlocks, false);
+        Order.reserve(uNumBlocks);
+
+        const auto AddNode = [&](const BasicBlock* pBB)
+        {
+            if (Added[pBB->GetIdentifier()] == false)
+            {
+                Added[pBB->GetIdentifier()] = true;
+                Order.push_back(pBB->GetIdentifier());
+            }
+        };
+
+        for (const BasicBlock& BB : _CFG)
+        {
+            if (_bIgnoreVirtual && BB.IsVirtual())
+                continue;
+
+            AddNode(&BB);
+            for (const BasicBlock* pSucc : BB.GetSuccesors())
+            {
+                AddNode(pSucc);
+            }
+        }
+
+        // flushed in chunks instead of one stream call per token
+        constexpr size_t uFlushSize = 1u << 14u;
+        std::string sBuffer;
+        sBuffer.reserve(uFlushSize + 256u);
+
+        const auto Flush = [&]()
+        {
+            _OutStream.write(sBuffer.data(), static_cast<std::streamsize>(sBuffer.size()));
+            sBuffer.clear();
+        };
+
+        sBuffer += "digraph ";
+        sBuffer += _sName;
+        sBuffer += " {\n";
+
+        for (const InstrId uId : Order)
+        {
+            const BasicBlock& BB = *_CFG.GetNode(uId);
+
+            // nodes only added as successors of a block have no edges of their own
+            const bool bSource = (_bIgnoreVirtual && BB.IsVirtual()) == false;
+
+            if (bSource == false || BB.GetSuccesors().empty())
+            {
+                sBuffer += '\t';
+                sBuffer += BB.GetName();
+                sBuffer += ";\n";
+            }
+            else
+            {
+                for (const BasicBlock* pSucc : BB.GetSuccesors())
+                {
+                    sBuffer += '\t';
+                    sBuffer += BB.GetName();
+                    sBuffer += " -> ";
+                    sBuffer += pSucc->GetName();
+
+                    if (BB.IsDivergent() == false)
+                    {
+                        sBuffer += " [";
+                        sBuffer += _sUniformAttribKey;
+                        sBuffer += '=';
+                        sBuffer += _sUniformAttribValue;
+                        sBuffer += ']';
+                    }
+
+                    sBuffer += ";\n";
+                }
+            }
+
+            if (sBuffer.size() >= uFlushSize)
+            {
+                Flush();
+            }
+        }
+
+        sBuffer += "}\n";
+        Flush();
+    }
 };
\ No newline at end of file
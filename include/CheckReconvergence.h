@@ -1,10 +1,28 @@
 #pragma once
 
-#include "DominatorTree.h"
+#include "Function.h"
+#include "PostDominators.h"
+#include <ostream>
+
+// divergent block whose immediate post dominator is neither of its successors
+struct ReconvergenceViolation
+{
+    const BasicBlock* pBlock = nullptr;
+    const BasicBlock* pTrue = nullptr;
+    const BasicBlock* pFalse = nullptr;
+    const BasicBlock* pIPDom = nullptr; // nullptr if pBlock does not reach the exit
+};
 
 class CheckReconvergence
 {
 public:
+    // a divergent block B is reconverging if one of its successors post dominates B and the other successor,
+    // which is the case iff the immediate post dominator of B is one of its successors.
+    // returns true if all divergent blocks of _Func are reconverging, violations are appended in block order
+    static bool Check(const Function& _Func, std::vector<ReconvergenceViolation>* _pViolations = nullptr);
+
+    // one line per violation: function, block, true successor, false successor, immediate post dominator ('-' if none)
+    static void WriteReport(const Function& _Func, const std::vector<ReconvergenceViolation>& _Violations, std::ostream& _Stream);
 
     // for debugging
     static bool IsReconverging(const Function& _Func, const bool _bDisplayAll = false);
@@ -12,70 +30,67 @@ public:
     template<class Container>
     static bool IsReconverging(const Container& _BasicBlocks);
 
-    static bool IsReconverging(const BasicBlock* _pBB, const DominatorTree& _PDT);
+    static bool IsReconverging(const BasicBlock* _pBB, const PostDominators& _PDom);
 };
 
-inline bool CheckReconvergence::IsReconverging(const Function& _Func, const bool _bDisplayAll)
+inline bool CheckReconvergence::Check(const Function& _Func, std::vector<ReconvergenceViolation>* _pViolations)
 {
-    DominatorTree PDT = _Func.GetPostDominatorTree();
+    const PostDominators PDom(_Func.GetExitBlock(), _Func.GetCFG().GetNodes().size());
     bool bFuncReconv = true;
 
     for (const BasicBlock& BB : _Func.GetCFG())
     {
-        if (BB.IsDivergent() /*&& BB.IsVirtual() == false*/)
+        if (IsReconverging(&BB, PDom) == false)
         {
+            bFuncReconv = false;
+
+            if (_pViolations == nullptr)
+                break;
+
             const Instruction* pTerminator = BB.GetTerminator();
-            HASSERT(pTerminator->Is(kInstruction_BranchCond), "Invalid branch instruction");
-
-            const BasicBlock* pTrueBlock = pTerminator->GetOperandBB(1u);
-            const BasicBlock* pFalseBlock = pTerminator->GetOperandBB(2u);
-
-            // one of the successors must post dominate block B and the remaining successor.
-            const bool bTrueDomBB = PDT.Dominates(pTrueBlock, &BB);
-            const bool bFalseDomBB = PDT.Dominates(pFalseBlock, &BB);
-
-            const bool bTrueDomFalse = /*bTrueDomBB && */ PDT.Dominates(pTrueBlock, pFalseBlock);
-            const bool bFalseDomTrue = /*bFalseDomBB && */ PDT.Dominates(pFalseBlock, pTrueBlock);
-
-            const bool bBBReconv = (bTrueDomBB && bTrueDomFalse) || (bFalseDomBB && bFalseDomTrue);
-
-            if (bBBReconv == false)
-            {
-                HLOG("%s not Reconverging:", WCSTR(BB.GetName()));
-                HLOG("\t[%s dom %s = %d && %s dom %s = %d]", WCSTR(pTrueBlock->GetName()), WCSTR(BB.GetName()), bTrueDomBB, WCSTR(pTrueBlock->GetName()), WCSTR(pFalseBlock->GetName()), bTrueDomFalse);
-                HLOG("\t[%s dom %s = %d && %s dom %s = %d]", WCSTR(pFalseBlock->GetName()), WCSTR(BB.GetName()), bFalseDomBB, WCSTR(pFalseBlock->GetName()), WCSTR(pTrueBlock->GetName()), bFalseDomTrue);
-                
-                bFuncReconv = false;
-                if (_bDisplayAll == false)
-                {
-                    return false;
-                }
-            }
-
-            //const bool bNot =
-            //    (!PDT.Dominates(pTrueBlock, &BB) || !PDT.Dominates(pTrueBlock, pFalseBlock)) &&
-            //    (!PDT.Dominates(pFalseBlock, &BB) || !PDT.Dominates(pFalseBlock, pTrueBlock));
-
-            //if (bNot)
-            //    return false;
+            _pViolations->push_back({ &BB, pTerminator->GetOperandBB(1u), pTerminator->GetOperandBB(2u), PDom.GetImmediate(&BB) });
         }
     }
+
     return bFuncReconv;
 }
 
-inline bool CheckReconvergence::IsReconverging(const BasicBlock* _pBB, const DominatorTree& _PDT)
+inline void CheckReconvergence::WriteReport(const Function& _Func, const std::vector<ReconvergenceViolation>& _Violations, std::ostream& _Stream)
+{
+    for (const ReconvergenceViolation& V : _Violations)
+    {
+        _Stream << _Func.GetName() << '\t' << V.pBlock->GetName() << '\t' << V.pTrue->GetName() << '\t' << V.pFalse->GetName() << '\t'
+            << (V.pIPDom != nullptr ? V.pIPDom->GetName() : std::string("-")) << '\n';
+    }
+}
+
+inline bool CheckReconvergence::IsReconverging(const Function& _Func, const bool _bDisplayAll)
+{
+    std::vector<ReconvergenceViolation> Violations;
+    const bool bFuncReconv = Check(_Func, &Violations);
+
+    for (const ReconvergenceViolation& V : Violations)
+    {
+        HLOGI("%s not Reconverging:", WCSTR(V.pBlock->GetName()));
+        HLOGI("\t[ipdom %s is neither %s nor %s]", V.pIPDom != nullptr ? WCSTR(V.pIPDom->GetName()) : L"-", WCSTR(V.pTrue->GetName()), WCSTR(V.pFalse->GetName()));
+
+        if (_bDisplayAll == false)
+            break;
+    }
+
+    return bFuncReconv;
+}
+
+inline bool CheckReconvergence::IsReconverging(const BasicBlock* _pBB, const PostDominators& _PDom)
 {
     if (_pBB->IsDivergent())
     {
         const Instruction* pTerminator = _pBB->GetTerminator();
-        HASSERT(pTerminator->Is(kInstruction_BranchCond), "Invalid branch instruction");
+        HASSERT_SYNC(pTerminator->Is(kInstruction_BranchCond), "Invalid branch instruction");
 
-        const BasicBlock* pTrueBlock = pTerminator->GetOperandBB(1u);
-        const BasicBlock* pFalseBlock = pTerminator->GetOperandBB(2u);
+        const BasicBlock* pIPDom = _PDom.GetImmediate(_pBB);
 
-        if ((!_PDT.Dominates(pTrueBlock, _pBB) || !_PDT.Dominates(pTrueBlock, pFalseBlock)) &&
-            (!_PDT.Dominates(pFalseBlock, _pBB) || !_PDT.Dominates(pFalseBlock, pTrueBlock)))
-            return false;
+        return pIPDom != nullptr && (pIPDom == pTerminator->GetOperandBB(1u) || pIPDom == pTerminator->GetOperandBB(2u));
     }
 
     return true;
@@ -98,11 +113,12 @@ inline bool CheckReconvergence::IsReconverging(const Container& _BasicBlocks)
     if (pExit == nullptr)
         return false;
 
-    DominatorTree PDT(pExit, true);
+    // the post dominators are computed for all blocks of the function reaching the exit
+    const PostDominators PDom(pExit, pExit->GetCFG()->GetNodes().size());
 
     for (const BasicBlock* pBB : _BasicBlocks)
     {
-        if (IsReconverging(pBB, PDT) == false)
+        if (IsReconverging(pBB, PDom) == false)
         {
             return false;
         }
@@ -2,16 +2,19 @@
 
 #include "BasicBlock.h"
 #include <unordered_map>
+#include <deque>
 
 class ControlFlowGraph
 {
     friend class BasicBlock;
     friend class Function;
+    friend class FunctionBinary;
 
 public:
-    using Nodes = std::vector<BasicBlock>;
+    // deque keeps BasicBlock pointers stable when new nodes are added
+    using Nodes = std::deque<BasicBlock>;
 
-    ControlFlowGraph(Function* _pParent = nullptr, const size_t _uMaxNodes = 128u);
+    ControlFlowGraph(Function* _pParent = nullptr);
 
     ControlFlowGraph(ControlFlowGraph&& _Other) :
         m_Nodes(std::move(_Other.m_Nodes)),
@@ -42,6 +45,8 @@ public:
     TypeInfo ResolveType(const Instruction* _pType) const;
 
     Instruction* GetInstruction(const InstrId _uId) const { return _uId < m_Instructions.size() ? m_Instructions[_uId] : nullptr; };
+    // all instructions of the function in creation (identifier) order
+    const std::vector<Instruction*>& GetInstructions() const { return m_Instructions; }
 
     BasicBlock* FindNode(const std::string& _sName);
     const BasicBlock* FindNode(const std::string& _sName) const;
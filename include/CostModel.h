@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Function.h"
+#include <ostream>
+
+// relative cost of the code InstructionSetLLVMAMD emits for one feature, the score is the weighted sum of all counts
+struct CostWeights
+{
+    double fBlock = 1.0;
+    double fInstruction = 1.0;
+    double fPhi = 1.0; // phis of divergent values become v_cndmask / copies per predecessor
+    double fUniformBranch = 2.0; // s_cbranch on a scalar condition
+    double fDivergentBranch = 8.0; // exec mask save, mask and restore around both sides
+    double fFlowBlock = 4.0;
+    double fNesting = 4.0; // per saved exec mask live at the deepest point
+    double fLongestPath = 0.5;
+};
+
+struct CostEstimate
+{
+    uint32_t uBlocks = 0u; // non virtual blocks
+    uint32_t uFlowBlocks = 0u; // blocks inserted by the OpenTree
+    uint32_t uInstructions = 0u; // emitted instructions of non virtual blocks including phis and terminators
+    uint32_t uPhis = 0u;
+    uint32_t uBranches = 0u; // unconditional and conditional
+    uint32_t uUniformBranches = 0u; // conditional on a uniform block
+    uint32_t uDivergentBranches = 0u; // conditional on a divergent block
+
+    // maximum number of divergent regions (branch to its immediate post dominator) containing a block
+    uint32_t uMaxDivergentNesting = 0u;
+
+    // blocks on the shortest and the longest entry to exit path without back edges
+    uint32_t uShortestPath = 0u;
+    uint32_t uLongestPath = 0u;
+
+    double fScore = 0.0;
+};
+
+// static estimate of the cost of a function from its IR alone, the function does not need to be finalized.
+// counts do not depend on the block order, estimates of different orderings of the same input are comparable
+class CostModel
+{
+public:
+    CostModel() {};
+    ~CostModel() {};
+
+    static CostEstimate Estimate(const Function& _Function, const CostWeights& _Weights = {});
+
+    // single line summary for logging
+    static std::string Format(const CostEstimate& _Estimate);
+
+    // tab separated header and row: function, counts, score
+    static void WriteReportHeader(std::ostream& _OutStream);
+    static void WriteReport(const Function& _Function, const CostEstimate& _Estimate, std::ostream& _OutStream);
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// forward decls:
+class OpenTree;
+class RegionReconvergence;
+
+// long running server reusing its OTs for all requests. a request is a single line of command line options naming its input:
+//   <options> -in <dot file>
+//   <options> -dot <size>\n followed by <size> bytes of dot text
+// every graph of the input is reconverged with every selected ordering (DepthFirstDom by default),
+// -regions uses -j workers for the regions of a request, at most as many as the daemon was started with, -loglevel and -quiet only limit the messages of the request.
+// the process wide options -out, -cache, -inflight and -dump are ignored. the reply is
+//   ok <files> <tasks>\n
+//   stats <name> <ordering> <cost estimate>, <microseconds> us[, not reconverging | , failed]\n for every task, failed if the verification stopped the OT
+//   file <size> <name>\n followed by <size> bytes and \n for every written file
+// or error <message>\n. "quit", the end of the input or an error after which the input can not be read ends a session
+class Daemon
+{
+public:
+    static constexpr uint64_t uMaxInlineSize = 256ull << 20u; // bytes of dot text per request
+
+    // -regions requests use up to _uWorkers threads
+    Daemon(const uint32_t _uWorkers = 1u) : m_uWorkers(_uWorkers) {};
+    ~Daemon(); // the pooled OTs and regions are incomplete types here
+
+    // stdin and stdout need to be binary for inline dot text
+    int ServeStdin();
+
+    // every client is served on its own thread, the threads are joined before returning once accepting fails
+    int ServeSocket(const std::filesystem::path& _Path);
+
+private:
+    void Serve(std::istream& _In, std::ostream& _Out);
+
+    // false if the session can not continue
+    bool Handle(const std::string& _sRequest, std::istream& _In, std::ostream& _Out);
+
+    OpenTree* AcquireTree(const bool _bVerify);
+    void ReleaseTree(OpenTree* _pTree, const bool _bVerify);
+
+    RegionReconvergence* AcquireRegions(const bool _bVerify);
+    void ReleaseRegions(RegionReconvergence* _pRegions, const bool _bVerify);
+
+private:
+    const uint32_t m_uWorkers;
+    std::mutex m_Mutex;
+    std::vector<std::unique_ptr<OpenTree>> m_Trees; // one per concurrent session, reused by all requests
+    std::vector<OpenTree*> m_FreeTrees[2]; // by verification
+    std::vector<std::unique_ptr<RegionReconvergence>> m_Regions; // one per concurrent -regions session, all with m_uWorkers
+    std::vector<RegionReconvergence*> m_FreeRegions[2]; // by verification
+};
@@ -3,6 +3,8 @@
 #include "DotGraph.h"
 #include "Function.h"
 #include "InstructionSetLLVMAMD.h"
+#include <filesystem>
+#include <string_view>
 
 class Dot2CFG
 {
@@ -11,6 +13,16 @@ public:
     ~Dot2CFG() {};
 
     static Function Convert(const DotGraph& _Graph, const std::string& _sUniformAttribKey = "style", const std::string& _sUniformAttribValue = "dotted");
+
+    // single pass over the dot source without building a DotGraph, names are only copied into the blocks.
+    // blocks, parameters and instructions are created in the same order as from the parsed DotGraph
+    static Function Convert(const std::string_view _sSource, const std::string& _sUniformAttribKey = "style", const std::string& _sUniformAttribValue = "dotted");
+
+    // source views of the graphs of a file with several digraph blocks, each can be passed to Convert
+    static std::vector<std::string_view> SplitGraphs(const std::string_view _sSource);
+
+    // maps the file and converts its first graph in place, the function is empty if the file can not be read or parsed
+    static Function ConvertFile(const std::filesystem::path& _DotFile, const std::string& _sUniformAttribKey = "style", const std::string& _sUniformAttribValue = "dotted");
 };
 
 inline Function Dot2CFG::Convert(const DotGraph& _Graph, const std::string& _sUniformAttribKey, const std::string& _sUniformAttribValue)
@@ -48,7 +60,7 @@ inline Function Dot2CFG::Convert(const DotGraph& _Graph, const std::string& _sUn
         }
         else if(uSuccessors > 2u)
         {
-            HERROR("Too many successors for node %s", WCSTR(node.GetName()));
+            HLOGE("Too many successors for node %s", WCSTR(node.GetName()));
             return {};
         }
 
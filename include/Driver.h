@@ -0,0 +1,125 @@
+#pragma once
+
+#include "Function.h"
+#include "NodeOrdering.h"
+#include "WaveSimulator.h"
+#include "ResultCache.h"
+#include "Reconvergence.h"
+#include "LogLevel.h"
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// forward decls:
+class OpenTree;
+class RegionReconvergence;
+
+// by ordering index, the bit of the NodeOrdering::OrderType
+extern const std::wstring OrderNames[NodeOrdering::Order_NumOf];
+extern const std::string OrderSuffixes[NodeOrdering::Order_NumOf]; // output name suffix
+
+// files written by a task, kept in memory until its input is retired
+class TaskOutput
+{
+public:
+    std::ostream& Open(const std::filesystem::path& _Path, const std::ios::openmode _kMode = std::ios::out)
+    {
+        return m_Files.emplace_back(File{ _Path, _kMode }).Stream;
+    }
+
+    void Write()
+    {
+        for (File& F : m_Files)
+        {
+            std::ofstream out(F.Path, F.kMode);
+            if (out.is_open())
+            {
+                const std::string sData = F.Stream.str();
+                out.write(sData.data(), static_cast<std::streamsize>(sData.size()));
+                out.close();
+            }
+        }
+
+        m_Files.clear();
+    }
+
+    // names relative to the output directory
+    void Export(CachedResult& _Result) const
+    {
+        for (const File& F : m_Files)
+        {
+            _Result.Files.push_back({ F.Path.filename().string(), (F.kMode & std::ios::binary) != 0, F.Stream.str() });
+        }
+    }
+
+    void Import(const std::filesystem::path& _Dir, const CachedResult& _Result)
+    {
+        for (const CachedFile& F : _Result.Files)
+        {
+            Open(_Dir / F.sName, F.bBinary ? std::ios::out | std::ios::binary : std::ios::out) << F.sData;
+        }
+    }
+
+private:
+    struct File
+    {
+        File(const std::filesystem::path& _Path, const std::ios::openmode _kMode) : Path(_Path), kMode(_kMode) {}
+
+        std::filesystem::path Path;
+        std::ios::openmode kMode;
+        std::ostringstream Stream;
+    };
+
+    std::deque<File> m_Files; // streams are referenced while the task runs
+};
+
+struct DriverOptions
+{
+    uint32_t kOrder = NodeOrdering::Order_None;
+
+    std::filesystem::path InputPath;
+    std::filesystem::path OutputPath;
+    std::string sCustomOrder;
+
+    bool bReconv = false;
+    bool bVirtualFront = false;
+    bool bRegions = false;
+    bool bReport = false;
+    bool bVerify = false;
+    bool bBitcode = false;
+    bool bBinary = false;
+    bool bSPIRV = false;
+    bool bCost = false;
+    bool bSimulate = false;
+    SimulationOptions Simulation;
+    ELogLevel kLogLevel = kLogLevel_Verbose; // process wide for the CLI, limits only its own request in the daemon
+    uint32_t uWorkers = 1u;
+    uint32_t uMaxInFlight = 0u;
+    std::filesystem::path CachePath;
+    std::filesystem::path DumpPath; // OpenTree debug dumps, not written if empty
+    bool bCompare = false;
+    bool bDaemon = false; // serve requests from stdin
+    std::filesystem::path SocketPath; // serve requests from a Unix domain socket
+};
+
+// 0 if _sValue is not a number
+uint64_t ParseNumber(const std::string& _sValue);
+
+// command line options, also used for the requests of the daemon mode. nothing process wide is changed, see DriverOptions::kLogLevel
+void ParseArguments(const std::vector<std::string>& _Args, DriverOptions& _Options);
+
+// selected orderings in index order, a custom ordering needs its order string
+std::vector<uint32_t> GetOrderings(const DriverOptions& _Options);
+
+// copy of _Func in the binary format (see FunctionBinary), 8 byte aligned for the FunctionView
+bool StoreFunction(const Function& _Func, std::vector<uint64_t>& _Binary);
+
+// a new function from a copy written by StoreFunction
+Function LoadFunction(const std::vector<uint64_t>& _Binary);
+
+// _Func has a unique entry and exit point, see Reconvergence. the files of one ordering are written to _Output.
+// an output that is not reconverging is returned like any other, the caller decides whether that is an error
+ReconvergeStats dot2ll(Function& _Func, const std::string& _sInputName, const uint32_t _uOderIndex, const bool _bReconv, const std::filesystem::path& _sOutPath, const bool _bPutVirtualFront, const std::string& _sCustomOrder, OpenTree& _OT, RegionReconvergence* _pRegions, const bool _bReport, const bool _bBitcode, const bool _bBinary, const bool _bSPIRV, const bool _bCost, const SimulationOptions* _pSimulation, TaskOutput& _Output);
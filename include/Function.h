@@ -10,6 +10,8 @@ struct CallingConvention
 
 class Function
 {
+    friend class FunctionBinary;
+
 public:
     Function(const std::string& _sName = "func", const CallingConvention _CallConv = {});
 
@@ -22,6 +24,7 @@ public:
         m_Parameters(std::move(_Other.m_Parameters)),
         m_pReturnType(_Other.m_pReturnType),
         m_Types(std::move(_Other.m_Types)),
+        m_Constants(std::move(_Other.m_Constants)),
         m_CallConv(std::move(_Other.m_CallConv))
     {
         for (BasicBlock& BB : m_CFG)
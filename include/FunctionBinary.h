@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Function.h"
+#include <ostream>
+#include <string_view>
+
+// binary function format: a header followed by flat arrays, every array starts 8 byte aligned.
+// instructions are indexed by their identifier, edges and block instruction lists are stored as CSR (offsets + values).
+// types, constants and parameters are regular instructions of the virtual entry block.
+// the format is native little endian and only readable with the InstrId width it was written with
+namespace FunctionBinaryFormat
+{
+    static constexpr uint32_t uMagic = 0x464c3244u; // "D2LF"
+    static constexpr uint32_t uVersion = 1u;
+
+    enum EBlockFlag : uint32_t
+    {
+        kBlockFlag_Source = 1u << 0u,
+        kBlockFlag_Sink = 1u << 1u,
+        kBlockFlag_Divergent = 1u << 2u,
+        kBlockFlag_Virtual = 1u << 3u
+    };
+
+    enum ESection : uint32_t
+    {
+        kSection_Blocks = 0u, // BlockRecord[NumBlocks]
+        kSection_SuccessorOffsets, // uint32_t[NumBlocks + 1]
+        kSection_Successors, // InstrId[NumSuccessors]
+        kSection_PredecessorOffsets, // uint32_t[NumBlocks + 1]
+        kSection_Predecessors, // InstrId[NumPredecessors]
+        kSection_BlockInstructionOffsets, // uint32_t[NumBlocks + 1]
+        kSection_BlockInstructions, // InstrId[NumInstructions] in block order
+        kSection_Instructions, // InstructionRecord[NumInstructions] in identifier order
+        kSection_Operands, // OperandRecord[NumOperands]
+        kSection_Decorations, // uint64_t[NumDecorations]
+        kSection_Parameters, // InstrId[NumParameters]
+        kSection_Types, // Key[NumTypes] type hash -> instruction
+        kSection_Constants, // Key[NumConstants] constant hash -> instruction
+        kSection_Strings, // char[StringBytes], not null terminated
+        kSection_NumOf
+    };
+
+    struct String
+    {
+        uint32_t uOffset;
+        uint32_t uLength;
+    };
+
+    struct Header
+    {
+        uint32_t uMagic;
+        uint32_t uVersion;
+        uint32_t uIdBytes; // sizeof(InstrId)
+        uint32_t uCallingConvention;
+
+        String Name;
+        InstrId uReturnType; // InvalidId if not set
+        InstrId uUniqueSink; // InvalidId if not set
+
+        uint32_t uNumBlocks;
+        uint32_t uNumInstructions;
+        uint32_t uNumSuccessors;
+        uint32_t uNumPredecessors;
+        uint32_t uNumOperands;
+        uint32_t uNumDecorations;
+        uint32_t uNumParameters;
+        uint32_t uNumTypes;
+        uint32_t uNumConstants;
+        uint32_t uStringBytes;
+
+        uint64_t Sections[kSection_NumOf]; // byte offsets from the start of the header
+    };
+
+    struct BlockRecord
+    {
+        String Name;
+        uint32_t uFlags;
+        InstrId uTerminator; // InvalidId if the block has none
+    };
+
+    struct InstructionRecord
+    {
+        uint32_t kInstruction; // EInstruction
+        InstrId uBlock;
+        InstrId uResultTypeId;
+        String Alias;
+        uint32_t uFirstOperand;
+        uint32_t uNumOperands;
+        uint32_t uFirstDecoration;
+        uint32_t uNumDecorations;
+    };
+
+    struct OperandRecord
+    {
+        uint32_t kType; // EOperandType
+        InstrId uId;
+    };
+
+    // deduplication maps of the function, the hashes can not be recomputed from the instructions
+    struct Key
+    {
+        uint64_t uHash;
+        InstrId uId;
+    };
+} // FunctionBinaryFormat
+
+template <class T>
+struct ArrayView
+{
+    const T* pData = nullptr;
+    size_t uSize = 0u;
+
+    const T* begin() const { return pData; }
+    const T* end() const { return pData + uSize; }
+    size_t size() const { return uSize; }
+    bool empty() const { return uSize == 0u; }
+    const T& operator[](const size_t _uIndex) const { return pData[_uIndex]; }
+};
+
+// read-only view of a serialized function, the data is used in place (e.g. from a MappedFile) and needs to outlive the view.
+// the constructor validates the header and all section bounds, accessors do not check their arguments
+class FunctionView
+{
+public:
+    FunctionView(const void* _pData = nullptr, const size_t _uSize = 0u);
+    ~FunctionView() {};
+
+    bool IsValid() const { return m_pHeader != nullptr; }
+
+    std::string_view GetName() const { return GetString(m_pHeader->Name); }
+    uint32_t GetCallingConvention() const { return m_pHeader->uCallingConvention; }
+    InstrId GetReturnType() const { return m_pHeader->uReturnType; }
+    InstrId GetUniqueSink() const { return m_pHeader->uUniqueSink; }
+
+    uint32_t GetNumBlocks() const { return m_pHeader->uNumBlocks; }
+    const FunctionBinaryFormat::BlockRecord& GetBlock(const InstrId _uBlock) const { return m_pBlocks[_uBlock]; }
+    std::string_view GetBlockName(const InstrId _uBlock) const { return GetString(m_pBlocks[_uBlock].Name); }
+
+    ArrayView<InstrId> GetSuccessors(const InstrId _uBlock) const { return Range(m_pSuccessorOffsets, m_pSuccessors, _uBlock); }
+    ArrayView<InstrId> GetPredecessors(const InstrId _uBlock) const { return Range(m_pPredecessorOffsets, m_pPredecessors, _uBlock); }
+    ArrayView<InstrId> GetBlockInstructions(const InstrId _uBlock) const { return Range(m_pBlockInstructionOffsets, m_pBlockInstructions, _uBlock); }
+
+    uint32_t GetNumInstructions() const { return m_pHeader->uNumInstructions; }
+    const FunctionBinaryFormat::InstructionRecord& GetInstruction(const InstrId _uId) const { return m_pInstructions[_uId]; }
+    std::string_view GetAlias(const InstrId _uId) const { return GetString(m_pInstructions[_uId].Alias); }
+    ArrayView<FunctionBinaryFormat::OperandRecord> GetOperands(const InstrId _uId) const;
+    ArrayView<uint64_t> GetDecorations(const InstrId _uId) const;
+
+    ArrayView<InstrId> GetParameters() const { return { m_pParameters, m_pHeader->uNumParameters }; }
+    ArrayView<FunctionBinaryFormat::Key> GetTypes() const { return { m_pTypes, m_pHeader->uNumTypes }; }
+    ArrayView<FunctionBinaryFormat::Key> GetConstants() const { return { m_pConstants, m_pHeader->uNumConstants }; }
+
+private:
+    std::string_view GetString(const FunctionBinaryFormat::String& _String) const { return { m_pStrings + _String.uOffset, _String.uLength }; }
+
+    static ArrayView<InstrId> Range(const uint32_t* _pOffsets, const InstrId* _pValues, const InstrId _uBlock)
+    {
+        return { _pValues + _pOffsets[_uBlock], _pOffsets[_uBlock + 1u] - _pOffsets[_uBlock] };
+    }
+
+private:
+    const FunctionBinaryFormat::Header* m_pHeader = nullptr;
+    const FunctionBinaryFormat::BlockRecord* m_pBlocks = nullptr;
+    const uint32_t* m_pSuccessorOffsets = nullptr;
+    const InstrId* m_pSuccessors = nullptr;
+    const uint32_t* m_pPredecessorOffsets = nullptr;
+    const InstrId* m_pPredecessors = nullptr;
+    const uint32_t* m_pBlockInstructionOffsets = nullptr;
+    const InstrId* m_pBlockInstructions = nullptr;
+    const FunctionBinaryFormat::InstructionRecord* m_pInstructions = nullptr;
+    const FunctionBinaryFormat::OperandRecord* m_pOperands = nullptr;
+    const uint64_t* m_pDecorations = nullptr;
+    const InstrId* m_pParameters = nullptr;
+    const FunctionBinaryFormat::Key* m_pTypes = nullptr;
+    const FunctionBinaryFormat::Key* m_pConstants = nullptr;
+    const char* m_pStrings = nullptr;
+};
+
+class FunctionBinary
+{
+public:
+    FunctionBinary() {};
+    ~FunctionBinary() {};
+
+    static bool Write(const Function& _Function, std::ostream& _OutStream);
+
+    // mutable copy of a valid view with the same block and instruction identifiers
+    static Function Load(const FunctionView& _View);
+};
@@ -3,11 +3,13 @@
 #include "InstructionDefines.h"
 #include "hlx/include/Logger.h"
 #undef S
+#include "LogLevel.h"
 
 class Instruction
 {
     friend class BasicBlock;
     friend class Function;    
+    friend class FunctionBinary;
 
 public:
     Instruction(const InstrId _uIdentifier, BasicBlock* _pParent) :
@@ -83,5 +85,5 @@ private:
 };
 
 #ifndef CHECK_INSTR
-#define CHECK_INSTR if(kInstruction != kInstruction_Undefined) {HFATAL("Invalid instruction state"); return nullptr;}
+#define CHECK_INSTR if(kInstruction != kInstruction_Undefined) {HLOG_SYNC(HFATAL, "Invalid instruction state"); return nullptr;}
 #endif
\ No newline at end of file
@@ -20,6 +20,19 @@ public:
     bool SerializeInstruction(const Function& _Function, const Instruction& _Instruction, std::ostream& _OutStream) final;
     bool SerializeListing(const Function& _Function, std::ostream& _OutStream) final;
     bool SerializeBinary(const Function& _Function, std::ostream& _OutStream) final;
+
+    // append to _sOut instead of writing to a stream, the listing is written with a single write by the stream overload
+    bool SerializeInstruction(const Function& _Function, const Instruction& _Instruction, std::string& _sOut);
+    bool SerializeListing(const Function& _Function, std::string& _sOut);
+
 private:
+    // type id -> name, cached for the function of the current listing
+    const std::string& GetTypeName(const Function& _Function, const InstrId _uTypeId);
+    void AppendConstant(const Function& _Function, const Instruction& _Instruction, std::string& _sOut);
 
+private:
+    const Function* m_pTypeNameFunction = nullptr;
+    std::vector<std::string> m_TypeNames;
+    std::vector<bool> m_TypeNameResolved;
+    std::string m_Buffer; // reused between listings
 };
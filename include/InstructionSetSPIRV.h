@@ -0,0 +1,34 @@
+#pragma once
+
+#include "InstructionSet.h"
+
+// Vulkan SPIR-V 1.3 module with the Shader capability: the function becomes the void fragment entry point "main".
+// divergent parameters are flat Input variables, uniform parameters are members of a push constant block and
+// a return value is stored to an Output variable at location 0.
+// selection and loop merges are derived from the reconverged CFG, see SerializeBinary
+class InstructionSetSPIRV : public InstructionSet
+{
+public:
+    InstructionSetSPIRV() {};
+    ~InstructionSetSPIRV() {};
+
+    std::string ResolveTypeName(const TypeInfo& _Type) final;
+    std::string ResolveConstant(const Function& _Function, const Instruction& _Instruction) final;
+
+    // assembly of the SPIR-V instructions emitted for _Instruction, false if there are none
+    bool SerializeInstruction(const Function& _Function, const Instruction& _Instruction, std::ostream& _OutStream) final;
+
+    // assembly of the whole module with numeric ids
+    bool SerializeListing(const Function& _Function, std::ostream& _OutStream) final;
+
+    // SPIR-V words in native byte order.
+    // a loop header is the target of a back edge, it continues at its back edge block and merges at its first post dominator outside the loop.
+    // conditional branches merge at their immediate post dominator unless they break out of or continue the innermost loop.
+    // headers sharing a merge block get their own merge block and back edges of a loop are joined in a new continue block,
+    // both on a copy of the function. nothing is written if a header still violates the structured control flow rules
+    // (irreducible loops, constructs entered past their header), tests/spirv_val.py runs spirv-val on the written modules
+    bool SerializeBinary(const Function& _Function, std::ostream& _OutStream) final;
+
+private:
+    std::string m_Buffer; // reused between listings
+};
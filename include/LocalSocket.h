@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <streambuf>
+
+// Unix domain stream sockets (AF_UNIX, also available since Windows 10 1803)
+using SocketHandle = intptr_t;
+static constexpr SocketHandle InvalidSocket = -1;
+
+// buffered stream over a connected socket, the socket is closed on destruction
+class SocketStream : public std::iostream
+{
+public:
+    SocketStream(const SocketHandle _hSocket);
+    ~SocketStream();
+
+    SocketStream(const SocketStream&) = delete;
+    SocketStream& operator=(const SocketStream&) = delete;
+
+private:
+    class Buffer : public std::streambuf
+    {
+    public:
+        Buffer(const SocketHandle _hSocket);
+
+    protected:
+        int_type underflow() final;
+        int_type overflow(int_type _Char) final;
+        int sync() final;
+
+    private:
+        bool Flush();
+
+    private:
+        SocketHandle m_hSocket;
+        char m_In[4096];
+        char m_Out[4096];
+    };
+
+    SocketHandle m_hSocket;
+    Buffer m_Buffer;
+};
+
+class LocalSocketServer
+{
+public:
+    LocalSocketServer() {};
+    ~LocalSocketServer() { Close(); }
+
+    LocalSocketServer(const LocalSocketServer&) = delete;
+    LocalSocketServer& operator=(const LocalSocketServer&) = delete;
+
+    // binds _Path (replacing a stale socket file) and listens, false on failure
+    bool Listen(const std::filesystem::path& _Path);
+
+    // blocks until a client connects, InvalidSocket if the server failed
+    SocketHandle Accept();
+
+    // also removes the socket file
+    void Close();
+
+private:
+    SocketHandle m_hSocket = InvalidSocket;
+    std::filesystem::path m_Path;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "hlx/include/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+enum ELogLevel : uint32_t
+{
+    kLogLevel_None = 0u,
+    kLogLevel_Error,
+    kLogLevel_Warning,
+    kLogLevel_Info,
+    kLogLevel_Verbose // per step tracing of the orderings and the open tree
+};
+
+// messages above the compile time level are removed entirely
+#ifndef DOT2LL_LOG_LEVEL
+#define DOT2LL_LOG_LEVEL kLogLevel_Verbose
+#endif
+
+class LogLevel
+{
+public:
+    static void Set(const ELogLevel _kLevel) { s_kLevel.store(_kLevel, std::memory_order_relaxed); }
+    static ELogLevel Get() { return s_kLevel.load(std::memory_order_relaxed); }
+
+    static bool IsEnabled(const ELogLevel _kLevel) { return _kLevel <= DOT2LL_LOG_LEVEL && _kLevel <= Get() && _kLevel <= s_kThreadLimit; }
+
+    // upper bound for the messages of the calling thread on top of the process wide level, see ScopedLogLimit
+    static ELogLevel GetThreadLimit() { return s_kThreadLimit; }
+    static void SetThreadLimit(const ELogLevel _kLimit) { s_kThreadLimit = _kLimit; }
+
+    // the hlx logger is a process wide singleton, functions processed on different threads take turns
+    static std::mutex& GetMutex() { return s_Mutex; }
+
+private:
+    static inline std::atomic<ELogLevel> s_kLevel{ kLogLevel_Verbose };
+    static inline std::mutex s_Mutex;
+    static inline thread_local ELogLevel s_kThreadLimit = kLogLevel_Verbose;
+};
+
+// lowers the thread limit until destruction, nested limits can not raise it
+class ScopedLogLimit
+{
+public:
+    ScopedLogLimit(const ELogLevel _kLimit) : m_kPrevious(LogLevel::GetThreadLimit()) { LogLevel::SetThreadLimit(std::min(_kLimit, m_kPrevious)); }
+    ~ScopedLogLimit() { LogLevel::SetThreadLimit(m_kPrevious); }
+
+    ScopedLogLimit(const ScopedLogLimit&) = delete;
+    ScopedLogLimit& operator=(const ScopedLogLimit&) = delete;
+
+private:
+    const ELogLevel m_kPrevious;
+};
+
+// writes one message with any of the hlx log macros while holding the log mutex
+#define HLOG_SYNC(_Macro, ...) do { const std::lock_guard<std::mutex> LogLock(LogLevel::GetMutex()); _Macro(__VA_ARGS__); } while (false)
+
+// the condition is evaluated without the log mutex, only a failed assertion is logged while holding it
+#define HASSERT_SYNC(_Cond, ...) do { if (!(_Cond)) { HLOG_SYNC(HFATAL, __VA_ARGS__); } } while (false)
+#ifdef _DEBUG
+#define HASSERTD_SYNC(_Cond, ...) HASSERT_SYNC(_Cond, __VA_ARGS__)
+#else
+#define HASSERTD_SYNC(_Cond, ...) do { } while (false)
+#endif
+
+// arguments are only evaluated if the level is enabled
+#define HLOG_LEVEL_MACRO(_kLevel, _Macro, ...) do { if (LogLevel::IsEnabled(_kLevel)) { HLOG_SYNC(_Macro, __VA_ARGS__); } } while (false)
+#define HLOG_LEVEL(_kLevel, ...) HLOG_LEVEL_MACRO(_kLevel, HLOG, __VA_ARGS__)
+
+#define HLOGE(...) HLOG_LEVEL_MACRO(kLogLevel_Error, HERROR, __VA_ARGS__)
+#define HLOGW(...) HLOG_LEVEL_MACRO(kLogLevel_Warning, HWARNING, __VA_ARGS__)
+#define HLOGI(...) HLOG_LEVEL(kLogLevel_Info, __VA_ARGS__)
+#define HLOGV(...) HLOG_LEVEL(kLogLevel_Verbose, __VA_ARGS__)
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+    MappedFile() {};
+    MappedFile(const std::filesystem::path& _Path) { Open(_Path); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& _Other) noexcept;
+    MappedFile& operator=(MappedFile&& _Other) noexcept;
+
+    // closes the current mapping, returns false if the file could not be mapped. empty files are not mapped
+    bool Open(const std::filesystem::path& _Path);
+    void Close();
+
+    bool IsOpen() const { return m_pData != nullptr; }
+
+    const uint8_t* GetData() const { return m_pData; }
+    size_t GetSize() const { return m_uSize; }
+
+private:
+    const uint8_t* m_pData = nullptr;
+    size_t m_uSize = 0u;
+
+#ifdef _WIN32
+    void* m_hFile = nullptr;
+    void* m_hMapping = nullptr;
+#endif
+};
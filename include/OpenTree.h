@@ -2,36 +2,131 @@
 
 #include "NodeOrdering.h"
 
-#include <unordered_map>
 #include <unordered_set>
+#include <deque>
 
 // forward delc
 class OpenTree;
 class Function;
+struct OpenTreeNode;
+
+// open edge Source -> Target, the same record is linked into the outgoing list of
+// the source and the incoming list of the target
+struct OpenEdge
+{
+    OpenTreeNode* pSource = nullptr;
+    OpenTreeNode* pTarget = nullptr;
+    Instruction* pCondition = nullptr; // condition under which to branch to pTarget
+
+    // cached node state, updated when a node is added to the OT
+    bool bSourceVisited = false;
+    bool bTargetVisited = false;
+    bool bSourceFlow = false;
+
+    // links of the outgoing [kEdgeList_Outgoing] and incoming [kEdgeList_Incoming] list
+    OpenEdge* pPrev[2] = {};
+    OpenEdge* pNext[2] = {};
+};
+
+enum EEdgeList : uint32_t
+{
+    kEdgeList_Outgoing = 0u,
+    kEdgeList_Incoming
+};
+
+// intrusive doubly linked list of edge records, insertion order is preserved
+template <EEdgeList kList>
+class OpenEdgeList
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(OpenEdge* _pEdge = nullptr) : m_pEdge(_pEdge) {}
+        OpenEdge* operator*() const { return m_pEdge; }
+        Iterator& operator++() { m_pEdge = m_pEdge->pNext[kList]; return *this; }
+        bool operator!=(const Iterator& _Other) const { return m_pEdge != _Other.m_pEdge; }
+    private:
+        OpenEdge* m_pEdge;
+    };
+
+    Iterator begin() const { return Iterator(m_pFirst); }
+    Iterator end() const { return Iterator(); }
+
+    bool empty() const { return m_pFirst == nullptr; }
+    uint32_t size() const { return m_uSize; }
+    OpenEdge* front() const { return m_pFirst; }
+
+    bool Contains(const OpenEdge* _pEdge) const { return _pEdge->pPrev[kList] != nullptr || m_pFirst == _pEdge; }
+
+    void PushBack(OpenEdge* _pEdge)
+    {
+        _pEdge->pPrev[kList] = m_pLast;
+        _pEdge->pNext[kList] = nullptr;
+        (m_pLast != nullptr ? m_pLast->pNext[kList] : m_pFirst) = _pEdge;
+        m_pLast = _pEdge;
+        ++m_uSize;
+    }
+
+    void Remove(OpenEdge* _pEdge)
+    {
+        (_pEdge->pPrev[kList] != nullptr ? _pEdge->pPrev[kList]->pNext[kList] : m_pFirst) = _pEdge->pNext[kList];
+        (_pEdge->pNext[kList] != nullptr ? _pEdge->pNext[kList]->pPrev[kList] : m_pLast) = _pEdge->pPrev[kList];
+        _pEdge->pPrev[kList] = nullptr;
+        _pEdge->pNext[kList] = nullptr;
+        --m_uSize;
+    }
+
+private:
+    OpenEdge* m_pFirst = nullptr;
+    OpenEdge* m_pLast = nullptr;
+    uint32_t m_uSize = 0u;
+};
 
 struct OpenTreeNode
 {
     OpenTreeNode(OpenTree* _pOT, BasicBlock* _pBB = nullptr);
 
+    // reinitializes a pooled node in place, keeping the capacity of its containers
+    void Reset(OpenTree* _pOT, BasicBlock* _pBB = nullptr);
+
     // is non-uniform (divergent) and one of the outgoing edges has already been closed
     bool Armed() const { return (pBB->GetTerminator() == nullptr ? pBB->GetDivergenceQualifier() : pBB->IsDivergent()) && uClosedOutgoing > 0u; }
     bool AncestorOf(const OpenTreeNode* _pSuccessor) const;
     OpenTreeNode* GetRoot();
 
-    // called on predecesssor to close Pred->Succ, returns true if the OT changed
-    void Close(OpenTreeNode* _Successor);
+    // called on predecesssor to close the open edge Pred->Succ, removes the node from the OT if all its edges are closed
+    void Close(OpenEdge* _pEdge = nullptr);
+
+    // marks the subtree aggregates of this node and its ancestors for recomputation
+    void Invalidate();
+    // recomputes the aggregates of all invalidated nodes in this subtree
+    void UpdateSubtree();
 
     std::string sName;
 
     std::vector<OpenTreeNode*> Children;
 
     uint32_t uClosedOutgoing = 0u;
+    uint32_t uDepth = 0u; // larger than the depth of the parent, set on attach. removing a closed node leaves gaps instead of relabeling its subtree
     OpenTree* pOT = nullptr;
     OpenTreeNode* pParent = nullptr;
     BasicBlock* pBB = nullptr;
     bool bVisited = false; // has been added to the OT
     bool bFlow = false; // is a flowblock
 
+    // aggregates over the open outgoing edges of this nodes subtree, kept up to date lazily:
+    // every change to the edges or the tree structure invalidates the path to the root
+    uint32_t uSubtreeOutgoing = 0u; // number of open outgoing edges
+    OpenTreeNode* pSubtreeTarget = nullptr; // unvisited target of the open edges if it is unique
+    bool bSubtreeMultipleTargets = false; // open edges lead to more than one unvisited target
+    bool bSubtreeDirty = true;
+
+    uint32_t uUnionMark = 0u; // root of the OpenSubTreeUnion with the same mark
+
+    uint32_t uFlowMark = 0u; // successor of the flow node with the same FlowSuccessors::uMark
+    uint32_t uFlowColumn = 0u; // column in the FlowSuccessors table
+
     struct Flow
     {
         OpenTreeNode* pTarget = nullptr;
@@ -44,52 +139,61 @@ struct OpenTreeNode
 #endif
 
     // open edges
-    std::vector<OpenTreeNode*> Incoming;
-    std::vector<Flow> Outgoing;
+    OpenEdgeList<kEdgeList_Incoming> Incoming;
+    OpenEdgeList<kEdgeList_Outgoing> Outgoing;
     std::vector<Flow> FinalOutgoing; // only for closed outgoing flow
 
     static void LogTree(OpenTreeNode* _pNode = nullptr, std::string _sTabs = "");
 };
 
+// dense predecessor x successor condition table of a flow node, the OT keeps one instance to reuse the buffers
 struct FlowSuccessors
 {
-    std::vector<OpenTreeNode*> Vec; // successors of the flow node
-
-    // from node OpenTreeNode* under condition  Instruction*
-    using From = std::unordered_map<OpenTreeNode*, Instruction*>;
-    
-    // Target -> from (under condition)
-    std::unordered_map<OpenTreeNode*, From> Conditions;
-
-    void Add(OpenTreeNode* _pSource, OpenTreeNode* _pTarget, Instruction* _pCondition);
+    std::vector<OpenTreeNode*> Vec; // successors of the flow node (columns)
+    std::vector<BasicBlock*> Origins; // predecessors of the flow node (rows)
+    std::vector<Instruction*> Conditions; // column major: Conditions[Column * uRows + Row]
+    std::vector<Instruction*> Values; // phi values of one successor
+
+    uint32_t uRows = 0u;
+    uint32_t uMark = 0u; // current flow node, see OpenTreeNode::uFlowMark
+    Instruction* pDefault = nullptr; // condition of predecessors without edge to the successor
+
+    void Reset(const uint32_t _uRows, Instruction* _pDefault);
+    // from predecessor _uRow to _pTarget under condition _pCondition
+    void Add(const uint32_t _uRow, OpenTreeNode* _pTarget, Instruction* _pCondition);
+    // phi values of all predecessors for the successor in _uColumn
+    const std::vector<Instruction*>& GetValues(const uint32_t _uColumn);
 };
 
+// union of the subtrees rooted at a set of nodes, the subtrees are not copied
+// but identified by marking their roots (only one union can be used at a time)
 class OpenSubTreeUnion
 {
 public:
-    OpenSubTreeUnion(const std::vector<OpenTreeNode*>& _Roots);
+    OpenSubTreeUnion(OpenTree& _OT, const std::vector<OpenTreeNode*>& _Roots);
 
-    struct OTNHash
-    {
-        size_t operator()(const OpenTreeNode* _pNode) const { return _pNode->pBB->GetIdentifier(); }
-    };
+    // roots which are not contained in the subtree of another root
+    const std::vector<OpenTreeNode*>& GetRoots() const { return m_Roots; }
 
-    const std::unordered_set<OpenTreeNode*, OTNHash>& GetNodes() const { return m_Nodes; }
-    const std::unordered_set<OpenTreeNode*>& GetRoots() const { return m_Roots; }
+    // nodes of the union which have open outgoing edges
+    const std::vector<OpenTreeNode*>& GetOutgoingNodes();
 
-    const bool HasOutgoingNotLeadingTo(BasicBlock* _pBB) const;
+    bool Contains(const OpenTreeNode* _pNode) const;
+
+    const bool HasOutgoingNotLeadingTo(const OpenTreeNode* _pNode) const;
     const bool HasMultiRootsOrOutgoing() const;
     const bool IsReconverging() const;
 
 private:
-    // order of nodes does not depend on memory address
-    std::unordered_set<OpenTreeNode*, OTNHash> m_Nodes;
-    std::unordered_set<OpenTreeNode*> m_Roots;
+    const uint32_t m_uMark;
+    std::vector<OpenTreeNode*>& m_Roots;
+    std::vector<OpenTreeNode*>& m_Nodes;
 };
 
 class OpenTree
 {
     friend struct OpenTreeNode;
+    friend class OpenSubTreeUnion;
     static bool Armed(const OpenTreeNode* pNode) { return pNode->Armed(); }
     static bool Visited(const OpenTreeNode* pNode) { return pNode->bVisited; }
     static bool Unvisited(const OpenTreeNode* pNode) { return pNode->bVisited == false; }
@@ -100,14 +204,23 @@ class OpenTree
     static bool True(const OpenTreeNode* pNode) { return true; }
 
 public:
-    OpenTree(const bool _bRemoveClosed = true, const std::string& _sDebugOutPath = "testoutput/") : 
-        m_sDebugOutputPath(_sDebugOutPath), m_bRemoveClosed(_bRemoveClosed) {};
+    // _bVerify checks the invariants of the nodes changed by each step and stops processing at the first violation.
+    // the OT and CFG of each step are only dumped to _sDebugOutPath if it is not empty
+    OpenTree(const bool _bRemoveClosed = true, const std::string& _sDebugOutPath = std::string(), const bool _bVerify = false) : 
+        m_bRemoveClosed(_bRemoveClosed), m_bVerify(_bVerify), m_sDebugOutputPath(_sDebugOutPath) {};
     ~OpenTree() {};
 
-    // returns true if flow was rerouted or virtual nodes were inserted
+    // returns true if flow was rerouted or virtual nodes were inserted, the OT can be reused for the next function
     bool Process(const NodeOrder& _Ordering);
 
+    // step of the last Process() call which violated an invariant, InvalidId if all steps passed or verification is disabled
+    uint32_t GetFailedStep() const { return m_uFailedStep; }
+
+    // releases the processed function, pooled nodes and edges keep their capacity
+    void Reset();
+
     void SerializeOTDotGraph(std::ostream& _Out) const;
+    // debug dumps are relative to the debug output path, nothing is written if it is empty
     void DumpOTDotToFile(const std::string& _sPath) const;
 
     void DumpCFGToFile(const std::string& _sPath);
@@ -115,35 +228,78 @@ public:
 private:
     OpenTreeNode* GetNode(BasicBlock* _pBB) const;
 
+    // allocates a node in the pool and registers it for _pBB
+    OpenTreeNode* NewNode(BasicBlock* _pBB);
+
+    // takes an unlinked edge record from the pool
+    OpenEdge* NewEdge(OpenTreeNode* _pSource, OpenTreeNode* _pTarget, Instruction* _pCondition);
+    // links a new edge record into the outgoing list of _pSource and the incoming list of _pTarget
+    OpenEdge* Connect(OpenTreeNode* _pSource, OpenTreeNode* _pTarget, Instruction* _pCondition);
+    // unlinks the edge from both lists and returns the record to the pool
+    void Disconnect(OpenEdge* _pEdge);
+
     void Initialize(const NodeOrder& _Ordering);
 
     void AddNode(OpenTreeNode* _pNode);
 
-    void Reroute(OpenSubTreeUnion& _Subtree);
+    // returns the new flow node
+    OpenTreeNode* Reroute(OpenSubTreeUnion& _Subtree);
 
     // return lowest ancestor of BB
-    OpenTreeNode* InterleavePathsTo(OpenTreeNode* _pNode);
+    OpenTreeNode* InterleavePathsTo(OpenTreeNode* _pNode, const std::vector<OpenEdge*>& _VisitedPreds);
 
-    OpenTreeNode* CommonAncestor(OpenTreeNode* _pNode) const;
+    // lowest strict ancestor of all visited predecessors
+    OpenTreeNode* CommonAncestor(const std::vector<OpenEdge*>& _VisitedPreds) const;
+
+    // checks the open edges, tree links and closed edge count of _pNode in O(degree), returns the violated invariant or nullptr
+    const char* VerifyNode(const OpenTreeNode* _pNode) const;
+    // verifies _Nodes and _Touched after step _uStep of processing _pBB, logs the first violation
+    bool Verify(const BasicBlock* _pBB, const uint32_t _uStep, std::initializer_list<const OpenTreeNode*> _Nodes, const std::vector<OpenTreeNode*>& _Touched = {});
+
+    // cached boolean constants of m_pFunction
+    Instruction* ConstantBool(const bool _bValue);
 
     template <class OutputContainer = std::vector<OpenTreeNode*>, class Container, class Filter, class Accessor> // Accessor extracts the OT node from the Container element, Filter processes the OT node and returns true or false
     OutputContainer FilterNodes(const Container& _Container, const Filter& _Filter, const Accessor& _Accessor) const;
 
-    void GetOutgoingFlow(std::vector<OpenTreeNode::Flow>& _OutFlow, OpenTreeNode* _pSource) const;
+    // opens the edges from _pSource to the unvisited targets of its terminator
+    void ConnectOutgoing(OpenTreeNode* _pSource, const bool _bLinkIncoming = true);
 
     // accessors for FilterNodes()
     OpenTreeNode* operator()(BasicBlock* _pBB) const { return GetNode(_pBB); }
     OpenTreeNode* operator()(OpenTreeNode* _pNode) const { return _pNode; }
-    OpenTreeNode* operator()(const OpenTreeNode::Flow& _Flow) const { return _Flow.pTarget; }
+    static OpenTreeNode* Source(const OpenEdge* _pEdge) { return _pEdge->pSource; }
+    static OpenTreeNode* Target(const OpenEdge* _pEdge) { return _pEdge->pTarget; }
 
 private:
     uint32_t m_uNumFlowBlocks = 0u;
-    std::vector<OpenTreeNode> m_Nodes;
+    std::deque<OpenTreeNode> m_Nodes; // node pool, nodes are never relocated
+    uint32_t m_uNumNodes = 0u; // nodes in use, the remaining ones are kept for reuse
     OpenTreeNode* m_pRoot = nullptr; // virtual root
-    std::unordered_map<BasicBlock*, OpenTreeNode*> m_BBToNode;
+    std::vector<uint32_t> m_BBToNode; // BasicBlock identifier -> index into m_Nodes
+    std::deque<OpenEdge> m_Edges; // edge pool
+    uint32_t m_uNumEdges = 0u; // edges taken from the pool
+    OpenEdge* m_pFreeEdges = nullptr; // closed edges, linked by pNext[kEdgeList_Outgoing]
     const bool m_bRemoveClosed;
+    const bool m_bVerify;
+    uint32_t m_uStep = 0u; // verified steps of the current function
+    uint32_t m_uFailedStep = InvalidId;
     std::string m_sDebugOutputPath;
     Function* m_pFunction = nullptr;
+
+    Instruction* m_pConstants[2] = {}; // false, true
+
+    // OpenSubTreeUnion state
+    uint32_t m_uUnionMark = 0u;
+    std::vector<OpenTreeNode*> m_UnionRoots;
+    std::vector<OpenTreeNode*> m_UnionNodes;
+
+    // scratch buffers, reused between steps
+    FlowSuccessors m_FlowSuccessors;
+    std::vector<OpenEdge*> m_VisitedPreds; // AddNode
+    std::vector<OpenTreeNode*> m_Branches, m_Leaves; // InterleavePathsTo
+    std::vector<OpenTreeNode*> m_NodeStack; // iterative walks of OpenTreeNode::UpdateSubtree and GatherOutgoing
+    std::vector<OpenTreeNode*> m_DirtyNodes; // OpenTreeNode::UpdateSubtree
 };
 
 template<class OutputContainer, class Container, class Filter, class Accessor>
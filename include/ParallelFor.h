@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// calls _Func(uIndex, uWorker) for all indices in [0, _uCount) using up to _uWorkers threads (including the caller).
+// indices are handed out in ascending order, _Func must only touch state owned by its index or its worker
+template <class Func>
+void ParallelFor(const uint32_t _uCount, const uint32_t _uWorkers, const Func& _Func)
+{
+    const uint32_t uWorkers = std::max(1u, std::min(_uWorkers, _uCount));
+
+    std::atomic<uint32_t> uNext{ 0u };
+    const auto Work = [&](const uint32_t _uWorker)
+    {
+        for (uint32_t i = uNext++; i < _uCount; i = uNext++)
+        {
+            _Func(i, _uWorker);
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    Threads.reserve(uWorkers - 1u);
+
+    for (uint32_t w = 1u; w < uWorkers; ++w)
+    {
+        Threads.emplace_back(Work, w);
+    }
+
+    Work(0u);
+
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "BasicBlock.h"
+
+// immediate post dominators of all blocks reaching the exit, indexed by block identifier.
+// Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm" on the reversed CFG
+class PostDominators
+{
+public:
+    // _uNumBlocks upper bound of the block identifiers
+    PostDominators(const BasicBlock* _pExit = nullptr, const size_t _uNumBlocks = 0u);
+    ~PostDominators() {};
+
+    // nullptr if _pBB is the exit or does not reach the exit
+    BasicBlock* GetImmediate(const BasicBlock* _pBB) const { return _pBB->GetIdentifier() < m_IPDom.size() ? m_IPDom[_pBB->GetIdentifier()] : nullptr; }
+
+private:
+    std::vector<BasicBlock*> m_IPDom;
+};
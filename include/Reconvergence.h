@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Function.h"
+#include "NodeOrdering.h"
+#include "LogLevel.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// forward decls:
+class OpenTree;
+class RegionReconvergence;
+
+// caller provided destinations of the serialized function, streams that are nullptr are not written
+struct ReconvergeSinks
+{
+    std::ostream* pDot = nullptr; // reconverged CFG, see CFG2Dot
+    std::ostream* pViolations = nullptr; // tsv report of the blocks that are not reconverging, see CheckReconvergence
+    std::ostream* pListing = nullptr; // LLVM AMDGPU .ll
+    std::ostream* pBitcode = nullptr; // LLVM AMDGPU .bc
+    std::ostream* pBinary = nullptr; // see FunctionBinary
+    std::ostream* pSPIRV = nullptr;
+    std::ostream* pSPIRVListing = nullptr;
+};
+
+struct ReconvergeOptions
+{
+    NodeOrdering::OrderType kOrder = NodeOrdering::Order_DepthFirstDom; // a single ordering
+    std::string sCustomOrder; // block names for Order_Custom
+    bool bPutVirtualFront = false; // see NodeOrdering::PrepareOrdering
+    bool bVerify = false; // only used for the OpenTree created by Run, see OpenTree
+    ELogLevel kLogLevel = kLogLevel_None; // messages logged by Run on the calling thread and the region workers, the process wide level still applies
+
+    ReconvergeSinks Sinks;
+};
+
+struct ReconvergeStats
+{
+    bool bValid = false; // false if the ordering is invalid or an OT step failed the verification, nothing was serialized
+    bool bInputReconverging = false;
+    bool bChanged = false; // flow was rerouted or virtual blocks were inserted
+    bool bReconverging = false; // the output is reconverging
+
+    // non virtual blocks
+    size_t uInputBlocks = 0u;
+    size_t uOutputBlocks = 0u;
+
+    std::vector<InstrId> BlockOrder; // input ordering
+};
+
+// in memory entry point of the reconvergence, nothing is read from or written to the filesystem.
+// the outputs are only written to the sinks and the OpenTrees created here do not write debug dumps.
+// nothing is logged unless ReconvergeOptions::kLogLevel allows it, failures are reported by ReconvergeStats
+class Reconvergence
+{
+public:
+    Reconvergence() {};
+    ~Reconvergence() {};
+
+    // _Func has a unique entry and exit point (see Function::EnforceUniqueEntryPoint) and is reconverged in place.
+    // uses _pRegions if set, otherwise _pOT or a temporary OpenTree. the OT is reset afterwards and can be reused
+    static ReconvergeStats Run(Function& _Func, const ReconvergeOptions& _Options, OpenTree* _pOT = nullptr, RegionReconvergence* _pRegions = nullptr);
+
+    // converts the first graph of the dot source (see Dot2CFG::Convert) and reconverges it, bValid is false if it can not be parsed
+    static ReconvergeStats Run(const std::string_view _sDot, const ReconvergeOptions& _Options, OpenTree* _pOT = nullptr, RegionReconvergence* _pRegions = nullptr);
+
+    // finalizes _Func and writes the listing, bitcode, binary and SPIR-V sinks. pDot and pViolations are ignored
+    static bool Serialize(Function& _Func, const ReconvergeSinks& _Sinks);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "OpenTree.h"
+#include "Function.h"
+#include <algorithm>
+
+// forward decls:
+class RegionTree;
+
+// reconverges the non-reconverging SESE regions of a function concurrently.
+// every region is copied to a sub function in which its nested regions are collapsed to a single proxy block
+// and its exit is replaced by a sink. the sub functions are processed by one OT per worker and stitched back:
+// the proxy of a region becomes a new uniform block joining the edges leaving the region (<entry>_EXIT),
+// FLOW blocks of nested regions are prefixed with the name of the region entry.
+// regions that are reconverging already are only represented by their proxy, their blocks are neither copied nor processed
+class RegionReconvergence
+{
+public:
+    // _bVerify enables the per step verification of the OTs, see OpenTree
+    RegionReconvergence(const uint32_t _uWorkers = 1u, const bool _bVerify = false);
+    ~RegionReconvergence() {};
+
+    // _Ordering is a valid ordering of the whole function, the regions are processed in the order of their blocks.
+    // returns true if flow was rerouted
+    bool Process(Function& _Func, const NodeOrder& _Ordering);
+
+    // an OT step of the last Process() call violated an invariant, the function was not stitched
+    bool VerificationFailed() const { return m_bVerificationFailed; }
+
+    // uses at most _uWorkers of the workers it was created with for the following Process() calls
+    void LimitWorkers(const uint32_t _uWorkers) { m_uActiveWorkers = std::clamp(_uWorkers, 1u, m_uWorkers); }
+
+private:
+    struct SubFunction
+    {
+        SubFunction(const std::string& _sName) : Func(_sName) {}
+
+        Function Func;
+        NodeOrder Ordering;
+        BasicBlock* pSink = nullptr; // stand-in for the region exit
+
+        // sub block id -> parent block receiving its instructions, parent block targeted by its branches
+        std::vector<BasicBlock*> Blocks;
+        std::vector<BasicBlock*> Targets;
+        std::vector<uint32_t> Proxies; // sub block id -> collapsed region
+        std::unordered_map<const Instruction*, Instruction*> Conditions; // parent condition -> placeholder parameter
+
+        // sub instruction id -> parent instruction, seeded with the copied terminators and the condition placeholders
+        std::vector<Instruction*> Instructions;
+        std::vector<bool> Fill; // instruction needs to be (re)written in the parent
+    };
+
+    void Build(Function& _Func, const RegionTree& _Regions, const NodeOrder& _Ordering);
+
+    void Stitch(Function& _Func, const RegionTree& _Regions);
+
+private:
+    const uint32_t m_uWorkers;
+    uint32_t m_uActiveWorkers;
+    std::vector<OpenTree> m_Trees; // one per worker
+    std::deque<SubFunction> m_Subs; // one per region
+    bool m_bVerificationFailed = false;
+};
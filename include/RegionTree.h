@@ -0,0 +1,49 @@
+#pragma once
+
+#include "PostDominators.h"
+#include "NodeOrdering.h"
+
+// forward decls:
+class Function;
+
+// single entry single exit region: all edges entering the region target pEntry,
+// all edges leaving the region target pExit which is not part of the region
+struct Region
+{
+    BasicBlock* pEntry = nullptr;
+    BasicBlock* pExit = nullptr; // nullptr for the root region (whole function)
+    uint32_t uParent = InvalidId;
+    uint32_t uNumBlocks = 0u; // including the blocks of nested regions
+    bool bReconverging = false; // all divergent blocks branch to their immediate post dominator, nothing is nested
+
+    std::vector<uint32_t> Children;
+};
+
+// tree of the SESE regions of a function, region 0 is the whole function.
+// regions are either disjoint or nested, parents are always stored before their children.
+// reconverging regions are leaves, they can be collapsed without processing their blocks
+class RegionTree
+{
+public:
+    // bound of the candidate scan, blocks scanned per block of the function
+    static constexpr uint64_t uScanBlocksPerBlock = 64u;
+
+    // _uMinBlocks smallest region worth processing on its own.
+    // the candidate scan is bounded by uScanBlocksPerBlock, blocks of unscanned candidates stay in their enclosing region.
+    // if _pOrdering is given, reconverging regions need their exit to be ordered after all of their blocks
+    RegionTree(Function& _Func, const NodeOrder* _pOrdering = nullptr, const uint32_t _uMinBlocks = 2u);
+    ~RegionTree() {};
+
+    const std::vector<Region>& GetRegions() const { return m_Regions; }
+
+    // innermost region containing _pBB
+    uint32_t GetRegion(const BasicBlock* _pBB) const { return m_BlockRegion[_pBB->GetIdentifier()]; }
+
+    // nullptr if _pBB is the exit or does not reach the exit
+    BasicBlock* GetImmediatePostDominator(const BasicBlock* _pBB) const { return m_PDom.GetImmediate(_pBB); }
+
+private:
+    std::vector<Region> m_Regions;
+    std::vector<uint32_t> m_BlockRegion; // block id -> innermost region
+    PostDominators m_PDom;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "InstructionDefines.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CachedFile
+{
+    std::string sName; // file name in the output directory
+    bool bBinary = false; // written with std::ios::binary
+    std::string sData;
+};
+
+struct CachedResult
+{
+    std::vector<CachedFile> Files;
+    std::vector<InstrId> BlockOrder; // input ordering returned by dot2ll
+};
+
+// on disk cache of the files produced for one input graph and ordering, an entry is stored as <dir>/<key>.d2lc.
+// the key hashes the graph source, the format version, the build of the tool (see ComputeKey) and the options affecting the outputs.
+// entries are written to a temporary file and renamed, concurrent writers of the same key store the same content
+class ResultCache
+{
+public:
+    // version of the entry format, changes of the outputs are covered by the build id
+    static constexpr uint32_t uVersion = 1u;
+
+    // the cache is disabled if the build id can not be computed
+    ResultCache(const std::filesystem::path& _Dir = {});
+    ~ResultCache() {};
+
+    bool IsEnabled() const { return m_Dir.empty() == false; }
+
+    // FNV-1a over the source and the option string. the build id hashes DOT2LL_BUILD_ID if it is defined, otherwise the executable,
+    // so entries of a different build of the tool are never reused. only valid if the cache is enabled
+    uint64_t ComputeKey(const std::string_view _sSource, const std::string_view _sOptions) const;
+
+    // false if there is no valid entry for _uKey
+    bool Load(const uint64_t _uKey, CachedResult& _Result) const;
+
+    bool Store(const uint64_t _uKey, const CachedResult& _Result) const;
+
+private:
+    std::filesystem::path GetPath(const uint64_t _uKey) const;
+
+private:
+    std::filesystem::path m_Dir;
+    uint64_t m_uBuildId = 0u;
+};
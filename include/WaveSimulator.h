@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Function.h"
+#include <ostream>
+
+struct SimulationOptions
+{
+    uint32_t uLanes = 32u; // 1 to 64
+    uint64_t uSeed = 0u;
+
+    // random parameter values are drawn from [0, uRandomRange) each time a lane reads the parameter,
+    // a lane takes the same decisions in the input and the reconverged CFG
+    uint32_t uRandomRange = 2u;
+
+    // parameter alias -> values per lane, a single value is used by all lanes. values are fixed for the whole run
+    std::unordered_map<std::string, std::vector<uint64_t>> Values;
+
+    // the run is aborted when a wave never leaves a loop
+    uint64_t uMaxBlockExecutions = 1000000u;
+};
+
+struct SimulationStats
+{
+    std::vector<uint64_t> BlockExecutions; // by block identifier
+    std::vector<uint64_t> BlockActiveLanes; // sum of the active lanes of all executions, by block identifier
+
+    uint64_t uBlockExecutions = 0u; // wave level executions of non virtual blocks
+    uint64_t uSerializedExecutions = 0u; // executions with only a part of the wave active
+    uint64_t uActiveLanes = 0u;
+    uint64_t uDivergentBranches = 0u;
+    uint32_t uLanes = 0u;
+    bool bCompleted = false; // all lanes returned before uMaxBlockExecutions
+
+    double GetLaneUtilization() const { return uBlockExecutions != 0u ? double(uActiveLanes) / double(uBlockExecutions * uLanes) : 0.0; }
+};
+
+// executes a function for a wave of lanes with a bitmask of active lanes and an immediate post dominator reconvergence stack:
+// divergent lanes are serialized until they reach the immediate post dominator of the divergent branch.
+// bool values are lane masks, all other values are stored per lane
+class WaveSimulator
+{
+public:
+    WaveSimulator(const SimulationOptions& _Options = {});
+    ~WaveSimulator() {};
+
+    SimulationStats Run(const Function& _Function);
+
+    // tab separated: function, block, executions, average active lanes
+    static void WriteReport(const Function& _Function, const SimulationStats& _Stats, std::ostream& _OutStream);
+
+private:
+    void Execute(const BasicBlock& _BB, const uint64_t _uMask);
+
+    uint64_t GetMask(const InstrId _uId, const uint64_t _uMask);
+    uint64_t GetLane(const InstrId _uId, const uint32_t _uLane);
+    void SetMask(const InstrId _uId, const uint64_t _uMask, const uint64_t _uValue);
+
+private:
+    SimulationOptions m_Options;
+    uint64_t m_uFullMask = 0u;
+
+    const Function* m_pFunction = nullptr;
+    std::vector<TypeInfo> m_Types; // result type by instruction
+    std::vector<uint64_t> m_Masks; // bool values by instruction
+    std::vector<uint64_t> m_Lanes; // other values by instruction and lane
+
+    std::vector<InstrId> m_ParamIndex; // by instruction
+    std::vector<const std::vector<uint64_t>*> m_ParamValues; // user values by parameter
+    std::vector<uint64_t> m_ReadCounts; // by parameter and lane
+
+    std::vector<InstrId> m_PrevBlock; // by lane
+};
@@ -1,278 +1,290 @@
-#include "DotParser.h"
-#include "DotWriter.h"
+#include "Driver.h"
+#include "Daemon.h"
 #include "Dot2CFG.h"
-#include "CFG2Dot.h"
 #include "OpenTree.h"
-#include "InstructionSetLLVMAMD.h"
-#include "CheckReconvergence.h"
+#include "RegionReconvergence.h"
+#include "MappedFile.h"
+#include "BatchScheduler.h"
+#include "ResultCache.h"
+#include <atomic>
+#include <cassert>
+#include <deque>
 #include <filesystem>
+#include <memory>
+#include <sstream>
 
-static const std::wstring OrderNames[] =
-{
-    L"DepthFirst",
-    L"DepthFirstDom",
-    L"BreadthFirst",
-    L"BreadthFirstDom",
-    L"PostOrder",
-    L"ReversePostOrder",
-    L"DominanceRegion",
-    L"Custom"
-};
-
-
-std::vector<InstrId> dot2ll(const std::string& _sDotFile, const uint32_t _uOderIndex, const bool _bReconv, const std::filesystem::path& _sOutPath, const bool _bPutVirtualFront, const std::string& _sCustomOrder)
+int main(int argc, char* argv[])
 {
-    const NodeOrdering::OrderType _kOrder{ 1u << _uOderIndex };
+    if (argc < 2)
+        return 1;
 
-    DotGraph dotin = DotParser::ParseFromFile(_sDotFile);
+    DriverOptions Options;
+    ParseArguments(std::vector<std::string>(argv + 1, argv + argc), Options);
+    LogLevel::Set(Options.kLogLevel);
 
-    const size_t uUserNodes = dotin.GetNodes().size();
+    // stdout carries the replies of the daemon
+    hlx::Logger::Instance()->WriteToStream(Options.bDaemon ? &std::wcerr : &std::wcout);
 
-    if (uUserNodes == 0u)
+    if (Options.bDaemon || Options.SocketPath.empty() == false)
     {
-        HERROR("Failed to parse %s", WCSTR(_sDotFile));
-        return {};
+        Daemon Server(Options.uWorkers);
+        return Options.SocketPath.empty() ? Server.ServeStdin() : Server.ServeSocket(Options.SocketPath);
     }
 
-    Function func = Dot2CFG::Convert(dotin);
-
-    if (func.EnforceUniqueEntryPoint() == false || func.EnforceUniqueExitPoint() == false)
-        return {};
+    if (Options.OutputPath.empty())
+    {
+        Options.OutputPath = std::filesystem::is_directory(Options.InputPath) ? Options.InputPath : Options.InputPath.parent_path();
+    }
 
-    const bool bInputReconverging = CheckReconvergence::IsReconverging(func);
+    if (Options.kOrder == 0u)
+    {
+        HLOGW("No input ordering specified, defaulting to DFPD");
+        Options.kOrder = NodeOrdering::Order_DepthFirstDom;
+    }
 
-    HLOG("Processing %s '%s' [Order: %s Reconv: %s]", WCSTR(_sDotFile), WCSTR(dotin.GetName()),
-        _kOrder == NodeOrdering::Order_Custom ? WCSTR(_sCustomOrder) : WCSTR(OrderNames[_uOderIndex]), bInputReconverging ? L"true" : L"false");
+    // input files in a deterministic order
+    std::vector<std::filesystem::path> Files;
+    if (std::filesystem::is_directory(Options.InputPath))
+    {
+        for (const auto& Entry : std::filesystem::directory_iterator(Options.InputPath))
+        {
+            if (Entry.is_directory() == false && Entry.path().extension() == ".dot")
+            {
+                Files.push_back(Entry.path());
+            }
+        }
 
-    std::string sOutName = dotin.GetName();
-    std::vector<InstrId> BBOrder;
+        std::sort(Files.begin(), Files.end());
+    }
+    else
+    {
+        Files.push_back(Options.InputPath);
+    }
 
-    if (_bReconv)
+    // every file is mapped once, a file may contain several digraph blocks which are processed as separate inputs
+    struct DotInput
     {
-        sOutName += "_reconv";
+        std::string sName; // file path, followed by the graph index for files with several graphs
+        std::string_view sSource;
+    };
 
-        NodeOrder InputOrdering;
-        
-        switch (_kOrder)
+    std::vector<MappedFile> Mappings(Files.size());
+    std::vector<DotInput> Inputs;
+    Inputs.reserve(Files.size());
+
+    for (size_t f = 0u; f < Files.size(); ++f)
+    {
+        if (Mappings[f].Open(Files[f]) == false)
         {
-        case NodeOrdering::Order_DepthFirst:
-            InputOrdering = NodeOrdering::DepthFirst(func.GetEntryBlock());
-            sOutName += "_df";
-            break;
-        case NodeOrdering::Order_BreadthFirst:
-            InputOrdering = NodeOrdering::BreadthFirst(func.GetEntryBlock(), false);
-            sOutName += "_bf";
-            break;
-        case NodeOrdering::Order_BreadthFirstDom:
-            InputOrdering = NodeOrdering::BreadthFirst(func.GetEntryBlock(), true);
-            sOutName += "_bfd";
-            break;
-        case NodeOrdering::Order_PostOrder:
-            InputOrdering = NodeOrdering::PostOrderTraversal(func.GetEntryBlock(), false);
-            sOutName += "_pot";
-            break;
-        case NodeOrdering::Order_ReversePostOrder:
-            InputOrdering = NodeOrdering::PostOrderTraversal(func.GetEntryBlock(), true);
-            sOutName += "_rpot";
-            break;
-        case NodeOrdering::Order_DominanceRegion:
-            InputOrdering = NodeOrdering::DominanceRegion(func.GetEntryBlock());
-            sOutName += "_domreg";
-            break;
-        case NodeOrdering::Order_Custom:
-            InputOrdering = NodeOrdering::Custom(func.GetCFG(), _sCustomOrder);
-            sOutName += "_custom";
-            break;
-        case NodeOrdering::Order_DepthFirstDom:
-        default:
-            InputOrdering = NodeOrdering::DepthFirstPostDom(func.GetEntryBlock(), func.GetExitBlock());
-            sOutName += "_dfd";
-            break;
+            HLOGE("Failed to map %s", WCSTR(Files[f].string()));
+            continue;
         }
 
-        if (InputOrdering.size() != uUserNodes)
+        const std::string_view sSource(reinterpret_cast<const char*>(Mappings[f].GetData()), Mappings[f].GetSize());
+        const std::vector<std::string_view> Graphs = Dot2CFG::SplitGraphs(sSource);
+
+        if (Graphs.empty())
         {
-            HFATALD("Ordering is not a valid traversal of the input CFG!");
-            return {};
+            HLOGE("No graph found in %s", WCSTR(Files[f].string()));
         }
 
-        for (BasicBlock* pBB : InputOrdering)
+        for (size_t g = 0u; g < Graphs.size(); ++g)
         {
-            BBOrder.push_back(pBB->GetIdentifier());
+            Inputs.push_back({ Graphs.size() == 1u ? Files[f].string() : Files[f].string() + "#" + std::to_string(g), Graphs[g] });
         }
+    }
 
-        // only execute if nodes in ordering are not reconverging already
-        bool bChangedCFG = !bInputReconverging ? NodeOrdering::PrepareOrdering(InputOrdering, _bPutVirtualFront, true) : false;
-
-        // reconverge using InputOrdering
-        OpenTree OT(true, _sOutPath.string() + "/");
-        bChangedCFG = OT.Process(InputOrdering);
-
-        func.Finalize();
-
-        const bool bOutputReconverging = CheckReconvergence::IsReconverging(func, true);
-        hlx::Logger::Instance()->Log(bOutputReconverging ? hlx::kMessageType_Info : hlx::kMessageType_Error, WFUNC, WFILE, __LINE__, L"Function %s reconverging!\n", bOutputReconverging ? L"is" : L"is NOT");
-
-        std::ofstream dotout(_sOutPath / (sOutName + ".dot"));
+    // region mode processes the files one by one and the regions of a function on all workers
+    const uint32_t uFileWorkers = Options.bRegions ? 1u : Options.uWorkers;
+    std::unique_ptr<RegionReconvergence> pRegions = Options.bRegions ? std::make_unique<RegionReconvergence>(Options.uWorkers, Options.bVerify) : nullptr;
 
-        if (dotout.is_open())
+    // one OT per worker, reused for all functions and orderings.
+    // the OT debug dumps are named after the blocks, workers write them to their own directory to not overwrite each other.
+    // they are kept out of the output directory, which only depends on the inputs and options
+    std::vector<OpenTree> Trees;
+    Trees.reserve(uFileWorkers);
+    for (uint32_t w = 0u; w < uFileWorkers; ++w)
+    {
+        std::string sDumpPath;
+        if (Options.DumpPath.empty() == false)
         {
-            DotWriter::WriteToStream(CFG2Dot::Convert(func.GetCFG(), func.GetName()), dotout);
+            const std::filesystem::path DumpDir = uFileWorkers == 1u ? Options.DumpPath : Options.DumpPath / std::to_string(w);
 
-            dotout.close();
+            std::error_code Error;
+            std::filesystem::create_directories(DumpDir, Error);
+            sDumpPath = DumpDir.string() + "/";
         }
 
-        assert(bOutputReconverging);
+        Trees.emplace_back(true, sDumpPath, Options.bVerify);
     }
 
-    std::ofstream ll(_sOutPath / (sOutName + ".ll"));
+    if (Options.uMaxInFlight == 0u)
+    {
+        Options.uMaxInFlight = 4u * uFileWorkers;
+    }
+
+    // each input is reconverged with all selected orderings
+    const std::vector<uint32_t> Orderings = GetOrderings(Options);
 
-    if (ll.is_open())
+    // parsed inputs of the scheduler window, indexed by input % uMaxInFlight
+    struct InputSlot
     {
-        func.Finalize();
+        std::vector<uint64_t> Binary; // the input function in the binary format, loaded by every ordering task
+        std::deque<TaskOutput> Outputs; // per ordering
+        std::vector<std::vector<InstrId>> BlockOrders; // per ordering
+        std::vector<uint64_t> Keys; // cache key per ordering
+        std::vector<uint8_t> Cached; // outputs of the ordering were loaded from the cache
+    };
 
-        InstructionSetLLVMAMD isa;
-        isa.SerializeListing(func, ll);
+    // every option changing the outputs of an input is part of the cache key
+    const ResultCache Cache(Options.CachePath);
+    std::string sCacheOptions;
+    if (Cache.IsEnabled())
+    {
+        std::ostringstream KeyOptions;
+        KeyOptions << "reconv " << Options.bReconv << " virtualfront " << Options.bVirtualFront << " regions " << Options.bRegions << " verify " << Options.bVerify
+            << " report " << Options.bReport << " bc " << Options.bBitcode << " bin " << Options.bBinary << " spirv " << Options.bSPIRV << " cost " << Options.bCost << " simulate " << Options.bSimulate;
 
-        ll.close();
-    }
+        if (Options.bSimulate)
+        {
+            KeyOptions << " lanes " << Options.Simulation.uLanes << " seed " << Options.Simulation.uSeed << " range " << Options.Simulation.uRandomRange << " max " << Options.Simulation.uMaxBlockExecutions;
 
-    return BBOrder;
-}
+            std::vector<std::string> Names;
+            for (const auto& [sName, Values] : Options.Simulation.Values)
+            {
+                Names.push_back(sName);
+            }
+            std::sort(Names.begin(), Names.end());
 
-int main(int argc, char* argv[])
-{
-    if (argc < 2)
-        return 1;
+            for (const std::string& sName : Names)
+            {
+                KeyOptions << ' ' << sName << '=';
+                for (const uint64_t uValue : Options.Simulation.Values.at(sName))
+                {
+                    KeyOptions << uValue << ',';
+                }
+            }
+        }
 
-    uint32_t kOrder = NodeOrdering::Order_None;
-    hlx::Logger::Instance()->WriteToStream(&std::wcout);
+        sCacheOptions = KeyOptions.str();
+    }
 
-    std::filesystem::path InputPath;
-    std::filesystem::path OutputPath;
-    std::string sCustomOrder;
+    std::atomic<uint32_t> uCacheHits{ 0u };
 
-    bool bReconv = false;
-    bool bVirtualFront = false;
+    std::vector<InputSlot> Slots(Options.uMaxInFlight);
 
-    for (int i = 1; i < argc; ++i)
+    // the dot source is parsed once, the orderings reconverge copies of it
+    const auto Prepare = [&](const uint32_t _uInput, const uint32_t /*_uWorker*/) -> bool
     {
-        std::string token(argv[i]);
+        InputSlot& Slot = Slots[_uInput % Options.uMaxInFlight];
+        Slot.Outputs.resize(Orderings.size());
+        Slot.BlockOrders.assign(Orderings.size(), {});
+        Slot.Keys.assign(Orderings.size(), 0u);
+        Slot.Cached.assign(Orderings.size(), 0u);
 
-        if (token == "-reconverge" || token == "-r")
-        {
-            bReconv = true;
-        }
-        else if (token == "-depthfirst" || token == "-df")
-        {
-            kOrder |= NodeOrdering::Order_DepthFirst;
-        }
-        else if (token == "-depthfirstdom" || token == "-dfd")
-        {
-            kOrder |= NodeOrdering::Order_DepthFirstDom;
-        }
-        else if (token == "-breadthfirst" || token == "-bf")
-        {
-            kOrder |= NodeOrdering::Order_BreadthFirst;
-        }
-        else if (token == "-breadthfirstdom" || token == "-bfd")
-        {
-            kOrder |= NodeOrdering::Order_BreadthFirstDom;
-        }
-        else if (token == "-postorder" || token == "-pot")
-        {
-            kOrder |= NodeOrdering::Order_PostOrder;
-        }
-        else if (token == "-reversepostorder" || token == "-rpot")
-        {
-            kOrder |= NodeOrdering::Order_ReversePostOrder;
-        }
-        else if (token == "-dominanceregion" || token == "-domreg")
-        {
-            kOrder |= NodeOrdering::Order_DominanceRegion;
-        }
-        else if (token == "-all")
-        {
-            kOrder = NodeOrdering::Order_All;
-        }
-        else if (token == "-custom" && (i + 1) < argc)
-        {
-            kOrder |= NodeOrdering::Order_Custom;
-            sCustomOrder = argv[++i];
-        }
-        else if (token == "-virtualfront")
-        {
-            bVirtualFront = true;
-        }
-        else if (token == "-out" && (i + 1) < argc)
-        {
-            OutputPath = argv[++i];
-        }
-        else if (token == "-in" && (i + 1) < argc)
+        if (Cache.IsEnabled())
         {
-            InputPath = argv[++i];
+            bool bAllCached = true;
+            for (size_t o = 0u; o < Orderings.size(); ++o)
+            {
+                const uint32_t uOrder = Orderings[o];
+                const std::string sOptions = sCacheOptions + " order " + std::to_string(uOrder) + (NodeOrdering::OrderType(1u << uOrder) == NodeOrdering::Order_Custom ? " " + Options.sCustomOrder : std::string());
+                Slot.Keys[o] = Cache.ComputeKey(Inputs[_uInput].sSource, sOptions);
+
+                CachedResult Result;
+                if (Cache.Load(Slot.Keys[o], Result))
+                {
+                    Slot.Outputs[o].Import(Options.OutputPath, Result);
+                    Slot.BlockOrders[o] = std::move(Result.BlockOrder);
+                    Slot.Cached[o] = 1u;
+                    ++uCacheHits;
+                }
+                else
+                {
+                    bAllCached = false;
+                }
+            }
+
+            // neither parsed nor reconverged
+            if (bAllCached)
+            {
+                HLOGI("Using cached outputs of %s", WCSTR(Inputs[_uInput].sName));
+                return false;
+            }
         }
-        else if(i == 1u)
+
+        Function func = Dot2CFG::Convert(Inputs[_uInput].sSource);
+
+        // without the virtual entry block
+        if (func.GetCFG().GetNodes().size() < 2u)
         {
-            InputPath = token;
+            HLOGE("Failed to parse %s", WCSTR(Inputs[_uInput].sName));
+            return false;
         }
-    }
 
-    if (OutputPath.empty())
-    {
-        OutputPath = std::filesystem::is_directory(InputPath) ? InputPath : InputPath.parent_path();
-    }
+        if (func.EnforceUniqueEntryPoint() == false || func.EnforceUniqueExitPoint() == false)
+            return false;
 
-    if (kOrder == 0u)
-    {
-        HWARNING("No input ordering specified, defaulting to DFPD");
-        kOrder = NodeOrdering::Order_DepthFirstDom;
-    }
+        return StoreFunction(func, Slot.Binary);
+    };
 
-    const auto Reconv = [&](const uint32_t _uOrder)
+    const auto Process = [&](const uint32_t _uInput, const uint32_t _uOrdering, const uint32_t _uWorker)
     {
-        if (std::filesystem::is_directory(InputPath))
+        InputSlot& Slot = Slots[_uInput % Options.uMaxInFlight];
+        if (Slot.Cached[_uOrdering])
+            return;
+
+        Function func = LoadFunction(Slot.Binary);
+
+        const ReconvergeStats Stats = dot2ll(func, Inputs[_uInput].sName, Orderings[_uOrdering], Options.bReconv, Options.OutputPath, Options.bVirtualFront, Options.sCustomOrder,
+            Trees[_uWorker], pRegions.get(), Options.bReport, Options.bBitcode, Options.bBinary, Options.bSPIRV, Options.bCost, Options.bSimulate ? &Options.Simulation : nullptr, Slot.Outputs[_uOrdering]);
+
+        // the verification failure has been logged
+        Slot.BlockOrders[_uOrdering] = Stats.bValid ? Stats.BlockOrder : std::vector<InstrId>();
+
+#ifndef NDEBUG
+        // the reconverged output of a valid ordering has to be reconverging. the assert aborts before the input is retired, keep the outputs for debugging
+        if (Options.bReconv && Stats.bValid && Stats.bReconverging == false)
         {
-            for (const auto& Entry : std::filesystem::directory_iterator(InputPath))
-            {
-                if (Entry.is_directory() == false && Entry.path().extension() == ".dot")
-                {
-                    dot2ll(Entry.path().string(), _uOrder, bReconv, OutputPath, bVirtualFront, sCustomOrder);
-                }
-            }
+            Slot.Outputs[_uOrdering].Write();
+            assert(Stats.bReconverging);
         }
-        else
+#endif
+
+        if (Cache.IsEnabled())
         {
-            dot2ll(InputPath.string(), _uOrder, bReconv, OutputPath, bVirtualFront, sCustomOrder);
+            CachedResult Result;
+            Slot.Outputs[_uOrdering].Export(Result);
+            Result.BlockOrder = Slot.BlockOrders[_uOrdering];
+            Cache.Store(Slot.Keys[_uOrdering], Result);
         }
     };
 
-#if 1
-    for (const auto& Entry : std::filesystem::directory_iterator(InputPath))
+    // in input order, the files are written in the same sequence as by a single worker
+    const auto Retire = [&](const uint32_t _uInput)
     {
-        if (Entry.is_directory() == false && Entry.path().extension() == ".dot")
+        InputSlot& Slot = Slots[_uInput % Options.uMaxInFlight];
+
+        for (TaskOutput& Output : Slot.Outputs)
         {
-            auto dfd = dot2ll(Entry.path().string(), 1, bReconv, OutputPath, bVirtualFront, sCustomOrder);
-            auto domreg = dot2ll(Entry.path().string(), 6, bReconv, OutputPath, bVirtualFront, sCustomOrder);
-            if (dfd != domreg)
-            {
-                HWARNING("Orderings dont match for %s", WCSTR(Entry.path().filename()));
-            }
+            Output.Write();
         }
-    }
-#else
-    for (uint32_t i = 0u; i < NodeOrdering::Order_NumOf; ++i)
-    {
-        const auto kType = NodeOrdering::OrderType((1 << i));
-        if ((kOrder & kType) == kType)
-        {            
-            if (kType == NodeOrdering::Order_Custom && sCustomOrder.empty())
-                continue;
 
-            Reconv(i);
+        if (Options.bCompare && std::any_of(Slot.BlockOrders.begin(), Slot.BlockOrders.end(), [&](const std::vector<InstrId>& Order) { return Order != Slot.BlockOrders.front(); }))
+        {
+            HLOGW("Orderings dont match for %s", WCSTR(std::filesystem::path(Inputs[_uInput].sName).filename()));
         }
+
+        Slot.Binary = {};
+    };
+
+    BatchScheduler Scheduler(uFileWorkers, Options.uMaxInFlight);
+    Scheduler.Run(static_cast<uint32_t>(Inputs.size()), static_cast<uint32_t>(Orderings.size()), Prepare, Process, Retire);
+
+    if (Cache.IsEnabled())
+    {
+        HLOGI("%u of %u outputs were cached", uCacheHits.load(), static_cast<uint32_t>(Inputs.size() * Orderings.size()));
     }
-#endif
 
     return 0;
 }
\ No newline at end of file
@@ -55,7 +55,7 @@ Instruction* BasicBlock::InsertInstructionBefore(Instruction* _pSuccInstr)
         return InsertInstructionBefore(it);
     }
 
-    HFATALD("Did not find instruction %s in basic block %s", WCSTR(_pSuccInstr->GetAlias()), WCSTR(m_sName));
+    HLOG_SYNC(HFATALD, "Did not find instruction %s in basic block %s", WCSTR(_pSuccInstr->GetAlias()), WCSTR(m_sName));
     return nullptr;
 }
 
@@ -66,6 +66,6 @@ Instruction* BasicBlock::InsertInstructionAfter(Instruction* _pPrevInstr)
         return InsertInstructionAfter(it);
     }
 
-    HFATALD("Did not find instruction %s in basic block %s", WCSTR(_pPrevInstr->GetAlias()), WCSTR(m_sName));
+    HLOG_SYNC(HFATALD, "Did not find instruction %s in basic block %s", WCSTR(_pPrevInstr->GetAlias()), WCSTR(m_sName));
     return nullptr;
 }
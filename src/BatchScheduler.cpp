@@ -0,0 +1,190 @@
+#include "BatchScheduler.h"
+#include <algorithm>
+#include <thread>
+
+BatchScheduler::BatchScheduler(const uint32_t _uWorkers, const uint32_t _uMaxInFlight) :
+    m_uWorkers(std::max(1u, _uWorkers)),
+    m_uMaxInFlight(std::max(1u, _uMaxInFlight))
+{
+    m_Queues.reserve(m_uWorkers);
+    for (uint32_t w = 0u; w < m_uWorkers; ++w)
+    {
+        m_Queues.push_back(std::make_unique<Queue>());
+    }
+}
+
+void BatchScheduler::Run(const uint32_t _uNumInputs, const uint32_t _uNumVariants, const PrepareFunc& _Prepare, const ProcessFunc& _Process, const RetireFunc& _Retire)
+{
+    if (_uNumInputs == 0u)
+        return;
+
+    m_uNumInputs = _uNumInputs;
+    m_uNumVariants = _uNumVariants;
+    m_pPrepare = &_Prepare;
+    m_pProcess = &_Process;
+    m_pRetire = &_Retire;
+
+    m_uNextInput = 0u;
+    m_uNextRetire = 0u;
+    m_uQueued = 0u;
+    m_Remaining.assign(m_uMaxInFlight, 0u);
+
+    std::vector<std::thread> Threads;
+    Threads.reserve(m_uWorkers - 1u);
+
+    for (uint32_t w = 1u; w < m_uWorkers; ++w)
+    {
+        Threads.emplace_back(&BatchScheduler::Work, this, w);
+    }
+
+    Work(0u);
+
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+
+    m_pPrepare = nullptr;
+    m_pProcess = nullptr;
+    m_pRetire = nullptr;
+}
+
+void BatchScheduler::Work(const uint32_t _uWorker)
+{
+    Task Current;
+
+    while (true)
+    {
+        if (Acquire(_uWorker, Current) == false)
+        {
+            std::unique_lock<std::mutex> Lock(m_Mutex);
+
+            if (m_uNextRetire == m_uNumInputs)
+                return;
+
+            const bool bAdmissible = m_uNextInput < m_uNumInputs && m_uNextInput - m_uNextRetire < m_uMaxInFlight;
+            if (m_uQueued == 0u && bAdmissible == false)
+            {
+                m_Wake.wait(Lock);
+            }
+            continue;
+        }
+
+        if (Current.uVariant != InvalidVariant)
+        {
+            (*m_pProcess)(Current.uInput, Current.uVariant, _uWorker);
+        }
+        else if ((*m_pPrepare)(Current.uInput, _uWorker) && m_uNumVariants != 0u)
+        {
+            {
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                m_Remaining[Current.uInput % m_uMaxInFlight] += m_uNumVariants;
+            }
+
+            // popped from the back, the first variant runs first on this worker
+            for (uint32_t v = m_uNumVariants; v-- > 0u;)
+            {
+                Push(_uWorker, { Current.uInput, v });
+            }
+        }
+
+        Complete(Current.uInput);
+    }
+}
+
+bool BatchScheduler::Acquire(const uint32_t _uWorker, Task& _Task)
+{
+    for (uint32_t i = 0u; i < m_uWorkers; ++i)
+    {
+        const uint32_t uVictim = (_uWorker + i) % m_uWorkers;
+        Queue& Q = *m_Queues[uVictim];
+
+        bool bFound = false;
+        {
+            std::lock_guard<std::mutex> Lock(Q.Mutex);
+            if (Q.Tasks.empty() == false)
+            {
+                if (uVictim == _uWorker)
+                {
+                    _Task = Q.Tasks.back();
+                    Q.Tasks.pop_back();
+                }
+                else
+                {
+                    _Task = Q.Tasks.front();
+                    Q.Tasks.pop_front();
+                }
+                bFound = true;
+            }
+        }
+
+        if (bFound)
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            --m_uQueued;
+            return true;
+        }
+    }
+
+    // no queued task, prepare the next input if the window allows it
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    if (m_uNextInput < m_uNumInputs && m_uNextInput - m_uNextRetire < m_uMaxInFlight)
+    {
+        _Task = { m_uNextInput, InvalidVariant };
+        m_Remaining[m_uNextInput % m_uMaxInFlight] = 1u;
+        ++m_uNextInput;
+        return true;
+    }
+
+    return false;
+}
+
+void BatchScheduler::Push(const uint32_t _uWorker, const Task& _Task)
+{
+    {
+        Queue& Q = *m_Queues[_uWorker];
+        std::lock_guard<std::mutex> Lock(Q.Mutex);
+        Q.Tasks.push_back(_Task);
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        ++m_uQueued;
+    }
+
+    m_Wake.notify_one();
+}
+
+void BatchScheduler::Complete(const uint32_t _uInput)
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        if (--m_Remaining[_uInput % m_uMaxInFlight] != 0u)
+            return;
+    }
+
+    // whoever completes the front input retires it and all completed inputs behind it
+    std::lock_guard<std::mutex> RetireLock(m_RetireMutex);
+
+    while (true)
+    {
+        uint32_t uRetire = 0u;
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            if (m_uNextRetire == m_uNextInput || m_Remaining[m_uNextRetire % m_uMaxInFlight] != 0u)
+                break;
+
+            uRetire = m_uNextRetire;
+        }
+
+        (*m_pRetire)(uRetire);
+
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            ++m_uNextRetire;
+        }
+
+        // a slot of the window is free or all inputs are done
+        m_Wake.notify_all();
+    }
+}
@@ -0,0 +1,96 @@
+#include "BitstreamWriter.h"
+
+void BitstreamWriter::EmitWord(const uint32_t _uWord)
+{
+    m_Bytes.push_back(static_cast<uint8_t>(_uWord));
+    m_Bytes.push_back(static_cast<uint8_t>(_uWord >> 8u));
+    m_Bytes.push_back(static_cast<uint8_t>(_uWord >> 16u));
+    m_Bytes.push_back(static_cast<uint8_t>(_uWord >> 24u));
+}
+
+void BitstreamWriter::Emit(const uint32_t _uValue, const uint32_t _uBits)
+{
+    if (_uBits == 0u)
+        return;
+
+    const uint64_t uMask = (uint64_t(1u) << _uBits) - 1u;
+    m_uCurrent |= (uint64_t(_uValue) & uMask) << m_uCurrentBits;
+    m_uCurrentBits += _uBits;
+
+    if (m_uCurrentBits >= 32u)
+    {
+        EmitWord(static_cast<uint32_t>(m_uCurrent));
+        m_uCurrent >>= 32u;
+        m_uCurrentBits -= 32u;
+    }
+}
+
+void BitstreamWriter::EmitVBR(uint64_t _uValue, const uint32_t _uBits)
+{
+    const uint64_t uThreshold = uint64_t(1u) << (_uBits - 1u);
+
+    // continuation bit set on all but the last chunk
+    while (_uValue >= uThreshold)
+    {
+        Emit(static_cast<uint32_t>((_uValue & (uThreshold - 1u)) | uThreshold), _uBits);
+        _uValue >>= _uBits - 1u;
+    }
+
+    Emit(static_cast<uint32_t>(_uValue), _uBits);
+}
+
+void BitstreamWriter::Align32()
+{
+    if (m_uCurrentBits > 0u)
+    {
+        EmitWord(static_cast<uint32_t>(m_uCurrent));
+        m_uCurrent = 0u;
+        m_uCurrentBits = 0u;
+    }
+}
+
+void BitstreamWriter::EnterBlock(const uint32_t _uBlockId, const uint32_t _uAbbrevWidth)
+{
+    Emit(kAbbrevId_EnterSubBlock, m_uAbbrevWidth);
+    EmitVBR(_uBlockId, 8u);
+    EmitVBR(_uAbbrevWidth, 4u);
+    Align32();
+
+    // length in words, patched when the block is closed
+    m_Blocks.push_back({ m_uAbbrevWidth, m_Bytes.size() });
+    EmitWord(0u);
+
+    m_uAbbrevWidth = _uAbbrevWidth;
+}
+
+void BitstreamWriter::ExitBlock()
+{
+    if (m_Blocks.empty())
+        return;
+
+    Emit(kAbbrevId_EndBlock, m_uAbbrevWidth);
+    Align32();
+
+    const Block& Outer = m_Blocks.back();
+    const uint32_t uWords = static_cast<uint32_t>((m_Bytes.size() - Outer.uLengthOffset) / 4u - 1u);
+
+    for (uint32_t i = 0u; i < 4u; ++i)
+    {
+        m_Bytes[Outer.uLengthOffset + i] = static_cast<uint8_t>(uWords >> (i * 8u));
+    }
+
+    m_uAbbrevWidth = Outer.uOuterAbbrevWidth;
+    m_Blocks.pop_back();
+}
+
+void BitstreamWriter::EmitRecord(const uint32_t _uCode, const std::vector<uint64_t>& _Operands)
+{
+    Emit(kAbbrevId_UnabbrevRecord, m_uAbbrevWidth);
+    EmitVBR(_uCode, 6u);
+    EmitVBR(_Operands.size(), 6u);
+
+    for (const uint64_t uOperand : _Operands)
+    {
+        EmitVBR(uOperand, 6u);
+    }
+}
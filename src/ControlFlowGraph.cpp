@@ -1,10 +1,9 @@
 #include "ControlFlowGraph.h"
 #include "Function.h"
 
-ControlFlowGraph::ControlFlowGraph(Function* _pParent, const size_t _uMaxNodes) :
+ControlFlowGraph::ControlFlowGraph(Function* _pParent) :
     m_pFunction(_pParent)
 {
-    m_Nodes.reserve(_uMaxNodes);
 };
 
 BasicBlock* ControlFlowGraph::FindNode(const std::string& _sName)
@@ -0,0 +1,232 @@
+#include "CostModel.h"
+#include "PostDominators.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    // instructions InstructionSetLLVMAMD folds into operands or the function signature
+    bool IsEmitted(const Instruction& _Instr)
+    {
+        switch (_Instr.GetInstruction())
+        {
+        case kInstruction_Nop:
+        case kInstruction_Type:
+        case kInstruction_FunctionParameter:
+        case kInstruction_Constant:
+        case kInstruction_Mov:
+        case kInstruction_Undefined:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    bool IsFlowBlock(const BasicBlock& _BB)
+    {
+        return _BB.GetName().compare(0u, 4u, "FLOW") == 0;
+    }
+} // anonymous namespace
+
+CostEstimate CostModel::Estimate(const Function& _Function, const CostWeights& _Weights)
+{
+    CostEstimate Estimate;
+
+    const ControlFlowGraph& CFG = _Function.GetCFG();
+    const size_t uNumBlocks = CFG.GetNodes().size();
+
+    std::vector<const BasicBlock*> DivergentBlocks;
+
+    for (const BasicBlock& BB : CFG)
+    {
+        if (BB.IsVirtual())
+            continue;
+
+        ++Estimate.uBlocks;
+        Estimate.uFlowBlocks += IsFlowBlock(BB);
+
+        for (const Instruction& I : BB)
+        {
+            Estimate.uInstructions += IsEmitted(I);
+            Estimate.uPhis += I.Is(kInstruction_Phi);
+        }
+
+        const Instruction* pTerminator = BB.GetTerminator();
+        if (pTerminator == nullptr)
+            continue;
+
+        if (pTerminator->Is(kInstruction_Branch))
+        {
+            ++Estimate.uBranches;
+        }
+        else if (pTerminator->Is(kInstruction_BranchCond))
+        {
+            ++Estimate.uBranches;
+
+            if (BB.IsDivergent())
+            {
+                ++Estimate.uDivergentBranches;
+                DivergentBlocks.push_back(&BB);
+            }
+            else
+            {
+                ++Estimate.uUniformBranches;
+            }
+        }
+    }
+
+    const BasicBlock* pEntry = _Function.GetEntryBlock();
+    const BasicBlock* pExit = _Function.GetExitBlock();
+
+    // every divergent branch keeps its exec mask saved until the lanes reconverge at the immediate post dominator
+    if (DivergentBlocks.empty() == false)
+    {
+        const PostDominators PDom(pExit, uNumBlocks);
+
+        std::vector<uint32_t> Nesting(uNumBlocks, 0u);
+        std::vector<uint32_t> Mark(uNumBlocks, 0u);
+        std::vector<const BasicBlock*> Stack;
+        uint32_t uMark = 0u;
+
+        for (const BasicBlock* pBranch : DivergentBlocks)
+        {
+            const BasicBlock* pReconvergence = PDom.GetImmediate(pBranch);
+            ++uMark;
+
+            Mark[pBranch->GetIdentifier()] = uMark;
+            if (pReconvergence != nullptr)
+            {
+                Mark[pReconvergence->GetIdentifier()] = uMark;
+            }
+
+            Stack.assign(pBranch->GetSuccesors().begin(), pBranch->GetSuccesors().end());
+
+            while (Stack.empty() == false)
+            {
+                const BasicBlock* pBB = Stack.back();
+                Stack.pop_back();
+
+                if (Mark[pBB->GetIdentifier()] == uMark)
+                    continue;
+
+                Mark[pBB->GetIdentifier()] = uMark;
+                ++Nesting[pBB->GetIdentifier()];
+                Stack.insert(Stack.end(), pBB->GetSuccesors().begin(), pBB->GetSuccesors().end());
+            }
+        }
+
+        Estimate.uMaxDivergentNesting = *std::max_element(Nesting.begin(), Nesting.end());
+    }
+
+    // entry to exit paths of the acyclic CFG in reverse post order, back edges target a block on the DFS stack
+    if (pEntry != nullptr && pExit != nullptr)
+    {
+        enum EState : uint8_t { kState_New = 0u, kState_Active, kState_Done };
+
+        struct Frame
+        {
+            const BasicBlock* pBB;
+            size_t uNext; // successor index
+        };
+
+        std::vector<uint8_t> State(uNumBlocks, kState_New);
+        std::vector<const BasicBlock*> PostOrder;
+        std::vector<Frame> Stack = { { pEntry, 0u } };
+        State[pEntry->GetIdentifier()] = kState_Active;
+
+        while (Stack.empty() == false)
+        {
+            Frame& Top = Stack.back();
+            if (Top.uNext < Top.pBB->GetSuccesors().size())
+            {
+                const BasicBlock* pSucc = Top.pBB->GetSuccesors()[Top.uNext++];
+                if (State[pSucc->GetIdentifier()] == kState_New)
+                {
+                    State[pSucc->GetIdentifier()] = kState_Active;
+                    Stack.push_back({ pSucc, 0u });
+                }
+            }
+            else
+            {
+                State[Top.pBB->GetIdentifier()] = kState_Done;
+                PostOrder.push_back(Top.pBB);
+                Stack.pop_back();
+            }
+        }
+
+        std::vector<uint32_t> Position(uNumBlocks, InvalidId);
+        for (uint32_t i = 0u; i < PostOrder.size(); ++i)
+        {
+            Position[PostOrder[i]->GetIdentifier()] = i;
+        }
+
+        std::vector<uint32_t> Shortest(uNumBlocks, InvalidId);
+        std::vector<uint32_t> Longest(uNumBlocks, 0u);
+        Shortest[pEntry->GetIdentifier()] = 0u;
+
+        for (auto it = PostOrder.rbegin(); it != PostOrder.rend(); ++it)
+        {
+            const BasicBlock* pBB = *it;
+            const InstrId uId = pBB->GetIdentifier();
+            if (Shortest[uId] == InvalidId)
+                continue;
+
+            const uint32_t uLength = pBB->IsVirtual() ? 0u : 1u;
+            Shortest[uId] += uLength;
+            Longest[uId] += uLength;
+
+            for (const BasicBlock* pSucc : pBB->GetSuccesors())
+            {
+                const InstrId uSucc = pSucc->GetIdentifier();
+
+                // forward edges only, the successor comes later in reverse post order
+                if (Position[uSucc] >= Position[uId])
+                    continue;
+
+                Shortest[uSucc] = std::min(Shortest[uSucc], Shortest[uId]);
+                Longest[uSucc] = std::max(Longest[uSucc], Longest[uId]);
+            }
+        }
+
+        if (Shortest[pExit->GetIdentifier()] != InvalidId)
+        {
+            Estimate.uShortestPath = Shortest[pExit->GetIdentifier()];
+            Estimate.uLongestPath = Longest[pExit->GetIdentifier()];
+        }
+    }
+
+    Estimate.fScore =
+        _Weights.fBlock * Estimate.uBlocks +
+        _Weights.fInstruction * Estimate.uInstructions +
+        _Weights.fPhi * Estimate.uPhis +
+        _Weights.fUniformBranch * Estimate.uUniformBranches +
+        _Weights.fDivergentBranch * Estimate.uDivergentBranches +
+        _Weights.fFlowBlock * Estimate.uFlowBlocks +
+        _Weights.fNesting * Estimate.uMaxDivergentNesting +
+        _Weights.fLongestPath * Estimate.uLongestPath;
+
+    return Estimate;
+}
+
+std::string CostModel::Format(const CostEstimate& _Estimate)
+{
+    char Buffer[256];
+    std::snprintf(Buffer, sizeof(Buffer), "score %.1f, %u blocks (%u flow), %u instructions, %u phis, %u branches (%u uniform, %u divergent), nesting %u, path %u-%u",
+        _Estimate.fScore, _Estimate.uBlocks, _Estimate.uFlowBlocks, _Estimate.uInstructions, _Estimate.uPhis,
+        _Estimate.uBranches, _Estimate.uUniformBranches, _Estimate.uDivergentBranches,
+        _Estimate.uMaxDivergentNesting, _Estimate.uShortestPath, _Estimate.uLongestPath);
+    return Buffer;
+}
+
+void CostModel::WriteReportHeader(std::ostream& _OutStream)
+{
+    _OutStream << "function\tblocks\tflow\tinstructions\tphis\tbranches\tuniform\tdivergent\tnesting\tshortest\tlongest\tscore\n";
+}
+
+void CostModel::WriteReport(const Function& _Function, const CostEstimate& _Estimate, std::ostream& _OutStream)
+{
+    _OutStream << _Function.GetName() << '\t' << _Estimate.uBlocks << '\t' << _Estimate.uFlowBlocks << '\t'
+        << _Estimate.uInstructions << '\t' << _Estimate.uPhis << '\t' << _Estimate.uBranches << '\t'
+        << _Estimate.uUniformBranches << '\t' << _Estimate.uDivergentBranches << '\t' << _Estimate.uMaxDivergentNesting << '\t'
+        << _Estimate.uShortestPath << '\t' << _Estimate.uLongestPath << '\t' << _Estimate.fScore << '\n';
+}
@@ -0,0 +1,319 @@
+#include "Daemon.h"
+#include "Driver.h"
+#include "Dot2CFG.h"
+#include "OpenTree.h"
+#include "RegionReconvergence.h"
+#include "CostModel.h"
+#include "MappedFile.h"
+#include "LocalSocket.h"
+#include "LogLevel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+Daemon::~Daemon()
+{
+}
+
+int Daemon::ServeStdin()
+{
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    Serve(std::cin, std::cout);
+    return 0;
+}
+
+int Daemon::ServeSocket(const std::filesystem::path& _Path)
+{
+    LocalSocketServer Server;
+    if (Server.Listen(_Path) == false)
+        return 1;
+
+    HLOGI("Listening on %s", WCSTR(_Path.string()));
+
+    struct Session
+    {
+        std::thread Thread;
+        std::atomic<bool> bDone{ false };
+    };
+
+    std::list<Session> Sessions;
+
+    for (SocketHandle hClient = Server.Accept(); hClient != InvalidSocket; hClient = Server.Accept())
+    {
+        // join the sessions of disconnected clients
+        for (auto it = Sessions.begin(); it != Sessions.end();)
+        {
+            if (it->bDone)
+            {
+                it->Thread.join();
+                it = Sessions.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        Session& S = Sessions.emplace_back();
+        S.Thread = std::thread([this, hClient, &S]()
+        {
+            {
+                SocketStream Stream(hClient);
+                Serve(Stream, Stream);
+            }
+            S.bDone = true;
+        });
+    }
+
+    HLOGE("Failed to accept clients on %s", WCSTR(_Path.string()));
+    Server.Close();
+
+    // the remaining clients are served until they disconnect
+    for (Session& S : Sessions)
+    {
+        S.Thread.join();
+    }
+
+    return 1;
+}
+
+void Daemon::Serve(std::istream& _In, std::ostream& _Out)
+{
+    std::string sLine;
+    while (std::getline(_In, sLine))
+    {
+        if (sLine.empty() == false && sLine.back() == '\r')
+        {
+            sLine.pop_back();
+        }
+
+        if (sLine == "quit")
+            break;
+
+        if (sLine.empty() == false)
+        {
+            // a failed request ends its session, the tree it acquired is not reused
+            bool bContinue = false;
+            try
+            {
+                bContinue = Handle(sLine, _In, _Out);
+            }
+            catch (const std::exception& e)
+            {
+                HLOGE("Request %s failed: %s", WCSTR(sLine), WCSTR(std::string(e.what())));
+                _Out << "error " << e.what() << '\n';
+            }
+
+            if (bContinue == false)
+                break;
+        }
+
+        _Out.flush();
+    }
+
+    _Out.flush();
+}
+
+bool Daemon::Handle(const std::string& _sRequest, std::istream& _In, std::ostream& _Out)
+{
+    std::vector<std::string> Args;
+    std::istringstream Tokens(_sRequest);
+    for (std::string sToken; Tokens >> sToken;)
+    {
+        Args.push_back(sToken);
+    }
+
+    // inline source, removed before the options are parsed
+    std::string sInline;
+    bool bInline = false;
+    if (const auto it = std::find(Args.begin(), Args.end(), "-dot"); it != Args.end())
+    {
+        // the dot text can not be skipped without a valid size, it would be read as requests
+        const bool bNumber = it + 1 != Args.end() && (it + 1)->empty() == false &&
+            std::all_of((it + 1)->begin(), (it + 1)->end(), [](const char c) { return c >= '0' && c <= '9'; });
+        if (bNumber == false)
+        {
+            _Out << "error -dot needs the size of the dot text\n";
+            return false;
+        }
+
+        const uint64_t uSize = ParseNumber(*(it + 1));
+        if (uSize > uMaxInlineSize)
+        {
+            _Out << "error dot text exceeds " << uMaxInlineSize << " bytes\n";
+            return false;
+        }
+
+        sInline.resize(static_cast<size_t>(uSize));
+        _In.read(sInline.data(), static_cast<std::streamsize>(sInline.size()));
+        if (static_cast<size_t>(_In.gcount()) != sInline.size())
+        {
+            _Out << "error incomplete dot text\n";
+            return false;
+        }
+
+        Args.erase(it, it + 2);
+        bInline = true;
+    }
+
+    DriverOptions Options;
+    ParseArguments(Args, Options);
+
+    // -loglevel and -quiet only apply to this request, the daemon level still caps them
+    const ScopedLogLimit Limit(Options.kLogLevel);
+
+    if (Options.kOrder == 0u)
+    {
+        Options.kOrder = NodeOrdering::Order_DepthFirstDom;
+    }
+
+    MappedFile File;
+    std::string_view sSource = sInline;
+    std::string sInputName = "inline";
+
+    if (bInline == false)
+    {
+        if (File.Open(Options.InputPath) == false)
+        {
+            _Out << "error failed to map " << Options.InputPath.string() << '\n';
+            return true;
+        }
+
+        sSource = std::string_view(reinterpret_cast<const char*>(File.GetData()), File.GetSize());
+        sInputName = Options.InputPath.string();
+    }
+
+    const std::vector<std::string_view> Graphs = Dot2CFG::SplitGraphs(sSource);
+    if (Graphs.empty())
+    {
+        _Out << "error no graph in " << sInputName << '\n';
+        return true;
+    }
+
+    const std::vector<uint32_t> Orderings = GetOrderings(Options);
+    OpenTree* pTree = AcquireTree(Options.bVerify);
+    RegionReconvergence* pRegions = Options.bRegions ? AcquireRegions(Options.bVerify) : nullptr;
+    if (pRegions != nullptr)
+    {
+        pRegions->LimitWorkers(Options.uWorkers);
+    }
+
+    std::ostringstream Stats;
+    CachedResult Result;
+    uint32_t uTasks = 0u;
+    bool bParsed = true;
+
+    std::vector<uint64_t> Binary; // parsed once, loaded by every ordering
+
+    for (size_t g = 0u; g < Graphs.size() && bParsed; ++g)
+    {
+        Function Parsed = Dot2CFG::Convert(Graphs[g]);
+
+        // without the virtual entry block
+        if (Parsed.GetCFG().GetNodes().size() < 2u)
+        {
+            bParsed = false;
+            break;
+        }
+
+        if (Parsed.EnforceUniqueEntryPoint() == false || Parsed.EnforceUniqueExitPoint() == false || StoreFunction(Parsed, Binary) == false)
+            continue;
+
+        for (const uint32_t uOrder : Orderings)
+        {
+            const auto Start = std::chrono::steady_clock::now();
+
+            Function func = LoadFunction(Binary);
+
+            TaskOutput Output;
+            const ReconvergeStats TaskStats = dot2ll(func, sInputName, uOrder, Options.bReconv, {}, Options.bVirtualFront, Options.sCustomOrder, *pTree, pRegions,
+                Options.bReport, Options.bBitcode, Options.bBinary, Options.bSPIRV, Options.bCost, Options.bSimulate ? &Options.Simulation : nullptr, Output);
+
+            func.Finalize();
+            const CostEstimate Cost = CostModel::Estimate(func);
+            const auto Duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start);
+
+            const std::wstring& sOrder = OrderNames[uOrder];
+            Stats << "stats " << func.GetName() << ' ' << std::string(sOrder.begin(), sOrder.end()) << ' ' << CostModel::Format(Cost) << ", " << Duration.count() << " us"
+                << (TaskStats.bValid == false ? ", failed" : TaskStats.bReconverging ? "" : ", not reconverging") << '\n';
+            Output.Export(Result);
+            ++uTasks;
+        }
+    }
+
+    ReleaseTree(pTree, Options.bVerify);
+    if (pRegions != nullptr)
+    {
+        ReleaseRegions(pRegions, Options.bVerify);
+    }
+
+    if (bParsed == false)
+    {
+        _Out << "error failed to parse " << sInputName << '\n';
+        return true;
+    }
+
+    _Out << "ok " << Result.Files.size() << ' ' << uTasks << '\n' << Stats.str();
+    for (const CachedFile& F : Result.Files)
+    {
+        _Out << "file " << F.sData.size() << ' ' << F.sName << '\n';
+        _Out.write(F.sData.data(), static_cast<std::streamsize>(F.sData.size()));
+        _Out << '\n';
+    }
+
+    return true;
+}
+
+OpenTree* Daemon::AcquireTree(const bool _bVerify)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    std::vector<OpenTree*>& Free = m_FreeTrees[_bVerify];
+
+    if (Free.empty())
+    {
+        // no debug dumps, concurrent sessions would overwrite them
+        return m_Trees.emplace_back(std::make_unique<OpenTree>(true, std::string(), _bVerify)).get();
+    }
+
+    OpenTree* pTree = Free.back();
+    Free.pop_back();
+    return pTree;
+}
+
+void Daemon::ReleaseTree(OpenTree* _pTree, const bool _bVerify)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_FreeTrees[_bVerify].push_back(_pTree);
+}
+
+RegionReconvergence* Daemon::AcquireRegions(const bool _bVerify)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    std::vector<RegionReconvergence*>& Free = m_FreeRegions[_bVerify];
+
+    if (Free.empty())
+    {
+        return m_Regions.emplace_back(std::make_unique<RegionReconvergence>(m_uWorkers, _bVerify)).get();
+    }
+
+    RegionReconvergence* pRegions = Free.back();
+    Free.pop_back();
+    return pRegions;
+}
+
+void Daemon::ReleaseRegions(RegionReconvergence* _pRegions, const bool _bVerify)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_FreeRegions[_bVerify].push_back(_pRegions);
+}
@@ -0,0 +1,468 @@
+#include "Dot2CFG.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+    enum EDotToken : uint32_t
+    {
+        kDotToken_End = 0u,
+        kDotToken_Id, // identifier, numeral, quoted string (without quotes) or html string (without brackets)
+        kDotToken_Edge, // -> or --
+        kDotToken_OpenBrace,
+        kDotToken_CloseBrace,
+        kDotToken_OpenBracket,
+        kDotToken_CloseBracket,
+        kDotToken_Assign,
+        kDotToken_Invalid
+    };
+
+    struct DotToken
+    {
+        EDotToken kType = kDotToken_End;
+        std::string_view sText;
+    };
+
+    // tokens are views into the source, separators and comments are skipped
+    class DotTokenizer
+    {
+    public:
+        DotTokenizer(const std::string_view _sSource) : m_sSource(_sSource) {}
+
+        const DotToken& Peek()
+        {
+            if (m_bPeeked == false)
+            {
+                m_Peeked = Read();
+                m_bPeeked = true;
+            }
+            return m_Peeked;
+        }
+
+        DotToken Next()
+        {
+            Peek();
+            m_bPeeked = false;
+            return m_Peeked;
+        }
+
+        // offset of the last token and the end of the last token in the source
+        size_t GetTokenStart() const { return m_uTokenStart; }
+        size_t GetTokenEnd() const { return m_uPos; }
+
+        // line of the last token, only used for errors
+        uint32_t GetLine() const
+        {
+            const size_t uEnd = std::min(m_uTokenStart, m_sSource.size());
+            return 1u + static_cast<uint32_t>(std::count(m_sSource.begin(), m_sSource.begin() + uEnd, '\n'));
+        }
+
+    private:
+        static bool IsIdChar(const char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.' || static_cast<uint8_t>(c) >= 0x80u;
+        }
+
+        void SkipSeparators()
+        {
+            const size_t uSize = m_sSource.size();
+
+            while (m_uPos < uSize)
+            {
+                const char c = m_sSource[m_uPos];
+
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ';' || c == ',')
+                {
+                    ++m_uPos;
+                }
+                else if (c == '#' && (m_uPos == 0u || m_sSource[m_uPos - 1u] == '\n'))
+                {
+                    // preprocessor output line
+                    m_uPos = std::min(m_sSource.find('\n', m_uPos), uSize);
+                }
+                else if (c == '/' && m_uPos + 1u < uSize && m_sSource[m_uPos + 1u] == '/')
+                {
+                    m_uPos = std::min(m_sSource.find('\n', m_uPos), uSize);
+                }
+                else if (c == '/' && m_uPos + 1u < uSize && m_sSource[m_uPos + 1u] == '*')
+                {
+                    const size_t uEnd = m_sSource.find("*/", m_uPos + 2u);
+                    m_uPos = uEnd == std::string_view::npos ? uSize : uEnd + 2u;
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        DotToken Read()
+        {
+            SkipSeparators();
+            m_uTokenStart = m_uPos;
+
+            const size_t uSize = m_sSource.size();
+            if (m_uPos >= uSize)
+                return { kDotToken_End, {} };
+
+            const char c = m_sSource[m_uPos];
+            const size_t uStart = m_uPos;
+
+            switch (c)
+            {
+            case '{': ++m_uPos; return { kDotToken_OpenBrace, m_sSource.substr(uStart, 1u) };
+            case '}': ++m_uPos; return { kDotToken_CloseBrace, m_sSource.substr(uStart, 1u) };
+            case '[': ++m_uPos; return { kDotToken_OpenBracket, m_sSource.substr(uStart, 1u) };
+            case ']': ++m_uPos; return { kDotToken_CloseBracket, m_sSource.substr(uStart, 1u) };
+            case '=': ++m_uPos; return { kDotToken_Assign, m_sSource.substr(uStart, 1u) };
+            case '"':
+            {
+                // escaped characters are kept as they are
+                size_t uEnd = uStart + 1u;
+                while (uEnd < uSize && m_sSource[uEnd] != '"')
+                {
+                    uEnd += m_sSource[uEnd] == '\\' ? 2u : 1u;
+                }
+
+                if (uEnd >= uSize)
+                    return { kDotToken_Invalid, m_sSource.substr(uStart) };
+
+                m_uPos = uEnd + 1u;
+                return { kDotToken_Id, m_sSource.substr(uStart + 1u, uEnd - uStart - 1u) };
+            }
+            case '<':
+            {
+                uint32_t uDepth = 0u;
+                size_t uEnd = uStart;
+                for (; uEnd < uSize; ++uEnd)
+                {
+                    uDepth += m_sSource[uEnd] == '<';
+                    uDepth -= m_sSource[uEnd] == '>';
+                    if (uDepth == 0u)
+                        break;
+                }
+
+                if (uEnd >= uSize)
+                    return { kDotToken_Invalid, m_sSource.substr(uStart) };
+
+                m_uPos = uEnd + 1u;
+                return { kDotToken_Id, m_sSource.substr(uStart + 1u, uEnd - uStart - 1u) };
+            }
+            case '-':
+                if (m_uPos + 1u < uSize && (m_sSource[m_uPos + 1u] == '>' || m_sSource[m_uPos + 1u] == '-'))
+                {
+                    m_uPos += 2u;
+                    return { kDotToken_Edge, m_sSource.substr(uStart, 2u) };
+                }
+                // negative numeral
+                ++m_uPos;
+                break;
+            default:
+                if (IsIdChar(c) == false)
+                {
+                    ++m_uPos;
+                    return { kDotToken_Invalid, m_sSource.substr(uStart, 1u) };
+                }
+                break;
+            }
+
+            while (m_uPos < uSize && IsIdChar(m_sSource[m_uPos]))
+            {
+                ++m_uPos;
+            }
+
+            return { kDotToken_Id, m_sSource.substr(uStart, m_uPos - uStart) };
+        }
+
+    private:
+        std::string_view m_sSource;
+        size_t m_uPos = 0u;
+        size_t m_uTokenStart = 0u;
+        DotToken m_Peeked;
+        bool m_bPeeked = false;
+    };
+
+    struct DotEdgeRecord
+    {
+        uint32_t uSource;
+        uint32_t uTarget;
+        bool bUniform;
+    };
+} // anonymous namespace
+
+Function Dot2CFG::Convert(const std::string_view _sSource, const std::string& _sUniformAttribKey, const std::string& _sUniformAttribValue)
+{
+    DotTokenizer Tokens(_sSource);
+
+    const auto Error = [&](const std::string& sMessage) -> Function
+    {
+        HLOGE("Line %u: %s", Tokens.GetLine(), WCSTR(sMessage));
+        return {};
+    };
+
+    DotToken Token = Tokens.Next();
+    if (Token.kType == kDotToken_Id && Token.sText == "strict")
+    {
+        Token = Tokens.Next();
+    }
+
+    if (Token.kType != kDotToken_Id || (Token.sText != "digraph" && Token.sText != "graph"))
+        return Error("expected digraph");
+
+    std::string_view sName;
+    if (Tokens.Peek().kType == kDotToken_Id)
+    {
+        sName = Tokens.Next().sText;
+    }
+
+    if (Tokens.Next().kType != kDotToken_OpenBrace)
+        return Error("expected {");
+
+    // node names in order of their first appearance, edges in source order
+    std::unordered_map<std::string_view, uint32_t> Indices;
+    std::vector<std::string_view> Names;
+    std::vector<DotEdgeRecord> Edges;
+
+    const auto GetIndex = [&](const std::string_view sNode) -> uint32_t
+    {
+        auto [it, bNew] = Indices.try_emplace(sNode, static_cast<uint32_t>(Names.size()));
+        if (bNew)
+        {
+            Names.push_back(sNode);
+        }
+        return it->second;
+    };
+
+    // returns -1 if the uniform attribute is not set, otherwise if the last value matches
+    const auto ParseAttributes = [&](int32_t& iUniform) -> bool
+    {
+        while (Tokens.Peek().kType == kDotToken_OpenBracket)
+        {
+            Tokens.Next();
+            for (Token = Tokens.Next(); Token.kType == kDotToken_Id; Token = Tokens.Next())
+            {
+                std::string_view sValue;
+                if (Tokens.Peek().kType == kDotToken_Assign)
+                {
+                    Tokens.Next();
+                    const DotToken Value = Tokens.Next();
+                    if (Value.kType != kDotToken_Id)
+                        return false;
+                    sValue = Value.sText;
+                }
+
+                if (Token.sText == _sUniformAttribKey)
+                {
+                    iUniform = sValue == _sUniformAttribValue ? 1 : 0;
+                }
+            }
+
+            if (Token.kType != kDotToken_CloseBracket)
+                return false;
+        }
+
+        return true;
+    };
+
+    uint32_t uDepth = 0u; // nested subgraphs, their nodes and edges belong to the graph
+    for (Token = Tokens.Next(); Token.kType != kDotToken_CloseBrace || uDepth != 0u; Token = Tokens.Next())
+    {
+        int32_t iUniform = -1;
+
+        switch (Token.kType)
+        {
+        case kDotToken_CloseBrace:
+            --uDepth;
+            continue;
+        case kDotToken_OpenBrace:
+            ++uDepth;
+            continue;
+        case kDotToken_Id:
+            break;
+        case kDotToken_End:
+            return Error("unexpected end of graph");
+        default:
+            return Error("unexpected token");
+        }
+
+        if (Token.sText == "subgraph")
+        {
+            if (Tokens.Peek().kType == kDotToken_Id)
+                Tokens.Next();
+            if (Tokens.Next().kType != kDotToken_OpenBrace)
+                return Error("expected { after subgraph");
+            ++uDepth;
+            continue;
+        }
+
+        // default attributes of graph, node and edge statements
+        if ((Token.sText == "graph" || Token.sText == "node" || Token.sText == "edge") && Tokens.Peek().kType == kDotToken_OpenBracket)
+        {
+            if (ParseAttributes(iUniform) == false)
+                return Error("invalid attribute list");
+            continue;
+        }
+
+        // graph attribute
+        if (Tokens.Peek().kType == kDotToken_Assign)
+        {
+            Tokens.Next();
+            if (Tokens.Next().kType != kDotToken_Id)
+                return Error("expected attribute value");
+            continue;
+        }
+
+        // node statement or edge chain, the attributes apply to all edges of the chain
+        uint32_t uNode = GetIndex(Token.sText);
+        const size_t uFirstEdge = Edges.size();
+
+        while (Tokens.Peek().kType == kDotToken_Edge)
+        {
+            Tokens.Next();
+            const DotToken Target = Tokens.Next();
+            if (Target.kType != kDotToken_Id)
+                return Error("expected node after edge, subgraph targets are not supported");
+
+            const uint32_t uTarget = GetIndex(Target.sText);
+            Edges.push_back({ uNode, uTarget, false });
+            uNode = uTarget;
+        }
+
+        if (ParseAttributes(iUniform) == false)
+            return Error("invalid attribute list");
+
+        for (size_t e = uFirstEdge; e < Edges.size(); ++e)
+        {
+            Edges[e].bUniform = iUniform == 1;
+        }
+    }
+
+    // successors by source node in source order
+    std::vector<uint32_t> Offsets(Names.size() + 1u, 0u);
+    for (const DotEdgeRecord& Edge : Edges)
+    {
+        ++Offsets[Edge.uSource + 1u];
+    }
+    for (size_t n = 0u; n < Names.size(); ++n)
+    {
+        Offsets[n + 1u] += Offsets[n];
+    }
+
+    std::vector<const DotEdgeRecord*> Successors(Edges.size());
+    {
+        std::vector<uint32_t> Next(Offsets.begin(), Offsets.end() - 1);
+        for (const DotEdgeRecord& Edge : Edges)
+        {
+            Successors[Next[Edge.uSource]++] = &Edge;
+        }
+    }
+
+    // same creation order as Convert(DotGraph): each node followed by its not yet created successors
+    Function func{ std::string(sName) };
+    ControlFlowGraph& cfg = func.GetCFG();
+    std::vector<BasicBlock*> Blocks(Names.size(), nullptr);
+
+    const auto AddNode = [&](const uint32_t uNode) -> BasicBlock*
+    {
+        if (Blocks[uNode] == nullptr)
+        {
+            Blocks[uNode] = cfg.NewNode(std::string(Names[uNode]));
+        }
+        return Blocks[uNode];
+    };
+
+    for (uint32_t n = 0u; n < Names.size(); ++n)
+    {
+        BasicBlock* pNode = AddNode(n);
+
+        BasicBlock* pTrueSucc = nullptr;
+        BasicBlock* pFalseSucc = nullptr;
+
+        const uint32_t uSuccessors = Offsets[n + 1u] - Offsets[n];
+        if (uSuccessors > 0u)
+        {
+            pNode->SetDivergent(Successors[Offsets[n]]->bUniform == false);
+            pTrueSucc = AddNode(Successors[Offsets[n]]->uTarget);
+        }
+        if (uSuccessors == 2u)
+        {
+            pFalseSucc = AddNode(Successors[Offsets[n] + 1u]->uTarget);
+        }
+        else if (uSuccessors > 2u)
+        {
+            HLOGE("Too many successors for node %s", WCSTR(pNode->GetName()));
+            return {};
+        }
+
+        if (pTrueSucc != nullptr && pFalseSucc != nullptr)
+        {
+            Instruction* pConstNull = func.Constant(0u);
+            Instruction* pType = cfg.GetInstruction(pConstNull->GetResultTypeId());
+
+            Instruction* pParam = func.AddParameter(pType);
+            pParam->SetAlias("in_" + pNode->GetName());
+
+            Instruction* pCondition = pNode->AddInstruction()->Equal(pParam, pConstNull);
+            pCondition->SetAlias("cc_" + pNode->GetName());
+
+            pNode->AddInstruction()->BranchCond(pCondition, pTrueSucc, pFalseSucc);
+
+            if (pNode->IsDivergent())
+            {
+                pParam->Decorate({ kDecoration_Divergent });
+            }
+        }
+        else if (pTrueSucc != nullptr)
+        {
+            pNode->AddInstruction()->Branch(pTrueSucc);
+        }
+    }
+
+    return func;
+}
+
+Function Dot2CFG::ConvertFile(const std::filesystem::path& _DotFile, const std::string& _sUniformAttribKey, const std::string& _sUniformAttribValue)
+{
+    MappedFile File(_DotFile);
+    if (File.IsOpen() == false)
+    {
+        HLOGE("Failed to map %s", WCSTR(_DotFile));
+        return {};
+    }
+
+    return Convert(std::string_view(reinterpret_cast<const char*>(File.GetData()), File.GetSize()), _sUniformAttribKey, _sUniformAttribValue);
+}
+
+std::vector<std::string_view> Dot2CFG::SplitGraphs(const std::string_view _sSource)
+{
+    std::vector<std::string_view> Graphs;
+    DotTokenizer Tokens(_sSource);
+
+    // only braces are matched, Convert reports malformed graphs
+    for (DotToken Token = Tokens.Next(); Token.kType != kDotToken_End; Token = Tokens.Next())
+    {
+        const size_t uStart = Tokens.GetTokenStart();
+
+        while (Token.kType != kDotToken_End && Token.kType != kDotToken_OpenBrace)
+        {
+            Token = Tokens.Next();
+        }
+
+        for (uint32_t uDepth = 1u; uDepth != 0u && Token.kType != kDotToken_End;)
+        {
+            Token = Tokens.Next();
+            uDepth += Token.kType == kDotToken_OpenBrace;
+            uDepth -= Token.kType == kDotToken_CloseBrace;
+        }
+
+        // an unterminated graph takes the rest of the source
+        const size_t uEnd = Token.kType == kDotToken_End ? _sSource.size() : Tokens.GetTokenEnd();
+        Graphs.push_back(_sSource.substr(uStart, uEnd - uStart));
+
+        if (Token.kType == kDotToken_End)
+            break;
+    }
+
+    return Graphs;
+}
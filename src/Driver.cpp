@@ -0,0 +1,371 @@
+#include "Driver.h"
+#include "OpenTree.h"
+#include "Reconvergence.h"
+#include "CheckReconvergence.h"
+#include "CostModel.h"
+#include "FunctionBinary.h"
+#include "LogLevel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+const std::wstring OrderNames[NodeOrdering::Order_NumOf] =
+{
+    L"DepthFirst",
+    L"DepthFirstDom",
+    L"BreadthFirst",
+    L"BreadthFirstDom",
+    L"PostOrder",
+    L"ReversePostOrder",
+    L"DominanceRegion",
+    L"Custom"
+};
+
+const std::string OrderSuffixes[NodeOrdering::Order_NumOf] =
+{
+    "_df",
+    "_dfd",
+    "_bf",
+    "_bfd",
+    "_pot",
+    "_rpot",
+    "_domreg",
+    "_custom"
+};
+
+uint64_t ParseNumber(const std::string& _sValue)
+{
+    return std::strtoull(_sValue.c_str(), nullptr, 10);
+}
+
+void ParseArguments(const std::vector<std::string>& _Args, DriverOptions& _Options)
+{
+    for (size_t i = 0u; i < _Args.size(); ++i)
+    {
+        const std::string& token = _Args[i];
+
+        if (token == "-reconverge" || token == "-r")
+        {
+            _Options.bReconv = true;
+        }
+        else if (token == "-depthfirst" || token == "-df")
+        {
+            _Options.kOrder |= NodeOrdering::Order_DepthFirst;
+        }
+        else if (token == "-depthfirstdom" || token == "-dfd")
+        {
+            _Options.kOrder |= NodeOrdering::Order_DepthFirstDom;
+        }
+        else if (token == "-breadthfirst" || token == "-bf")
+        {
+            _Options.kOrder |= NodeOrdering::Order_BreadthFirst;
+        }
+        else if (token == "-breadthfirstdom" || token == "-bfd")
+        {
+            _Options.kOrder |= NodeOrdering::Order_BreadthFirstDom;
+        }
+        else if (token == "-postorder" || token == "-pot")
+        {
+            _Options.kOrder |= NodeOrdering::Order_PostOrder;
+        }
+        else if (token == "-reversepostorder" || token == "-rpot")
+        {
+            _Options.kOrder |= NodeOrdering::Order_ReversePostOrder;
+        }
+        else if (token == "-dominanceregion" || token == "-domreg")
+        {
+            _Options.kOrder |= NodeOrdering::Order_DominanceRegion;
+        }
+        else if (token == "-all")
+        {
+            _Options.kOrder = NodeOrdering::Order_All;
+        }
+        else if (token == "-custom" && (i + 1) < _Args.size())
+        {
+            _Options.kOrder |= NodeOrdering::Order_Custom;
+            _Options.sCustomOrder = _Args[++i];
+        }
+        else if (token == "-virtualfront")
+        {
+            _Options.bVirtualFront = true;
+        }
+        else if (token == "-out" && (i + 1) < _Args.size())
+        {
+            _Options.OutputPath = _Args[++i];
+        }
+        else if (token == "-in" && (i + 1) < _Args.size())
+        {
+            _Options.InputPath = _Args[++i];
+        }
+        else if (token == "-loglevel" && (i + 1) < _Args.size())
+        {
+            _Options.kLogLevel = static_cast<ELogLevel>(std::min<uint32_t>(ParseNumber(_Args[++i]), kLogLevel_Verbose));
+        }
+        else if (token == "-j" && (i + 1) < _Args.size())
+        {
+            // 0 uses all cores
+            _Options.uWorkers = static_cast<uint32_t>(ParseNumber(_Args[++i]));
+            if (_Options.uWorkers == 0u)
+            {
+                _Options.uWorkers = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else if (token == "-inflight" && (i + 1) < _Args.size())
+        {
+            // parsed inputs kept in memory at once, 0 uses 4 per worker
+            _Options.uMaxInFlight = static_cast<uint32_t>(ParseNumber(_Args[++i]));
+        }
+        else if (token == "-cache" && (i + 1) < _Args.size())
+        {
+            // reuse the outputs of unchanged inputs from previous runs with the same options
+            _Options.CachePath = _Args[++i];
+        }
+        else if (token == "-daemon")
+        {
+            // keep running and serve the requests read from stdin, see Daemon
+            _Options.bDaemon = true;
+        }
+        else if (token == "-socket" && (i + 1) < _Args.size())
+        {
+            // keep running and serve the clients of a Unix domain socket, see Daemon
+            _Options.SocketPath = _Args[++i];
+        }
+        else if (token == "-dump" && (i + 1) < _Args.size())
+        {
+            // write the OT and CFG of every OpenTree step, a subdirectory per worker if there are several
+            _Options.DumpPath = _Args[++i];
+        }
+        else if (token == "-compare")
+        {
+            // warn if the selected orderings produce different block orders for an input
+            _Options.bCompare = true;
+        }
+        else if (token == "-regions")
+        {
+            // reconverge the SESE regions of a function concurrently instead of the files
+            _Options.bRegions = true;
+        }
+        else if (token == "-report")
+        {
+            // write the reconvergence violations of each output to <name>_violations.tsv
+            _Options.bReport = true;
+        }
+        else if (token == "-verify")
+        {
+            // check the OT invariants after every step
+            _Options.bVerify = true;
+        }
+        else if (token == "-bc")
+        {
+            // also write the LLVM bitcode of each output to <name>.bc
+            _Options.bBitcode = true;
+        }
+        else if (token == "-bin")
+        {
+            // also write the finalized function in the binary format to <name>.func
+            _Options.bBinary = true;
+        }
+        else if (token == "-spirv")
+        {
+            // also write a Vulkan fragment shader of each output to <name>.spv and its assembly to <name>.spvasm
+            _Options.bSPIRV = true;
+        }
+        else if (token == "-cost")
+        {
+            // log the static cost estimate of the input and output functions and write <name>_cost.tsv
+            _Options.bCost = true;
+        }
+        else if (token == "-simulate")
+        {
+            // execute the input and output functions on a wave, see -lanes, -seed and -simvalue
+            _Options.bSimulate = true;
+        }
+        else if (token == "-lanes" && (i + 1) < _Args.size())
+        {
+            _Options.Simulation.uLanes = static_cast<uint32_t>(ParseNumber(_Args[++i]));
+        }
+        else if (token == "-seed" && (i + 1) < _Args.size())
+        {
+            _Options.Simulation.uSeed = ParseNumber(_Args[++i]);
+        }
+        else if (token == "-simvalue" && (i + 1) < _Args.size())
+        {
+            // in_N0=0,1,... one value for all lanes or one per lane
+            const std::string sValue = _Args[++i];
+            const size_t uAssign = sValue.find('=');
+            if (uAssign != std::string::npos)
+            {
+                std::vector<uint64_t>& Values = _Options.Simulation.Values[sValue.substr(0u, uAssign)];
+                for (size_t uStart = uAssign + 1u, uEnd = 0u; uStart < sValue.size(); uStart = uEnd + 1u)
+                {
+                    uEnd = std::min(sValue.find(',', uStart), sValue.size());
+                    Values.push_back(ParseNumber(sValue.substr(uStart, uEnd - uStart)));
+                }
+            }
+        }
+        else if (token == "-quiet" || token == "-q")
+        {
+            _Options.kLogLevel = kLogLevel_Warning;
+        }
+        else if (i == 0u)
+        {
+            _Options.InputPath = token;
+        }
+    }
+}
+
+std::vector<uint32_t> GetOrderings(const DriverOptions& _Options)
+{
+    std::vector<uint32_t> Orderings;
+    for (uint32_t i = 0u; i < NodeOrdering::Order_NumOf; ++i)
+    {
+        const auto kType = NodeOrdering::OrderType((1 << i));
+        if ((_Options.kOrder & kType) == kType)
+        {
+            if (kType == NodeOrdering::Order_Custom && _Options.sCustomOrder.empty())
+                continue;
+
+            Orderings.push_back(i);
+        }
+    }
+    return Orderings;
+}
+
+bool StoreFunction(const Function& _Func, std::vector<uint64_t>& _Binary)
+{
+    std::ostringstream Stream;
+    if (FunctionBinary::Write(_Func, Stream) == false)
+        return false;
+
+    const std::string sData = Stream.str();
+    _Binary.assign((sData.size() + 7u) / 8u, 0u);
+    std::memcpy(_Binary.data(), sData.data(), sData.size());
+    return true;
+}
+
+Function LoadFunction(const std::vector<uint64_t>& _Binary)
+{
+    return FunctionBinary::Load(FunctionView(_Binary.data(), _Binary.size() * sizeof(uint64_t)));
+}
+
+ReconvergeStats dot2ll(Function& _Func, const std::string& _sInputName, const uint32_t _uOderIndex, const bool _bReconv, const std::filesystem::path& _sOutPath, const bool _bPutVirtualFront, const std::string& _sCustomOrder, OpenTree& _OT, RegionReconvergence* _pRegions, const bool _bReport, const bool _bBitcode, const bool _bBinary, const bool _bSPIRV, const bool _bCost, const SimulationOptions* _pSimulation, TaskOutput& _Output)
+{
+    const NodeOrdering::OrderType _kOrder{ 1u << _uOderIndex };
+
+    const bool bInputReconverging = CheckReconvergence::IsReconverging(_Func);
+
+    HLOGI("Processing %s '%s' [Order: %s Reconv: %s]", WCSTR(_sInputName), WCSTR(_Func.GetName()),
+        _kOrder == NodeOrdering::Order_Custom ? WCSTR(_sCustomOrder) : WCSTR(OrderNames[_uOderIndex]), bInputReconverging ? L"true" : L"false");
+
+    std::string sOutName = _Func.GetName();
+    // the input is written unchanged without -r
+    ReconvergeStats Stats;
+    Stats.bValid = true;
+    Stats.bInputReconverging = bInputReconverging;
+    Stats.bReconverging = bInputReconverging;
+
+    // dynamic cost of a wave executing the function, written to <name>_simulation.tsv per block
+    const auto Simulate = [&](const std::string& _sName)
+    {
+        WaveSimulator Simulator(*_pSimulation);
+        const SimulationStats Stats = Simulator.Run(_Func);
+
+        HLOGI("Simulated %s: %llu block executions, %llu serialized, %llu divergent branches, %.1f%% lane utilization%s", WCSTR(_sName),
+            Stats.uBlockExecutions, Stats.uSerializedExecutions, Stats.uDivergentBranches, Stats.GetLaneUtilization() * 100.0, Stats.bCompleted ? L"" : L" (aborted)");
+
+        WaveSimulator::WriteReport(_Func, Stats, _Output.Open(_sOutPath / (_sName + "_simulation.tsv")));
+    };
+
+    // static cost of the emitted code, written to <name>_cost.tsv
+    const auto Estimate = [&](const std::string& _sName)
+    {
+        const CostEstimate Cost = CostModel::Estimate(_Func);
+
+        HLOGI("Cost of %s: %s", WCSTR(_sName), WCSTR(CostModel::Format(Cost)));
+
+        std::ostream& report = _Output.Open(_sOutPath / (_sName + "_cost.tsv"));
+        CostModel::WriteReportHeader(report);
+        CostModel::WriteReport(_Func, Cost, report);
+    };
+
+    if (_bCost && _bReconv)
+    {
+        Estimate(sOutName + "_input");
+    }
+
+    if (_pSimulation != nullptr && _bReconv)
+    {
+        Simulate(sOutName + "_input");
+    }
+
+    if (_bReconv)
+    {
+        sOutName += "_reconv" + OrderSuffixes[_uOderIndex];
+
+        ReconvergeOptions Options;
+        Options.kOrder = _kOrder;
+        Options.sCustomOrder = _sCustomOrder;
+        Options.bPutVirtualFront = _bPutVirtualFront;
+        Options.kLogLevel = kLogLevel_Verbose; // limited by -loglevel
+
+        // nothing is written if the ordering is invalid or the verification failed
+        std::ostringstream Dot, Violations;
+        Options.Sinks.pDot = &Dot;
+        Options.Sinks.pViolations = _bReport ? &Violations : nullptr;
+
+        Stats = Reconvergence::Run(_Func, Options, &_OT, _pRegions);
+        if (Stats.bValid == false)
+            return Stats;
+
+        if (_bReport)
+        {
+            _Output.Open(_sOutPath / (sOutName + "_violations.tsv")) << Violations.str();
+        }
+
+        _Output.Open(_sOutPath / (sOutName + ".dot")) << Dot.str();
+    }
+
+    if (_bCost)
+    {
+        _Func.Finalize();
+        Estimate(sOutName);
+    }
+
+    if (_pSimulation != nullptr)
+    {
+        _Func.Finalize();
+        Simulate(sOutName);
+    }
+
+    ReconvergeSinks Sinks;
+    Sinks.pListing = &_Output.Open(_sOutPath / (sOutName + ".ll"));
+
+    if (_bBitcode)
+    {
+        Sinks.pBitcode = &_Output.Open(_sOutPath / (sOutName + ".bc"), std::ios::binary);
+    }
+
+    if (_bBinary)
+    {
+        Sinks.pBinary = &_Output.Open(_sOutPath / (sOutName + ".func"), std::ios::binary);
+    }
+
+    // nothing is written for a function the SPIR-V module can not represent
+    std::ostringstream SPIRV, SPIRVListing;
+    if (_bSPIRV)
+    {
+        Sinks.pSPIRV = &SPIRV;
+        Sinks.pSPIRVListing = &SPIRVListing;
+    }
+
+    Reconvergence::Serialize(_Func, Sinks);
+
+    if (_bSPIRV && SPIRVListing.tellp() > 0)
+    {
+        _Output.Open(_sOutPath / (sOutName + ".spv"), std::ios::binary) << SPIRV.str();
+        _Output.Open(_sOutPath / (sOutName + ".spvasm")) << SPIRVListing.str();
+    }
+
+    return Stats;
+}
@@ -102,7 +102,7 @@ bool Function::EnforceUniqueExitPoint()
 
     if (bSink == false)
     {
-        HERROR("No unique exite block found (possible cycle) in function %s", WCSTR(m_sName));    
+        HLOGE("No unique exite block found (possible cycle) in function %s", WCSTR(m_sName));    
     }
 
     return bSink;
@@ -163,7 +163,7 @@ void Function::Finalize()
     if (m_pConstantTypeBlock->GetTerminator() == nullptr)
     {
         BasicBlock* pSource = GetEntryBlock();
-        HASSERT(pSource != nullptr, "No valid/unique entry point found!");
+        HASSERT_SYNC(pSource != nullptr, "No valid/unique entry point found!");
         m_pConstantTypeBlock->AddInstruction()->Branch(pSource);
     }
 }
@@ -0,0 +1,437 @@
+#include "FunctionBinary.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace FunctionBinaryFormat;
+
+namespace
+{
+    // records are zeroed in place including their padding bytes, equal functions serialize to equal bytes
+    template <class T>
+    T& AppendZeroed(std::vector<T>& _Records)
+    {
+        T& Record = _Records.emplace_back();
+        std::memset(&Record, 0, sizeof(T));
+        return Record;
+    }
+
+    size_t Align8(const size_t _uOffset) { return (_uOffset + 7u) & ~size_t(7u); }
+
+    // CSR offsets need to start at 0, increase monotonically and end at _uNumValues
+    bool ValidOffsets(const uint32_t* _pOffsets, const uint32_t _uNumBlocks, const uint32_t _uNumValues)
+    {
+        if (_pOffsets[0] != 0u || _pOffsets[_uNumBlocks] != _uNumValues)
+            return false;
+
+        for (uint32_t i = 0u; i < _uNumBlocks; ++i)
+        {
+            if (_pOffsets[i] > _pOffsets[i + 1u])
+                return false;
+        }
+
+        return true;
+    }
+
+    bool ValidIds(const InstrId* _pIds, const uint32_t _uCount, const size_t _uBound)
+    {
+        for (uint32_t i = 0u; i < _uCount; ++i)
+        {
+            if (_pIds[i] >= _uBound)
+                return false;
+        }
+
+        return true;
+    }
+} // anonymous namespace
+
+FunctionView::FunctionView(const void* _pData, const size_t _uSize)
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>(_pData);
+
+    if (pBytes == nullptr || _uSize < sizeof(Header) || reinterpret_cast<uintptr_t>(pBytes) % 8u != 0u)
+        return;
+
+    const Header& H = *reinterpret_cast<const Header*>(pBytes);
+
+    if (H.uMagic != uMagic || H.uIdBytes != sizeof(InstrId))
+    {
+        HLOGE("Not a binary function with %u byte identifiers", static_cast<uint32_t>(sizeof(InstrId)));
+        return;
+    }
+
+    if (H.uVersion != uVersion)
+    {
+        HLOGE("Unsupported binary function version %u (expected %u)", H.uVersion, uVersion);
+        return;
+    }
+
+    const uint64_t Sizes[kSection_NumOf] =
+    {
+        uint64_t(H.uNumBlocks) * sizeof(BlockRecord),
+        (uint64_t(H.uNumBlocks) + 1u) * sizeof(uint32_t),
+        uint64_t(H.uNumSuccessors) * sizeof(InstrId),
+        (uint64_t(H.uNumBlocks) + 1u) * sizeof(uint32_t),
+        uint64_t(H.uNumPredecessors) * sizeof(InstrId),
+        (uint64_t(H.uNumBlocks) + 1u) * sizeof(uint32_t),
+        uint64_t(H.uNumInstructions) * sizeof(InstrId),
+        uint64_t(H.uNumInstructions) * sizeof(InstructionRecord),
+        uint64_t(H.uNumOperands) * sizeof(OperandRecord),
+        uint64_t(H.uNumDecorations) * sizeof(uint64_t),
+        uint64_t(H.uNumParameters) * sizeof(InstrId),
+        uint64_t(H.uNumTypes) * sizeof(Key),
+        uint64_t(H.uNumConstants) * sizeof(Key),
+        uint64_t(H.uStringBytes)
+    };
+
+    for (uint32_t s = 0u; s < kSection_NumOf; ++s)
+    {
+        if (H.Sections[s] % 8u != 0u || H.Sections[s] > _uSize || Sizes[s] > _uSize - H.Sections[s])
+        {
+            HLOGE("Binary function section %u exceeds the data", s);
+            return;
+        }
+    }
+
+    const auto Section = [&](const ESection _kSection) { return pBytes + H.Sections[_kSection]; };
+
+    const BlockRecord* pBlocks = reinterpret_cast<const BlockRecord*>(Section(kSection_Blocks));
+    const uint32_t* pSuccessorOffsets = reinterpret_cast<const uint32_t*>(Section(kSection_SuccessorOffsets));
+    const InstrId* pSuccessors = reinterpret_cast<const InstrId*>(Section(kSection_Successors));
+    const uint32_t* pPredecessorOffsets = reinterpret_cast<const uint32_t*>(Section(kSection_PredecessorOffsets));
+    const InstrId* pPredecessors = reinterpret_cast<const InstrId*>(Section(kSection_Predecessors));
+    const uint32_t* pBlockInstructionOffsets = reinterpret_cast<const uint32_t*>(Section(kSection_BlockInstructionOffsets));
+    const InstrId* pBlockInstructions = reinterpret_cast<const InstrId*>(Section(kSection_BlockInstructions));
+    const InstructionRecord* pInstructions = reinterpret_cast<const InstructionRecord*>(Section(kSection_Instructions));
+    const OperandRecord* pOperands = reinterpret_cast<const OperandRecord*>(Section(kSection_Operands));
+    const InstrId* pParameters = reinterpret_cast<const InstrId*>(Section(kSection_Parameters));
+    const Key* pTypes = reinterpret_cast<const Key*>(Section(kSection_Types));
+    const Key* pConstants = reinterpret_cast<const Key*>(Section(kSection_Constants));
+
+    const auto ValidString = [&](const String& _String) { return uint64_t(_String.uOffset) + _String.uLength <= H.uStringBytes; };
+
+    bool bValid = H.uNumBlocks > 0u && ValidString(H.Name) &&
+        (H.uReturnType == InvalidId || H.uReturnType < H.uNumInstructions) &&
+        (H.uUniqueSink == InvalidId || H.uUniqueSink < H.uNumBlocks) &&
+        ValidOffsets(pSuccessorOffsets, H.uNumBlocks, H.uNumSuccessors) && ValidIds(pSuccessors, H.uNumSuccessors, H.uNumBlocks) &&
+        ValidOffsets(pPredecessorOffsets, H.uNumBlocks, H.uNumPredecessors) && ValidIds(pPredecessors, H.uNumPredecessors, H.uNumBlocks) &&
+        ValidOffsets(pBlockInstructionOffsets, H.uNumBlocks, H.uNumInstructions) && ValidIds(pBlockInstructions, H.uNumInstructions, H.uNumInstructions) &&
+        ValidIds(pParameters, H.uNumParameters, H.uNumInstructions);
+
+    for (uint32_t i = 0u; i < H.uNumInstructions && bValid; ++i)
+    {
+        const InstructionRecord& I = pInstructions[i];
+        bValid = I.kInstruction <= kInstruction_Undefined && I.uBlock < H.uNumBlocks && ValidString(I.Alias) &&
+            uint64_t(I.uFirstOperand) + I.uNumOperands <= H.uNumOperands &&
+            uint64_t(I.uFirstDecoration) + I.uNumDecorations <= H.uNumDecorations;
+    }
+
+    // every instruction is listed exactly once, by the block it belongs to
+    for (uint32_t b = 0u; b < H.uNumBlocks && bValid; ++b)
+    {
+        const BlockRecord& B = pBlocks[b];
+        bValid = ValidString(B.Name) && (B.uTerminator == InvalidId || (B.uTerminator < H.uNumInstructions && pInstructions[B.uTerminator].uBlock == b));
+
+        for (uint32_t i = pBlockInstructionOffsets[b]; i < pBlockInstructionOffsets[b + 1u] && bValid; ++i)
+        {
+            bValid = pInstructions[pBlockInstructions[i]].uBlock == b;
+        }
+    }
+
+    std::vector<bool> Listed(bValid ? H.uNumInstructions : 0u, false);
+    for (uint32_t i = 0u; i < H.uNumInstructions && bValid; ++i)
+    {
+        bValid = Listed[pBlockInstructions[i]] == false;
+        Listed[pBlockInstructions[i]] = true;
+    }
+
+    for (uint32_t i = 0u; i < H.uNumOperands && bValid; ++i)
+    {
+        bValid = pOperands[i].kType <= kOperandType_BasicBlockId;
+    }
+
+    for (uint32_t i = 0u; i < H.uNumTypes && bValid; ++i)
+    {
+        bValid = pTypes[i].uId < H.uNumInstructions;
+    }
+
+    for (uint32_t i = 0u; i < H.uNumConstants && bValid; ++i)
+    {
+        bValid = pConstants[i].uId < H.uNumInstructions;
+    }
+
+    if (bValid == false)
+    {
+        HLOGE("Binary function is corrupted");
+        return;
+    }
+
+    m_pHeader = &H;
+    m_pBlocks = pBlocks;
+    m_pSuccessorOffsets = pSuccessorOffsets;
+    m_pSuccessors = pSuccessors;
+    m_pPredecessorOffsets = pPredecessorOffsets;
+    m_pPredecessors = pPredecessors;
+    m_pBlockInstructionOffsets = pBlockInstructionOffsets;
+    m_pBlockInstructions = pBlockInstructions;
+    m_pInstructions = pInstructions;
+    m_pOperands = pOperands;
+    m_pDecorations = reinterpret_cast<const uint64_t*>(Section(kSection_Decorations));
+    m_pParameters = pParameters;
+    m_pTypes = pTypes;
+    m_pConstants = pConstants;
+    m_pStrings = reinterpret_cast<const char*>(Section(kSection_Strings));
+}
+
+ArrayView<OperandRecord> FunctionView::GetOperands(const InstrId _uId) const
+{
+    const InstructionRecord& I = m_pInstructions[_uId];
+    return { m_pOperands + I.uFirstOperand, I.uNumOperands };
+}
+
+ArrayView<uint64_t> FunctionView::GetDecorations(const InstrId _uId) const
+{
+    const InstructionRecord& I = m_pInstructions[_uId];
+    return { m_pDecorations + I.uFirstDecoration, I.uNumDecorations };
+}
+
+bool FunctionBinary::Write(const Function& _Function, std::ostream& _OutStream)
+{
+    const ControlFlowGraph& cfg = _Function.GetCFG();
+    const std::vector<Instruction*>& Instrs = cfg.GetInstructions();
+
+    std::string Strings;
+    const auto AddString = [&](const std::string& _sString)
+    {
+        String Str{ static_cast<uint32_t>(Strings.size()), static_cast<uint32_t>(_sString.size()) };
+        Strings += _sString;
+        return Str;
+    };
+
+    std::vector<BlockRecord> Blocks;
+    std::vector<uint32_t> SuccessorOffsets = { 0u }, PredecessorOffsets = { 0u }, BlockInstructionOffsets = { 0u };
+    std::vector<InstrId> Successors, Predecessors, BlockInstructions, Parameters;
+    std::vector<InstructionRecord> Instructions(Instrs.size());
+    std::memset(Instructions.data(), 0, Instructions.size() * sizeof(InstructionRecord));
+    std::vector<OperandRecord> Operands;
+    std::vector<uint64_t> Decorations;
+    std::vector<Key> Types, Constants;
+
+    for (const BasicBlock& BB : cfg)
+    {
+        BlockRecord& B = AppendZeroed(Blocks);
+        B.Name = AddString(BB.GetName());
+        B.uFlags = (BB.IsSource() ? kBlockFlag_Source : 0u) | (BB.IsSink() ? kBlockFlag_Sink : 0u) |
+            (BB.GetDivergenceQualifier() ? kBlockFlag_Divergent : 0u) | (BB.IsVirtual() ? kBlockFlag_Virtual : 0u);
+        B.uTerminator = BB.GetTerminator() != nullptr ? BB.GetTerminator()->GetIdentifier() : InvalidId;
+
+        for (const BasicBlock* pSucc : BB.GetSuccesors())
+        {
+            Successors.push_back(pSucc->GetIdentifier());
+        }
+        SuccessorOffsets.push_back(static_cast<uint32_t>(Successors.size()));
+
+        for (const BasicBlock* pPred : BB.GetPredecessors())
+        {
+            Predecessors.push_back(pPred->GetIdentifier());
+        }
+        PredecessorOffsets.push_back(static_cast<uint32_t>(Predecessors.size()));
+
+        for (const Instruction& Instr : BB)
+        {
+            InstructionRecord& I = Instructions[Instr.GetIdentifier()];
+            I.kInstruction = Instr.GetInstruction();
+            I.uBlock = BB.GetIdentifier();
+            I.uResultTypeId = Instr.GetResultTypeId();
+            I.Alias = AddString(Instr.GetAlias());
+
+            I.uFirstOperand = static_cast<uint32_t>(Operands.size());
+            I.uNumOperands = static_cast<uint32_t>(Instr.GetOperands().size());
+            for (const Operand& Op : Instr.GetOperands())
+            {
+                OperandRecord& O = AppendZeroed(Operands);
+                O.kType = Op.kType;
+                O.uId = Op.uId;
+            }
+
+            I.uFirstDecoration = static_cast<uint32_t>(Decorations.size());
+            for (const Decoration& Deco : Instr.GetDecorations())
+            {
+                Decorations.push_back(Deco.uData);
+            }
+            I.uNumDecorations = static_cast<uint32_t>(Decorations.size()) - I.uFirstDecoration;
+
+            BlockInstructions.push_back(Instr.GetIdentifier());
+        }
+        BlockInstructionOffsets.push_back(static_cast<uint32_t>(BlockInstructions.size()));
+    }
+
+    if (BlockInstructions.size() != Instrs.size())
+    {
+        HLOGE("Function %s has instructions outside of its blocks", WCSTR(_Function.GetName()));
+        return false;
+    }
+
+    for (const Instruction* pParam : _Function.GetParameters())
+    {
+        Parameters.push_back(pParam->GetIdentifier());
+    }
+
+    // sorted by instruction, the map iteration order is not deterministic
+    const auto AddKeys = [](const std::unordered_map<uint64_t, Instruction*>& _Map, std::vector<Key>& _Keys)
+    {
+        std::vector<std::pair<InstrId, uint64_t>> Sorted;
+        for (const auto& [uHash, pInstr] : _Map)
+        {
+            Sorted.emplace_back(pInstr->GetIdentifier(), uHash);
+        }
+        std::sort(Sorted.begin(), Sorted.end());
+
+        for (const auto& [uId, uHash] : Sorted)
+        {
+            Key& K = AppendZeroed(_Keys);
+            K.uHash = uHash;
+            K.uId = uId;
+        }
+    };
+
+    AddKeys(_Function.m_Types, Types);
+    AddKeys(_Function.m_Constants, Constants);
+
+    Header H;
+    std::memset(&H, 0, sizeof(Header));
+    H.uMagic = uMagic;
+    H.uVersion = uVersion;
+    H.uIdBytes = sizeof(InstrId);
+    H.uCallingConvention = _Function.GetCallingConvention().uIdentifier;
+    H.Name = AddString(_Function.GetName());
+    H.uReturnType = _Function.GetReturnType() != nullptr ? _Function.GetReturnType()->GetIdentifier() : InvalidId;
+    H.uUniqueSink = _Function.m_pUniqueSink != nullptr ? _Function.m_pUniqueSink->GetIdentifier() : InvalidId;
+    H.uNumBlocks = static_cast<uint32_t>(Blocks.size());
+    H.uNumInstructions = static_cast<uint32_t>(Instructions.size());
+    H.uNumSuccessors = static_cast<uint32_t>(Successors.size());
+    H.uNumPredecessors = static_cast<uint32_t>(Predecessors.size());
+    H.uNumOperands = static_cast<uint32_t>(Operands.size());
+    H.uNumDecorations = static_cast<uint32_t>(Decorations.size());
+    H.uNumParameters = static_cast<uint32_t>(Parameters.size());
+    H.uNumTypes = static_cast<uint32_t>(Types.size());
+    H.uNumConstants = static_cast<uint32_t>(Constants.size());
+    H.uStringBytes = static_cast<uint32_t>(Strings.size());
+
+    const std::pair<const void*, size_t> Sections[kSection_NumOf] =
+    {
+        { Blocks.data(), Blocks.size() * sizeof(BlockRecord) },
+        { SuccessorOffsets.data(), SuccessorOffsets.size() * sizeof(uint32_t) },
+        { Successors.data(), Successors.size() * sizeof(InstrId) },
+        { PredecessorOffsets.data(), PredecessorOffsets.size() * sizeof(uint32_t) },
+        { Predecessors.data(), Predecessors.size() * sizeof(InstrId) },
+        { BlockInstructionOffsets.data(), BlockInstructionOffsets.size() * sizeof(uint32_t) },
+        { BlockInstructions.data(), BlockInstructions.size() * sizeof(InstrId) },
+        { Instructions.data(), Instructions.size() * sizeof(InstructionRecord) },
+        { Operands.data(), Operands.size() * sizeof(OperandRecord) },
+        { Decorations.data(), Decorations.size() * sizeof(uint64_t) },
+        { Parameters.data(), Parameters.size() * sizeof(InstrId) },
+        { Types.data(), Types.size() * sizeof(Key) },
+        { Constants.data(), Constants.size() * sizeof(Key) },
+        { Strings.data(), Strings.size() }
+    };
+
+    size_t uOffset = Align8(sizeof(Header));
+    for (uint32_t s = 0u; s < kSection_NumOf; ++s)
+    {
+        H.Sections[s] = uOffset;
+        uOffset = Align8(uOffset + Sections[s].second);
+    }
+
+    std::string Buffer(uOffset, '\0');
+    std::memcpy(Buffer.data(), &H, sizeof(Header));
+
+    for (uint32_t s = 0u; s < kSection_NumOf; ++s)
+    {
+        if (Sections[s].second != 0u)
+        {
+            std::memcpy(Buffer.data() + H.Sections[s], Sections[s].first, Sections[s].second);
+        }
+    }
+
+    _OutStream.write(Buffer.data(), Buffer.size());
+
+    return _OutStream.good();
+}
+
+Function FunctionBinary::Load(const FunctionView& _View)
+{
+    Function Func(std::string(_View.GetName()), CallingConvention{ _View.GetCallingConvention() });
+    ControlFlowGraph& cfg = Func.m_CFG;
+
+    // the virtual entry block is created by the function
+    for (uint32_t b = 1u; b < _View.GetNumBlocks(); ++b)
+    {
+        cfg.NewNode(std::string(_View.GetBlockName(b)));
+    }
+
+    cfg.m_Instructions.assign(_View.GetNumInstructions(), nullptr);
+
+    for (uint32_t b = 0u; b < _View.GetNumBlocks(); ++b)
+    {
+        BasicBlock& BB = cfg.m_Nodes[b];
+        const BlockRecord& B = _View.GetBlock(b);
+
+        BB.m_bSource = (B.uFlags & kBlockFlag_Source) != 0u;
+        BB.m_bSink = (B.uFlags & kBlockFlag_Sink) != 0u;
+        BB.m_bDivergent = (B.uFlags & kBlockFlag_Divergent) != 0u;
+        BB.m_bVirtual = (B.uFlags & kBlockFlag_Virtual) != 0u;
+
+        for (const InstrId uSucc : _View.GetSuccessors(b))
+        {
+            BB.m_Successors.push_back(&cfg.m_Nodes[uSucc]);
+        }
+
+        for (const InstrId uPred : _View.GetPredecessors(b))
+        {
+            BB.m_Predecessors.push_back(&cfg.m_Nodes[uPred]);
+        }
+
+        for (const InstrId uId : _View.GetBlockInstructions(b))
+        {
+            const InstructionRecord& I = _View.GetInstruction(uId);
+            Instruction& Instr = BB.m_Instructions.emplace_back(uId, &BB);
+            cfg.m_Instructions[uId] = &Instr;
+
+            Instr.kInstruction = static_cast<EInstruction>(I.kInstruction);
+            Instr.uResultTypeId = I.uResultTypeId;
+            Instr.sAlias = _View.GetAlias(uId);
+
+            for (const OperandRecord& Op : _View.GetOperands(uId))
+            {
+                Instr.Operands.emplace_back(static_cast<EOperandType>(Op.kType), Op.uId);
+            }
+
+            for (const uint64_t uDecoration : _View.GetDecorations(uId))
+            {
+                Instr.Decorations.emplace_back().uData = uDecoration;
+            }
+        }
+
+        BB.m_pTerminator = B.uTerminator != InvalidId ? cfg.m_Instructions[B.uTerminator] : nullptr;
+    }
+
+    for (const InstrId uParam : _View.GetParameters())
+    {
+        Func.m_Parameters.push_back(cfg.m_Instructions[uParam]);
+    }
+
+    for (const Key& K : _View.GetTypes())
+    {
+        Func.m_Types[K.uHash] = cfg.m_Instructions[K.uId];
+    }
+
+    for (const Key& K : _View.GetConstants())
+    {
+        Func.m_Constants[K.uHash] = cfg.m_Instructions[K.uId];
+    }
+
+    Func.m_pReturnType = _View.GetReturnType() != InvalidId ? cfg.m_Instructions[_View.GetReturnType()] : nullptr;
+    Func.m_pUniqueSink = _View.GetUniqueSink() != InvalidId ? &cfg.m_Nodes[_View.GetUniqueSink()] : nullptr;
+
+    return Func;
+}
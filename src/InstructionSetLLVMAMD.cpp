@@ -1,6 +1,231 @@
 #include "InstructionSetLLVMAMD.h"
+#include "BitstreamWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <map>
+#include <unordered_map>
 
 
+namespace
+{
+    template <class T>
+    void AppendNumber(std::string& _sOut, const T _Value)
+    {
+        char Buffer[24];
+        const std::to_chars_result Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), _Value);
+        _sOut.append(Buffer, Result.ptr);
+    }
+
+    // same digits as std::to_string(double), i.e. %f
+    void AppendFixed(std::string& _sOut, const double _fValue)
+    {
+        char Buffer[512];
+        const std::to_chars_result Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), _fValue, std::chars_format::fixed, 6);
+        _sOut.append(Buffer, Result.ptr);
+    }
+
+    // LLVM bitcode block ids and record codes, see llvm/Bitcode/LLVMBitCodes.h
+    enum EBitcodeBlock : uint32_t
+    {
+        kBitcodeBlock_Module = 8u,
+        kBitcodeBlock_ParamAttr = 9u,
+        kBitcodeBlock_ParamAttrGroup = 10u,
+        kBitcodeBlock_Constants = 11u,
+        kBitcodeBlock_Function = 12u,
+        kBitcodeBlock_Identification = 13u,
+        kBitcodeBlock_ValueSymtab = 14u,
+        kBitcodeBlock_Type = 17u
+    };
+
+    enum EBitcodeType : uint32_t
+    {
+        kBitcodeType_NumEntry = 1u,
+        kBitcodeType_Void = 2u,
+        kBitcodeType_Float = 3u,
+        kBitcodeType_Double = 4u,
+        kBitcodeType_Integer = 7u,
+        kBitcodeType_Pointer = 8u,
+        kBitcodeType_Half = 10u,
+        kBitcodeType_Array = 11u,
+        kBitcodeType_Vector = 12u,
+        kBitcodeType_StructAnon = 18u,
+        kBitcodeType_Function = 21u
+    };
+
+    enum EBitcodeInstr : uint32_t
+    {
+        kBitcodeInstr_DeclareBlocks = 1u,
+        kBitcodeInstr_BinOp = 2u,
+        kBitcodeInstr_Ret = 10u,
+        kBitcodeInstr_Br = 11u,
+        kBitcodeInstr_Phi = 16u,
+        kBitcodeInstr_Cmp2 = 28u
+    };
+
+    enum EBitcodeBinOp : uint32_t
+    {
+        kBitcodeBinOp_Add = 0u,
+        kBitcodeBinOp_Sub = 1u,
+        kBitcodeBinOp_Mul = 2u,
+        kBitcodeBinOp_UDiv = 3u,
+        kBitcodeBinOp_SDiv = 4u, // fdiv for floating point operands
+        kBitcodeBinOp_Xor = 12u
+    };
+
+    constexpr uint32_t uBitcodeModuleVersion = 1u; // relative value ids, names in the value symbol tables
+    constexpr uint32_t uBitcodeCallingConvAMDGPU_PS = 89u;
+    constexpr uint32_t uBitcodeAttrKindInReg = 5u;
+    constexpr uint32_t uInvalidBitcodeType = std::numeric_limits<uint32_t>::max();
+
+    // unique LLVM types in definition order, sub types are defined before their users
+    class BitcodeTypes
+    {
+    public:
+        uint32_t Get(const TypeInfo& _Type)
+        {
+            uint32_t uElement = uInvalidBitcodeType;
+
+            switch (_Type.kType)
+            {
+            case kType_Void:
+                uElement = Add({ kBitcodeType_Void });
+                break;
+            case kType_Bool:
+                uElement = Add({ kBitcodeType_Integer, 1u });
+                break;
+            case kType_Int:
+            case kType_UInt:
+                uElement = Add({ kBitcodeType_Integer, _Type.uElementBits });
+                break;
+            case kType_Float:
+                if (_Type.uElementBits == 16u)
+                    uElement = Add({ kBitcodeType_Half });
+                else if (_Type.uElementBits == 32u)
+                    uElement = Add({ kBitcodeType_Float });
+                else if (_Type.uElementBits == 64u)
+                    uElement = Add({ kBitcodeType_Double });
+                break;
+            case kType_Pointer:
+                if (const uint32_t uPointee = Get(_Type.SubTypes.front()); uPointee != uInvalidBitcodeType)
+                    uElement = Add({ kBitcodeType_Pointer, uPointee, 0u });
+                break;
+            case kType_Array:
+                // the element count is the array length
+                if (const uint32_t uSub = Get(_Type.SubTypes.front()); uSub != uInvalidBitcodeType)
+                    return Add({ kBitcodeType_Array, _Type.uElementCount, uSub });
+                break;
+            case kType_Struct:
+            {
+                std::vector<uint64_t> Record = { kBitcodeType_StructAnon, 0u };
+                for (const TypeInfo& Sub : _Type.SubTypes)
+                {
+                    Record.push_back(Get(Sub));
+                    if (Record.back() == uInvalidBitcodeType)
+                        return uInvalidBitcodeType;
+                }
+                uElement = Add(std::move(Record));
+                break;
+            }
+            default:
+                break;
+            }
+
+            if (uElement == uInvalidBitcodeType || _Type.uElementCount <= 1u)
+                return uElement;
+
+            return Add({ kBitcodeType_Vector, _Type.uElementCount, uElement });
+        }
+
+        uint32_t GetFunction(const uint32_t _uReturnType, const std::vector<uint32_t>& _Parameters)
+        {
+            std::vector<uint64_t> Record = { kBitcodeType_Function, 0u, _uReturnType }; // not vararg
+            Record.insert(Record.end(), _Parameters.begin(), _Parameters.end());
+            return Add(std::move(Record));
+        }
+
+        void Write(BitstreamWriter& _Stream) const
+        {
+            _Stream.EnterBlock(kBitcodeBlock_Type);
+            _Stream.EmitRecord(kBitcodeType_NumEntry, { m_Records.size() });
+
+            for (const std::vector<uint64_t>& Record : m_Records)
+            {
+                _Stream.EmitRecord(static_cast<uint32_t>(Record.front()), std::vector<uint64_t>(Record.begin() + 1, Record.end()));
+            }
+
+            _Stream.ExitBlock();
+        }
+
+    private:
+        // code followed by the operands
+        uint32_t Add(std::vector<uint64_t>&& _Record)
+        {
+            auto it = m_Ids.find(_Record);
+            if (it != m_Ids.end())
+                return it->second;
+
+            const uint32_t uId = static_cast<uint32_t>(m_Records.size());
+            m_Ids.emplace(_Record, uId);
+            m_Records.push_back(std::move(_Record));
+            return uId;
+        }
+
+    private:
+        std::map<std::vector<uint64_t>, uint32_t> m_Ids;
+        std::vector<std::vector<uint64_t>> m_Records;
+    };
+
+    // bytes of the constant, zero extended
+    uint64_t ConstantBits(const Instruction& _Constant)
+    {
+        uint64_t uBits = 0u;
+        uint32_t uShift = 0u;
+
+        for (const Operand& Op : _Constant.GetOperands())
+        {
+            if (uShift >= 64u)
+                break;
+
+            uBits |= static_cast<uint64_t>(Op.uId) << uShift;
+            uShift += sizeof(InstrId) * 8u;
+        }
+
+        return uBits;
+    }
+
+    // sign extended from _uBits, emitted as signed vbr: magnitude shifted left, sign in the lowest bit
+    uint64_t SignedVBR(uint64_t _uValue, const uint32_t _uBits)
+    {
+        if (_uBits < 64u)
+        {
+            _uValue &= (uint64_t(1u) << _uBits) - 1u;
+            if (_uBits > 0u && (_uValue >> (_uBits - 1u)) & 1u)
+            {
+                _uValue |= ~((uint64_t(1u) << _uBits) - 1u);
+            }
+        }
+
+        const int64_t iValue = static_cast<int64_t>(_uValue);
+        return iValue >= 0 ? static_cast<uint64_t>(iValue) << 1u : ((0u - _uValue) << 1u) | 1u;
+    }
+
+    void AppendChars(std::vector<uint64_t>& _Record, const std::string& _sString)
+    {
+        for (const char c : _sString)
+        {
+            _Record.push_back(static_cast<uint8_t>(c));
+        }
+    }
+
+    // value symbol table entry
+    void EmitName(BitstreamWriter& _Stream, const uint32_t _uCode, const uint64_t _uId, const std::string& _sName)
+    {
+        std::vector<uint64_t> Record = { _uId };
+        AppendChars(Record, _sName);
+        _Stream.EmitRecord(_uCode, Record);
+    }
+} // anonymous namespace
+
 std::string InstructionSetLLVMAMD::ResolveTypeName(const Function& _Function, const InstrId _uTypeId)
 {
     return ResolveTypeName(_Function.GetCFG().ResolveType(_Function.GetCFG().GetInstruction(_uTypeId)));
@@ -57,6 +282,13 @@ std::string InstructionSetLLVMAMD::ResolveTypeName(const TypeInfo& _Type)
 }
 
 std::string InstructionSetLLVMAMD::ResolveConstant(const Function& _Function, const Instruction& _Instruction)
+{
+    std::string sConstant;
+    AppendConstant(_Function, _Instruction, sConstant);
+    return sConstant;
+}
+
+void InstructionSetLLVMAMD::AppendConstant(const Function& _Function, const Instruction& _Instruction, std::string& _sOut)
 {
     const TypeInfo Type = _Function.GetCFG().ResolveType(_Function.GetCFG().GetInstruction(_Instruction.GetResultTypeId()));
 
@@ -66,63 +298,118 @@ std::string InstructionSetLLVMAMD::ResolveConstant(const Function& _Function, co
     {
     //case kType_Void:
     case kType_Bool:
-        return Operands[0].uId == false ? "false" : "true";
+        _sOut += Operands[0].uId == false ? "false" : "true";
+        break;
     case kType_Int:
     case kType_UInt:
-        return std::to_string(Operands[0].uId);
+        AppendNumber(_sOut, Operands[0].uId);
+        break;
     case kType_Float:
-        return (std::to_string(*reinterpret_cast<const double*>(&Operands[0].uId)));
+        AppendFixed(_sOut, *reinterpret_cast<const double*>(&Operands[0].uId));
+        break;
     case kType_Pointer:
     case kType_Array:
     case kType_Struct:
     default:
         break;
     }
+}
+
+const std::string& InstructionSetLLVMAMD::GetTypeName(const Function& _Function, const InstrId _uTypeId)
+{
+    if (m_pTypeNameFunction != &_Function)
+    {
+        m_pTypeNameFunction = &_Function;
+        m_TypeNames.clear();
+        m_TypeNameResolved.clear();
+    }
+
+    if (_uTypeId >= m_TypeNames.size())
+    {
+        m_TypeNames.resize(_uTypeId + 1u);
+        m_TypeNameResolved.resize(_uTypeId + 1u, false);
+    }
 
-    return std::string();
+    if (m_TypeNameResolved[_uTypeId] == false)
+    {
+        m_TypeNames[_uTypeId] = ResolveTypeName(_Function, _uTypeId);
+        m_TypeNameResolved[_uTypeId] = true;
+    }
+
+    return m_TypeNames[_uTypeId];
 }
 
 bool InstructionSetLLVMAMD::SerializeInstruction(const Function& _Function, const Instruction& _Instruction, std::ostream& _OutStream)
+{
+    m_Buffer.clear();
+    const bool bResult = SerializeInstruction(_Function, _Instruction, m_Buffer);
+    _OutStream.write(m_Buffer.data(), m_Buffer.size());
+
+    return bResult;
+}
+
+bool InstructionSetLLVMAMD::SerializeInstruction(const Function& _Function, const Instruction& _Instruction, std::string& _sOut)
 {
     const std::vector<Operand>& Operands = _Instruction.GetOperands();
     const ControlFlowGraph& cfg = _Function.GetCFG();
 
-    const auto AliasOrConst = [&](const Instruction* pInstr) -> std::string
+    const auto AliasOrConst = [&](const Instruction* pInstr)
     {
         if (pInstr->GetInstruction() == kInstruction_Constant)
         {
-            return ResolveConstant(_Function, *pInstr);
+            AppendConstant(_Function, *pInstr, _sOut);
         }
         else
         {
-            return '%' + pInstr->GetAlias();
+            _sOut += '%';
+            _sOut += pInstr->GetAlias();
         }
     };
 
     switch (_Instruction.GetInstruction())
     {
     case kInstruction_Return:
-        _OutStream << "\tret ";
+        _sOut += "\tret ";
         if (Operands.size() == 1u)
         {
-            _OutStream << '%' << cfg.GetInstruction(Operands[1].uId)->GetAlias() << std::endl;
+            _sOut += '%';
+            _sOut += cfg.GetInstruction(Operands[0].uId)->GetAlias();
+            _sOut += '\n';
         }
         else
         {
-            _OutStream << "void" << std::endl;
+            _sOut += "void\n";
         }
         break;
     case kInstruction_Branch:
-        _OutStream << "\tbr label %" << cfg.GetNode(Operands[0].uId)->GetName() << std::endl;
+        _sOut += "\tbr label %";
+        _sOut += cfg.GetNode(Operands[0].uId)->GetName();
+        _sOut += '\n';
         break;
     case kInstruction_BranchCond:
-        _OutStream << "\tbr " << ResolveTypeName(_Function, cfg.GetInstruction(Operands[0].uId)->GetResultTypeId()) << " %" << cfg.GetInstruction(Operands[0].uId)->GetAlias();
-        _OutStream << ", label %" << cfg.GetNode(Operands[1].uId)->GetName();
-        _OutStream << ", label %" << cfg.GetNode(Operands[2].uId)->GetName() << std::endl;
+    {
+        const Instruction* pCondition = cfg.GetInstruction(Operands[0].uId);
+        _sOut += "\tbr ";
+        _sOut += GetTypeName(_Function, pCondition->GetResultTypeId());
+        _sOut += " %";
+        _sOut += pCondition->GetAlias();
+        _sOut += ", label %";
+        _sOut += cfg.GetNode(Operands[1].uId)->GetName();
+        _sOut += ", label %";
+        _sOut += cfg.GetNode(Operands[2].uId)->GetName();
+        _sOut += '\n';
         break;
+    }
     case kInstruction_Equal:
-        _OutStream << "\t%" << _Instruction.GetAlias() << " = icmp eq " << ResolveTypeName(_Function, cfg.GetInstruction(Operands[0].uId)->GetResultTypeId());
-        _OutStream << ' ' << AliasOrConst(cfg.GetInstruction(Operands[0].uId)) << ", " << AliasOrConst(cfg.GetInstruction(Operands[1].uId)) << std::endl;
+        _sOut += "\t%";
+        _sOut += _Instruction.GetAlias();
+        _sOut += " = icmp eq ";
+        _sOut += GetTypeName(_Function, cfg.GetInstruction(Operands[0].uId)->GetResultTypeId());
+        _sOut += ' ';
+        AliasOrConst(cfg.GetInstruction(Operands[0].uId));
+        _sOut += ", ";
+        AliasOrConst(cfg.GetInstruction(Operands[1].uId));
+        _sOut += '\n';
         break;
     case kInstruction_Not:
         break;
@@ -132,73 +419,474 @@ bool InstructionSetLLVMAMD::SerializeInstruction(const Function& _Function, cons
         break;
     }
 
-
     return false;
 }
 
 bool InstructionSetLLVMAMD::SerializeListing(const Function& _Function, std::ostream& _OutStream)
 {
+    m_Buffer.clear();
+    const bool bResult = SerializeListing(_Function, m_Buffer);
+    _OutStream.write(m_Buffer.data(), m_Buffer.size());
+
+    return bResult;
+}
+
+bool InstructionSetLLVMAMD::SerializeListing(const Function& _Function, std::string& _sOut)
+{
+    // the types of the function may have changed since the last listing
+    m_pTypeNameFunction = nullptr;
+
     // resolve calling convention
     switch (_Function.GetCallingConvention().uIdentifier)
     {
     case kCallingConventionLLVMAMD_PixelShader:
     default:
-        _OutStream << "define amdgpu_ps "; // currently only PS works
+        _sOut += "define amdgpu_ps "; // currently only PS works
         break;
     }
-    
-    _OutStream << ResolveTypeName(_Function.GetCFG().ResolveType(_Function.GetReturnType()));
-    _OutStream << " @" << _Function.GetName() << '(';
+
+    _sOut += ResolveTypeName(_Function.GetCFG().ResolveType(_Function.GetReturnType()));
+    _sOut += " @";
+    _sOut += _Function.GetName();
+    _sOut += '(';
 
     const std::vector<Instruction*>& Parameters = _Function.GetParameters();
 
-    if (Parameters.empty() == false)
+    for (auto it = Parameters.begin(), end = Parameters.end(); it != end; ++it)
+    {
+        Instruction* pParam = (*it);
+        _sOut += GetTypeName(_Function, pParam->GetResultTypeId());
+        if (pParam->Is(kDecoration_Divergent) == false)
+        {
+            _sOut += " inreg";
+        }
+
+        _sOut += " %";
+        _sOut += pParam->GetAlias();
+
+        if (it + 1 != end)
+        {
+            _sOut += ", ";
+        }
+    }
+
+    _sOut += ") {\n";
+
+    for (const BasicBlock& BB : _Function.GetCFG())
     {
-        for (auto it = Parameters.begin(), end = Parameters.end(); it != end; ++it)
+        // entry label
+        if (BB.IsVirtual())
+            continue;
+
+        _sOut += BB.GetName();
+        _sOut += ":\n";
+
+        for (const Instruction& Instr : BB)
         {
-            Instruction* pParam = (*it);
-            _OutStream << ResolveTypeName(_Function.GetCFG().ResolveType(pParam->GetResultTypeId()));
-            if (pParam->Is(kDecoration_Divergent) == false)
+            SerializeInstruction(_Function, Instr, _sOut);
+        }
+    }
+
+    _sOut += "}\n";
+
+    return true;
+}
+
+bool InstructionSetLLVMAMD::SerializeBinary(const Function& _Function, std::ostream& _OutStream)
+{
+    const ControlFlowGraph& cfg = _Function.GetCFG();
+
+    const auto IsValue = [](const Instruction* pInstr)
+    {
+        switch (pInstr->GetInstruction())
+        {
+        case kInstruction_Phi:
+        case kInstruction_Not:
+        case kInstruction_Equal:
+        case kInstruction_NotEqual:
+        case kInstruction_Less:
+        case kInstruction_LessEqual:
+        case kInstruction_Greater:
+        case kInstruction_GreaterEqual:
+        case kInstruction_Add:
+        case kInstruction_Sub:
+        case kInstruction_Mul:
+        case kInstruction_Div:
+            return true;
+        default:
+            return false;
+        }
+    };
+
+    // the virtual entry point becomes the entry block, it holds the branch to the user code once the function is finalized.
+    // phis are moved to the front of their block, instructions following the terminator are dropped
+    std::vector<std::vector<const Instruction*>> Blocks;
+    for (const BasicBlock& BB : cfg)
+    {
+        if (BB.GetTerminator() == nullptr)
+        {
+            HLOGE("Block %s of function %s has no terminator, the function needs to be finalized", WCSTR(BB.GetName()), WCSTR(_Function.GetName()));
+            return false;
+        }
+
+        std::vector<const Instruction*>& Instrs = Blocks.emplace_back();
+        for (const Instruction& Instr : BB)
+        {
+            if (Instr.Is(kInstruction_Phi))
+                Instrs.push_back(&Instr);
+        }
+
+        for (const Instruction& Instr : BB)
+        {
+            if (IsValue(&Instr) && Instr.Is(kInstruction_Phi) == false)
+                Instrs.push_back(&Instr);
+        }
+
+        Instrs.push_back(BB.GetTerminator());
+    }
+
+    BitcodeTypes Types;
+    std::unordered_map<InstrId, uint32_t> TypeIds;
+
+    const auto GetType = [&](const InstrId uTypeId) -> uint32_t
+    {
+        auto it = TypeIds.find(uTypeId);
+        if (it != TypeIds.end())
+            return it->second;
+
+        const uint32_t uType = Types.Get(cfg.ResolveType(uTypeId));
+        TypeIds.emplace(uTypeId, uType);
+        return uType;
+    };
+
+    // value ids: the function, its parameters, the constants and the instruction results
+    std::unordered_map<InstrId, uint32_t> ValueIds;
+    uint32_t uNextValue = 1u;
+
+    std::vector<uint32_t> ParamTypes;
+    for (const Instruction* pParam : _Function.GetParameters())
+    {
+        ParamTypes.push_back(GetType(pParam->GetResultTypeId()));
+        ValueIds[pParam->GetIdentifier()] = uNextValue++;
+    }
+
+    const uint32_t uReturnType = GetType(_Function.GetReturnType() != nullptr ? _Function.GetReturnType()->GetIdentifier() : InvalidId);
+    const uint32_t uFunctionType = Types.GetFunction(uReturnType, ParamTypes);
+
+    struct BitcodeConstant
+    {
+        uint32_t uType;
+        uint32_t uCode;
+        std::vector<uint64_t> Operands;
+    };
+
+    std::vector<BitcodeConstant> Constants;
+    for (const Instruction& Instr : *cfg.begin())
+    {
+        if (Instr.Is(kInstruction_Constant) == false)
+            continue;
+
+        const TypeInfo Type = cfg.ResolveType(Instr.GetResultTypeId());
+        const uint64_t uBits = ConstantBits(Instr);
+        BitcodeConstant Const{ GetType(Instr.GetResultTypeId()), 3u, {} }; // undef for aggregates
+
+        if (Type.uElementCount <= 1u)
+        {
+            switch (Type.kType)
             {
-                _OutStream << " inreg";
+            case kType_Bool:
+                Const.uCode = 4u;
+                Const.Operands = { SignedVBR(uBits, 1u) };
+                break;
+            case kType_Int:
+            case kType_UInt:
+                Const.uCode = 4u;
+                Const.Operands = { SignedVBR(uBits, Type.uElementBits) };
+                break;
+            case kType_Float:
+                Const.uCode = 6u;
+                Const.Operands = { Type.uElementBits < 64u ? uBits & ((uint64_t(1u) << Type.uElementBits) - 1u) : uBits };
+                break;
+            default:
+                break;
             }
+        }
+
+        ValueIds[Instr.GetIdentifier()] = uNextValue++;
+        Constants.push_back(std::move(Const));
+    }
 
-            _OutStream << " %";
+    // not is lowered to a xor with all bits set, one constant per type
+    std::unordered_map<uint32_t, uint32_t> AllOnes; // bitcode type -> value id
+    for (const std::vector<const Instruction*>& Instrs : Blocks)
+    {
+        for (const Instruction* pInstr : Instrs)
+        {
+            if (pInstr->Is(kInstruction_Not) == false)
+                continue;
 
-            _OutStream << pParam->GetAlias();
+            const TypeInfo Type = cfg.ResolveType(pInstr->GetResultTypeId());
+            if ((Type.kType != kType_Bool && Type.kType != kType_Int && Type.kType != kType_UInt) || Type.uElementCount > 1u)
+            {
+                HLOGE("Not of non integer scalar %s in function %s can not be serialized", WCSTR(pInstr->GetAlias()), WCSTR(_Function.GetName()));
+                return false;
+            }
 
-            if (it + 1 != end)
+            const uint32_t uType = GetType(pInstr->GetResultTypeId());
+            if (AllOnes.count(uType) == 0u)
             {
-                _OutStream << ", ";
+                AllOnes[uType] = uNextValue++;
+                Constants.push_back({ uType, 4u, { SignedVBR(~uint64_t(0u), 64u) } });
             }
         }
     }
 
-    _OutStream << ") {" << std::endl;
+    // mov forwards the value of its source
+    std::unordered_map<InstrId, InstrId> Forwards;
+    for (const Instruction* pInstr : cfg.GetInstructions())
+    {
+        if (pInstr != nullptr && pInstr->Is(kInstruction_Mov))
+            Forwards[pInstr->GetIdentifier()] = pInstr->GetOperands()[0].uId;
+    }
 
-    for (const BasicBlock& BB : _Function.GetCFG())
+    const uint32_t uFirstInstruction = uNextValue;
+    for (const std::vector<const Instruction*>& Instrs : Blocks)
     {
-        if (BB.IsVirtual() == false) // entry label
+        for (const Instruction* pInstr : Instrs)
         {
-            _OutStream << BB.GetName() << ':' << std::endl;
+            if (IsValue(pInstr))
+            {
+                GetType(pInstr->GetResultTypeId());
+                ValueIds[pInstr->GetIdentifier()] = uNextValue++;
+            }
         }
-        else
+    }
+
+    const auto GetValue = [&](InstrId uId) -> uint32_t
+    {
+        for (auto it = Forwards.find(uId); it != Forwards.end(); it = Forwards.find(uId))
         {
-            continue;
+            uId = it->second;
         }
 
-        for (const Instruction& Instr : BB)
+        auto it = ValueIds.find(uId);
+        return it != ValueIds.end() ? it->second : std::numeric_limits<uint32_t>::max();
+    };
+
+    for (const auto& [uTypeId, uType] : TypeIds)
+    {
+        if (uType == uInvalidBitcodeType)
         {
-            SerializeInstruction(_Function, Instr, _OutStream);
+            HLOGE("Function %s uses a type without LLVM equivalent", WCSTR(_Function.GetName()));
+            return false;
         }
     }
 
-    _OutStream << '}' << std::endl;
+    BitstreamWriter Stream;
+    std::vector<uint64_t> Record;
 
-    return true;
-}
+    // magic 'BC' 0xC0DE
+    Stream.Emit('B', 8u);
+    Stream.Emit('C', 8u);
+    Stream.Emit(0x0u, 4u);
+    Stream.Emit(0xCu, 4u);
+    Stream.Emit(0xEu, 4u);
+    Stream.Emit(0xDu, 4u);
 
-bool InstructionSetLLVMAMD::SerializeBinary(const Function& _Function, std::ostream& _OutStream)
-{
-    return false;
+    Stream.EnterBlock(kBitcodeBlock_Identification, 5u);
+    AppendChars(Record, "dot2ll");
+    Stream.EmitRecord(1u, Record); // producer
+    Stream.EmitRecord(2u, { 0u }); // epoch
+    Stream.ExitBlock();
+
+    Stream.EnterBlock(kBitcodeBlock_Module, 3u);
+    Stream.EmitRecord(1u, { uBitcodeModuleVersion });
+
+    // inreg uniform parameters, one attribute group per parameter
+    std::vector<uint64_t> ParamAttrGroups;
+    for (uint32_t i = 0u; i < _Function.GetParameters().size(); ++i)
+    {
+        if (_Function.GetParameters()[i]->Is(kDecoration_Divergent) == false)
+        {
+            ParamAttrGroups.push_back(i + 1u);
+        }
+    }
+
+    if (ParamAttrGroups.empty() == false)
+    {
+        Stream.EnterBlock(kBitcodeBlock_ParamAttrGroup, 3u);
+        for (const uint64_t uGroup : ParamAttrGroups)
+        {
+            // group, attribute list index of the parameter, enum attribute
+            Stream.EmitRecord(3u, { uGroup, uGroup, 0u, uBitcodeAttrKindInReg });
+        }
+        Stream.ExitBlock();
+
+        Stream.EnterBlock(kBitcodeBlock_ParamAttr, 3u);
+        Stream.EmitRecord(2u, ParamAttrGroups);
+        Stream.ExitBlock();
+    }
+
+    Types.Write(Stream);
+
+    // type, calling convention, is prototype, linkage, attribute list (1 based), alignment, section, visibility
+    Stream.EmitRecord(8u, { uFunctionType, uBitcodeCallingConvAMDGPU_PS, 0u, 0u, ParamAttrGroups.empty() ? 0u : 1u, 0u, 0u, 0u });
+
+    Stream.EnterBlock(kBitcodeBlock_Function);
+    Stream.EmitRecord(kBitcodeInstr_DeclareBlocks, { Blocks.size() });
+
+    if (Constants.empty() == false)
+    {
+        Stream.EnterBlock(kBitcodeBlock_Constants);
+        uint32_t uType = uInvalidBitcodeType;
+        for (const BitcodeConstant& Const : Constants)
+        {
+            if (Const.uType != uType)
+            {
+                uType = Const.uType;
+                Stream.EmitRecord(1u, { uType }); // settype
+            }
+            Stream.EmitRecord(Const.uCode, Const.Operands);
+        }
+        Stream.ExitBlock();
+    }
+
+    // operands are relative to the current instruction, forward references carry their type
+    uint32_t uInstruction = uFirstInstruction;
+
+    const auto PushValue = [&](const InstrId uId)
+    {
+        Record.push_back(static_cast<uint32_t>(uInstruction - GetValue(uId)));
+    };
+
+    const auto PushValueAndType = [&](const InstrId uId)
+    {
+        PushValue(uId);
+        if (GetValue(uId) >= uInstruction)
+        {
+            Record.push_back(GetType(cfg.GetInstruction(uId)->GetResultTypeId()));
+        }
+    };
+
+    for (const std::vector<const Instruction*>& Instrs : Blocks)
+    {
+        for (const Instruction* pInstr : Instrs)
+        {
+            const std::vector<Operand>& Operands = pInstr->GetOperands();
+            Record.clear();
+
+            switch (pInstr->GetInstruction())
+            {
+            case kInstruction_Return:
+                if (Operands.size() == 1u)
+                    PushValueAndType(Operands[0].uId);
+                Stream.EmitRecord(kBitcodeInstr_Ret, Record);
+                break;
+            case kInstruction_Branch:
+                Stream.EmitRecord(kBitcodeInstr_Br, { Operands[0].uId });
+                break;
+            case kInstruction_BranchCond:
+                Record = { Operands[1].uId, Operands[2].uId };
+                PushValue(Operands[0].uId);
+                Stream.EmitRecord(kBitcodeInstr_Br, Record);
+                break;
+            case kInstruction_Phi:
+            {
+                const uint64_t uCount = Operands[0].uId;
+                Record.push_back(GetType(pInstr->GetResultTypeId()));
+                for (uint64_t i = 0u; i < uCount; ++i)
+                {
+                    const uint64_t uRelative = static_cast<uint64_t>(int64_t(uInstruction) - int64_t(GetValue(Operands[1u + i].uId)));
+                    Record.push_back(SignedVBR(uRelative, 64u));
+                    Record.push_back(Operands[1u + uCount + i].uId);
+                }
+                Stream.EmitRecord(kBitcodeInstr_Phi, Record);
+                break;
+            }
+            case kInstruction_Not:
+                PushValueAndType(Operands[0].uId);
+                Record.push_back(static_cast<uint32_t>(uInstruction - AllOnes[GetType(pInstr->GetResultTypeId())]));
+                Record.push_back(kBitcodeBinOp_Xor);
+                Stream.EmitRecord(kBitcodeInstr_BinOp, Record);
+                break;
+            case kInstruction_Equal:
+            case kInstruction_NotEqual:
+            case kInstruction_Less:
+            case kInstruction_LessEqual:
+            case kInstruction_Greater:
+            case kInstruction_GreaterEqual:
+            {
+                // icmp eq, ne, slt/ult, sle/ule, sgt/ugt, sge/uge and fcmp oeq, une, olt, ole, ogt, oge
+                static constexpr uint64_t SignedPredicates[] = { 32u, 33u, 40u, 41u, 38u, 39u };
+                static constexpr uint64_t UnsignedPredicates[] = { 32u, 33u, 36u, 37u, 34u, 35u };
+                static constexpr uint64_t FloatPredicates[] = { 1u, 14u, 4u, 5u, 2u, 3u };
+
+                const EType kOperandType = cfg.ResolveType(cfg.GetInstruction(Operands[0].uId)->GetResultTypeId()).kType;
+                const uint32_t uPredicate = pInstr->GetInstruction() - kInstruction_Equal;
+
+                PushValueAndType(Operands[0].uId);
+                PushValue(Operands[1].uId);
+                Record.push_back(kOperandType == kType_Float ? FloatPredicates[uPredicate] :
+                    kOperandType == kType_Int ? SignedPredicates[uPredicate] : UnsignedPredicates[uPredicate]);
+                Stream.EmitRecord(kBitcodeInstr_Cmp2, Record);
+                break;
+            }
+            case kInstruction_Add:
+            case kInstruction_Sub:
+            case kInstruction_Mul:
+            case kInstruction_Div:
+            {
+                static constexpr uint64_t BinOps[] = { kBitcodeBinOp_Add, kBitcodeBinOp_Sub, kBitcodeBinOp_Mul, kBitcodeBinOp_SDiv };
+                const EType kType = cfg.ResolveType(pInstr->GetResultTypeId()).kType;
+
+                PushValueAndType(Operands[0].uId);
+                PushValue(Operands[1].uId);
+                Record.push_back(pInstr->Is(kInstruction_Div) && kType == kType_UInt ? static_cast<uint64_t>(kBitcodeBinOp_UDiv) : BinOps[pInstr->GetInstruction() - kInstruction_Add]);
+                Stream.EmitRecord(kBitcodeInstr_BinOp, Record);
+                break;
+            }
+            default:
+                break;
+            }
+
+            if (IsValue(pInstr))
+            {
+                ++uInstruction;
+            }
+        }
+    }
+
+    // names, numeric aliases are left unnamed
+    Stream.EnterBlock(kBitcodeBlock_ValueSymtab);
+    for (const Instruction* pInstr : cfg.GetInstructions())
+    {
+        if (pInstr == nullptr || pInstr->Is(kInstruction_Constant) || pInstr->Is(kInstruction_Mov))
+            continue;
+
+        const std::string& sAlias = pInstr->GetAlias();
+        if (auto it = ValueIds.find(pInstr->GetIdentifier()); it != ValueIds.end() &&
+            std::all_of(sAlias.begin(), sAlias.end(), [](const char c) {return c >= '0' && c <= '9'; }) == false)
+        {
+            EmitName(Stream, 1u, it->second, sAlias);
+        }
+    }
+
+    for (const BasicBlock& BB : cfg)
+    {
+        EmitName(Stream, 2u, BB.GetIdentifier(), BB.GetName());
+    }
+    Stream.ExitBlock();
+
+    Stream.ExitBlock(); // function
+
+    Stream.EnterBlock(kBitcodeBlock_ValueSymtab);
+    EmitName(Stream, 1u, 0u, _Function.GetName());
+    Stream.ExitBlock();
+
+    Stream.ExitBlock(); // module
+
+    const std::vector<uint8_t>& Bytes = Stream.GetBytes();
+    _OutStream.write(reinterpret_cast<const char*>(Bytes.data()), Bytes.size());
+
+    return _OutStream.good();
 }
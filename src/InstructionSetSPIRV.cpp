@@ -0,0 +1,1581 @@
+#include "InstructionSetSPIRV.h"
+#include "FunctionBinary.h"
+#include "PostDominators.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+    // opcodes, see the SPIR-V specification 3.52
+    enum ESPIRVOp : uint32_t
+    {
+        kSPIRVOp_Undef = 1u,
+        kSPIRVOp_Name = 5u,
+        kSPIRVOp_MemberName = 6u,
+        kSPIRVOp_MemoryModel = 14u,
+        kSPIRVOp_EntryPoint = 15u,
+        kSPIRVOp_ExecutionMode = 16u,
+        kSPIRVOp_Capability = 17u,
+        kSPIRVOp_TypeVoid = 19u,
+        kSPIRVOp_TypeBool = 20u,
+        kSPIRVOp_TypeInt = 21u,
+        kSPIRVOp_TypeFloat = 22u,
+        kSPIRVOp_TypeVector = 23u,
+        kSPIRVOp_TypeArray = 28u,
+        kSPIRVOp_TypeStruct = 30u,
+        kSPIRVOp_TypePointer = 32u,
+        kSPIRVOp_TypeFunction = 33u,
+        kSPIRVOp_ConstantTrue = 41u,
+        kSPIRVOp_ConstantFalse = 42u,
+        kSPIRVOp_Constant = 43u,
+        kSPIRVOp_Function = 54u,
+        kSPIRVOp_FunctionEnd = 56u,
+        kSPIRVOp_Variable = 59u,
+        kSPIRVOp_Load = 61u,
+        kSPIRVOp_Store = 62u,
+        kSPIRVOp_AccessChain = 65u,
+        kSPIRVOp_Decorate = 71u,
+        kSPIRVOp_MemberDecorate = 72u,
+        kSPIRVOp_IAdd = 128u,
+        kSPIRVOp_FAdd = 129u,
+        kSPIRVOp_ISub = 130u,
+        kSPIRVOp_FSub = 131u,
+        kSPIRVOp_IMul = 132u,
+        kSPIRVOp_FMul = 133u,
+        kSPIRVOp_UDiv = 134u,
+        kSPIRVOp_SDiv = 135u,
+        kSPIRVOp_FDiv = 136u,
+        kSPIRVOp_LogicalEqual = 164u,
+        kSPIRVOp_LogicalNotEqual = 165u,
+        kSPIRVOp_LogicalNot = 168u,
+        kSPIRVOp_IEqual = 170u,
+        kSPIRVOp_INotEqual = 171u,
+        kSPIRVOp_UGreaterThan = 172u,
+        kSPIRVOp_SGreaterThan = 173u,
+        kSPIRVOp_UGreaterThanEqual = 174u,
+        kSPIRVOp_SGreaterThanEqual = 175u,
+        kSPIRVOp_ULessThan = 176u,
+        kSPIRVOp_SLessThan = 177u,
+        kSPIRVOp_ULessThanEqual = 178u,
+        kSPIRVOp_SLessThanEqual = 179u,
+        kSPIRVOp_FOrdEqual = 180u,
+        kSPIRVOp_FUnordNotEqual = 183u,
+        kSPIRVOp_FOrdLessThan = 184u,
+        kSPIRVOp_FOrdGreaterThan = 186u,
+        kSPIRVOp_FOrdLessThanEqual = 188u,
+        kSPIRVOp_FOrdGreaterThanEqual = 190u,
+        kSPIRVOp_Not = 200u,
+        kSPIRVOp_Phi = 245u,
+        kSPIRVOp_LoopMerge = 246u,
+        kSPIRVOp_SelectionMerge = 247u,
+        kSPIRVOp_Label = 248u,
+        kSPIRVOp_Branch = 249u,
+        kSPIRVOp_BranchConditional = 250u,
+        kSPIRVOp_Return = 253u
+    };
+
+    const char* GetOpName(const uint32_t _uOpcode)
+    {
+        switch (_uOpcode)
+        {
+        case kSPIRVOp_Undef: return "OpUndef";
+        case kSPIRVOp_Name: return "OpName";
+        case kSPIRVOp_MemberName: return "OpMemberName";
+        case kSPIRVOp_MemoryModel: return "OpMemoryModel";
+        case kSPIRVOp_EntryPoint: return "OpEntryPoint";
+        case kSPIRVOp_ExecutionMode: return "OpExecutionMode";
+        case kSPIRVOp_Capability: return "OpCapability";
+        case kSPIRVOp_TypeVoid: return "OpTypeVoid";
+        case kSPIRVOp_TypeBool: return "OpTypeBool";
+        case kSPIRVOp_TypeInt: return "OpTypeInt";
+        case kSPIRVOp_TypeFloat: return "OpTypeFloat";
+        case kSPIRVOp_TypeVector: return "OpTypeVector";
+        case kSPIRVOp_TypeArray: return "OpTypeArray";
+        case kSPIRVOp_TypeStruct: return "OpTypeStruct";
+        case kSPIRVOp_TypePointer: return "OpTypePointer";
+        case kSPIRVOp_TypeFunction: return "OpTypeFunction";
+        case kSPIRVOp_ConstantTrue: return "OpConstantTrue";
+        case kSPIRVOp_ConstantFalse: return "OpConstantFalse";
+        case kSPIRVOp_Constant: return "OpConstant";
+        case kSPIRVOp_Function: return "OpFunction";
+        case kSPIRVOp_FunctionEnd: return "OpFunctionEnd";
+        case kSPIRVOp_Variable: return "OpVariable";
+        case kSPIRVOp_Load: return "OpLoad";
+        case kSPIRVOp_Store: return "OpStore";
+        case kSPIRVOp_AccessChain: return "OpAccessChain";
+        case kSPIRVOp_Decorate: return "OpDecorate";
+        case kSPIRVOp_MemberDecorate: return "OpMemberDecorate";
+        case kSPIRVOp_IAdd: return "OpIAdd";
+        case kSPIRVOp_FAdd: return "OpFAdd";
+        case kSPIRVOp_ISub: return "OpISub";
+        case kSPIRVOp_FSub: return "OpFSub";
+        case kSPIRVOp_IMul: return "OpIMul";
+        case kSPIRVOp_FMul: return "OpFMul";
+        case kSPIRVOp_UDiv: return "OpUDiv";
+        case kSPIRVOp_SDiv: return "OpSDiv";
+        case kSPIRVOp_FDiv: return "OpFDiv";
+        case kSPIRVOp_LogicalEqual: return "OpLogicalEqual";
+        case kSPIRVOp_LogicalNotEqual: return "OpLogicalNotEqual";
+        case kSPIRVOp_LogicalNot: return "OpLogicalNot";
+        case kSPIRVOp_IEqual: return "OpIEqual";
+        case kSPIRVOp_INotEqual: return "OpINotEqual";
+        case kSPIRVOp_UGreaterThan: return "OpUGreaterThan";
+        case kSPIRVOp_SGreaterThan: return "OpSGreaterThan";
+        case kSPIRVOp_UGreaterThanEqual: return "OpUGreaterThanEqual";
+        case kSPIRVOp_SGreaterThanEqual: return "OpSGreaterThanEqual";
+        case kSPIRVOp_ULessThan: return "OpULessThan";
+        case kSPIRVOp_SLessThan: return "OpSLessThan";
+        case kSPIRVOp_ULessThanEqual: return "OpULessThanEqual";
+        case kSPIRVOp_SLessThanEqual: return "OpSLessThanEqual";
+        case kSPIRVOp_FOrdEqual: return "OpFOrdEqual";
+        case kSPIRVOp_FUnordNotEqual: return "OpFUnordNotEqual";
+        case kSPIRVOp_FOrdLessThan: return "OpFOrdLessThan";
+        case kSPIRVOp_FOrdGreaterThan: return "OpFOrdGreaterThan";
+        case kSPIRVOp_FOrdLessThanEqual: return "OpFOrdLessThanEqual";
+        case kSPIRVOp_FOrdGreaterThanEqual: return "OpFOrdGreaterThanEqual";
+        case kSPIRVOp_Not: return "OpNot";
+        case kSPIRVOp_Phi: return "OpPhi";
+        case kSPIRVOp_LoopMerge: return "OpLoopMerge";
+        case kSPIRVOp_SelectionMerge: return "OpSelectionMerge";
+        case kSPIRVOp_Label: return "OpLabel";
+        case kSPIRVOp_Branch: return "OpBranch";
+        case kSPIRVOp_BranchConditional: return "OpBranchConditional";
+        case kSPIRVOp_Return: return "OpReturn";
+        default: return "OpNop";
+        }
+    }
+
+    enum ESPIRVCapability : uint32_t
+    {
+        kSPIRVCapability_Shader = 1u,
+        kSPIRVCapability_Float16 = 9u,
+        kSPIRVCapability_Float64 = 10u,
+        kSPIRVCapability_Int64 = 11u,
+        kSPIRVCapability_Int16 = 22u,
+        kSPIRVCapability_Int8 = 39u
+    };
+
+    enum ESPIRVStorageClass : uint32_t
+    {
+        kSPIRVStorageClass_Input = 1u,
+        kSPIRVStorageClass_Output = 3u,
+        kSPIRVStorageClass_PushConstant = 9u
+    };
+
+    enum ESPIRVDecoration : uint32_t
+    {
+        kSPIRVDecoration_Block = 2u,
+        kSPIRVDecoration_Flat = 14u,
+        kSPIRVDecoration_Location = 30u,
+        kSPIRVDecoration_Offset = 35u
+    };
+
+    constexpr uint32_t uSPIRVMagic = 0x07230203u;
+    constexpr uint32_t uSPIRVVersion = 0x00010300u; // 1.3, Vulkan 1.1
+    constexpr uint32_t uSPIRVAddressingLogical = 0u;
+    constexpr uint32_t uSPIRVMemoryModelGLSL450 = 1u;
+    constexpr uint32_t uSPIRVExecutionModelFragment = 4u;
+    constexpr uint32_t uSPIRVExecutionModeOriginUpperLeft = 7u;
+    constexpr uint32_t uSPIRVControlNone = 0u; // function, selection and loop control
+
+    struct SPIRVOperand
+    {
+        enum EKind : uint32_t
+        {
+            kKind_Id = 0u,
+            kKind_Literal,
+            kKind_String // index into the strings of the module
+        };
+
+        EKind kKind;
+        uint32_t uValue;
+        const char* sEnumerant = nullptr; // listing name of a literal
+    };
+
+    SPIRVOperand Id(const uint32_t _uId) { return { SPIRVOperand::kKind_Id, _uId }; }
+    SPIRVOperand Literal(const uint32_t _uValue, const char* _sEnumerant = nullptr) { return { SPIRVOperand::kKind_Literal, _uValue, _sEnumerant }; }
+
+    struct SPIRVInstruction
+    {
+        uint32_t uOpcode;
+        uint32_t uResultType; // 0 if the instruction has none
+        uint32_t uResult; // 0 if the instruction has none
+        std::vector<SPIRVOperand> Operands;
+        std::string sLiteral; // listing text replacing the literal operands of a constant
+        InstrId uSource = InvalidId; // instruction of the function this was emitted for
+    };
+
+    // logical layout of a module, see the SPIR-V specification 2.4
+    enum ESPIRVSection : uint32_t
+    {
+        kSPIRVSection_Capabilities = 0u,
+        kSPIRVSection_MemoryModel,
+        kSPIRVSection_EntryPoints,
+        kSPIRVSection_ExecutionModes,
+        kSPIRVSection_Names,
+        kSPIRVSection_Decorations,
+        kSPIRVSection_Globals, // types, constants and global variables
+        kSPIRVSection_Functions,
+        kSPIRVSection_NumOf
+    };
+
+    class SPIRVModule
+    {
+    public:
+        uint32_t NewId() { return m_uBound++; }
+
+        SPIRVInstruction& Add(const ESPIRVSection _kSection, const uint32_t _uOpcode, const uint32_t _uResultType, const uint32_t _uResult, std::vector<SPIRVOperand>&& _Operands)
+        {
+            return m_Sections[_kSection].emplace_back(SPIRVInstruction{ _uOpcode, _uResultType, _uResult, std::move(_Operands), std::string(), InvalidId });
+        }
+
+        // types, constants and undefined values with equal operands share one id, a type may only be declared once
+        uint32_t Declare(const uint32_t _uOpcode, const uint32_t _uResultType, std::vector<SPIRVOperand>&& _Operands, const std::string& _sLiteral = {})
+        {
+            std::vector<uint32_t> Key = { _uOpcode, _uResultType };
+            for (const SPIRVOperand& Op : _Operands)
+            {
+                Key.push_back(Op.uValue);
+            }
+
+            if (auto it = m_Declarations.find(Key); it != m_Declarations.end())
+                return it->second;
+
+            const uint32_t uId = NewId();
+            Add(kSPIRVSection_Globals, _uOpcode, _uResultType, uId, std::move(_Operands)).sLiteral = _sLiteral;
+            m_Declarations.emplace(std::move(Key), uId);
+            return uId;
+        }
+
+        void Capability(const uint32_t _uCapability, const char* _sName)
+        {
+            for (const SPIRVInstruction& Instr : m_Sections[kSPIRVSection_Capabilities])
+            {
+                if (Instr.Operands.front().uValue == _uCapability)
+                    return;
+            }
+
+            Add(kSPIRVSection_Capabilities, kSPIRVOp_Capability, 0u, 0u, { Literal(_uCapability, _sName) });
+        }
+
+        SPIRVOperand String(const std::string& _sString)
+        {
+            m_Strings.push_back(_sString);
+            return { SPIRVOperand::kKind_String, static_cast<uint32_t>(m_Strings.size() - 1u) };
+        }
+
+        void Name(const uint32_t _uId, const std::string& _sName)
+        {
+            Add(kSPIRVSection_Names, kSPIRVOp_Name, 0u, 0u, { Id(_uId), String(_sName) });
+        }
+
+        void Decorate(const uint32_t _uId, const uint32_t _uDecoration, const char* _sDecoration, std::vector<SPIRVOperand>&& _Operands = {})
+        {
+            _Operands.insert(_Operands.begin(), { Id(_uId), Literal(_uDecoration, _sDecoration) });
+            Add(kSPIRVSection_Decorations, kSPIRVOp_Decorate, 0u, 0u, std::move(_Operands));
+        }
+
+        std::vector<uint32_t> GetWords() const
+        {
+            std::vector<uint32_t> Words = { uSPIRVMagic, uSPIRVVersion, 0u, m_uBound, 0u }; // unregistered generator, schema
+
+            for (const std::vector<SPIRVInstruction>& Section : m_Sections)
+            {
+                for (const SPIRVInstruction& Instr : Section)
+                {
+                    const size_t uFirst = Words.size();
+                    Words.push_back(0u);
+
+                    if (Instr.uResultType != 0u)
+                        Words.push_back(Instr.uResultType);
+                    if (Instr.uResult != 0u)
+                        Words.push_back(Instr.uResult);
+
+                    for (const SPIRVOperand& Op : Instr.Operands)
+                    {
+                        if (Op.kKind != SPIRVOperand::kKind_String)
+                        {
+                            Words.push_back(Op.uValue);
+                            continue;
+                        }
+
+                        // null terminated, padded with zeros to the next word
+                        const std::string& sString = m_Strings[Op.uValue];
+                        const size_t uStart = Words.size();
+                        Words.resize(uStart + sString.size() / 4u + 1u, 0u);
+                        for (size_t i = 0u; i < sString.size(); ++i)
+                        {
+                            Words[uStart + i / 4u] |= static_cast<uint32_t>(static_cast<uint8_t>(sString[i])) << ((i % 4u) * 8u);
+                        }
+                    }
+
+                    Words[uFirst] = (static_cast<uint32_t>(Words.size() - uFirst) << 16u) | Instr.uOpcode;
+                }
+            }
+
+            return Words;
+        }
+
+        // instructions emitted for _uSource or the whole module if InvalidId, returns false if nothing was written
+        bool WriteListing(std::string& _sOut, const InstrId _uSource = InvalidId) const
+        {
+            bool bWritten = false;
+
+            if (_uSource == InvalidId)
+            {
+                _sOut += "; SPIR-V\n; Version: 1.3\n; Generator: 0\n; Bound: ";
+                _sOut += std::to_string(m_uBound);
+                _sOut += "\n; Schema: 0\n";
+            }
+
+            for (const std::vector<SPIRVInstruction>& Section : m_Sections)
+            {
+                for (const SPIRVInstruction& Instr : Section)
+                {
+                    if (_uSource != InvalidId && Instr.uSource != _uSource)
+                        continue;
+
+                    bWritten = true;
+
+                    if (Instr.uResult != 0u)
+                    {
+                        _sOut += '%';
+                        _sOut += std::to_string(Instr.uResult);
+                        _sOut += " = ";
+                    }
+
+                    _sOut += GetOpName(Instr.uOpcode);
+
+                    if (Instr.uResultType != 0u)
+                    {
+                        _sOut += " %";
+                        _sOut += std::to_string(Instr.uResultType);
+                    }
+
+                    for (const SPIRVOperand& Op : Instr.Operands)
+                    {
+                        if (Op.kKind == SPIRVOperand::kKind_Literal && Instr.sLiteral.empty() == false)
+                            continue;
+
+                        _sOut += ' ';
+
+                        switch (Op.kKind)
+                        {
+                        case SPIRVOperand::kKind_Id:
+                            _sOut += '%';
+                            _sOut += std::to_string(Op.uValue);
+                            break;
+                        case SPIRVOperand::kKind_Literal:
+                            _sOut += Op.sEnumerant != nullptr ? Op.sEnumerant : std::to_string(Op.uValue);
+                            break;
+                        case SPIRVOperand::kKind_String:
+                            _sOut += '"';
+                            for (const char c : m_Strings[Op.uValue])
+                            {
+                                if (c == '"' || c == '\\')
+                                    _sOut += '\\';
+                                _sOut += c;
+                            }
+                            _sOut += '"';
+                            break;
+                        }
+                    }
+
+                    if (Instr.sLiteral.empty() == false)
+                    {
+                        _sOut += ' ';
+                        _sOut += Instr.sLiteral;
+                    }
+
+                    _sOut += '\n';
+                }
+            }
+
+            return bWritten;
+        }
+
+    private:
+        uint32_t m_uBound = 1u; // 0 is not a valid id
+        std::vector<SPIRVInstruction> m_Sections[kSPIRVSection_NumOf];
+        std::map<std::vector<uint32_t>, uint32_t> m_Declarations;
+        std::vector<std::string> m_Strings;
+    };
+
+    // bytes of the constant, zero extended
+    uint64_t ConstantBits(const Instruction& _Constant)
+    {
+        uint64_t uBits = 0u;
+        uint32_t uShift = 0u;
+
+        for (const Operand& Op : _Constant.GetOperands())
+        {
+            if (uShift >= 64u)
+                break;
+
+            uBits |= static_cast<uint64_t>(Op.uId) << uShift;
+            uShift += sizeof(InstrId) * 8u;
+        }
+
+        return uBits;
+    }
+
+    // low _uBits of _uValue, sign extended to 64 bits if _bSigned
+    uint64_t Extend(uint64_t _uValue, const uint32_t _uBits, const bool _bSigned)
+    {
+        if (_uBits >= 64u)
+            return _uValue;
+
+        _uValue &= (uint64_t(1u) << _uBits) - 1u;
+        if (_bSigned && _uBits > 0u && (_uValue >> (_uBits - 1u)) & 1u)
+        {
+            _uValue |= ~((uint64_t(1u) << _uBits) - 1u);
+        }
+
+        return _uValue;
+    }
+
+    float HalfToFloat(const uint32_t _uBits)
+    {
+        const uint32_t uExponent = (_uBits >> 10u) & 0x1fu;
+        const uint32_t uMantissa = _uBits & 0x3ffu;
+
+        float fValue = 0.f;
+        if (uExponent == 0u)
+            fValue = std::ldexp(static_cast<float>(uMantissa), -24);
+        else if (uExponent == 31u)
+            fValue = uMantissa != 0u ? NAN : INFINITY;
+        else
+            fValue = std::ldexp(static_cast<float>(uMantissa | 0x400u), static_cast<int>(uExponent) - 25);
+
+        return (_uBits & 0x8000u) != 0u ? -fValue : fValue;
+    }
+
+    // literal of a scalar constant in assembly syntax, empty for aggregates
+    std::string ConstantText(const TypeInfo& _Type, const uint64_t _uBits)
+    {
+        if (_Type.uElementCount > 1u)
+            return {};
+
+        char Buffer[32];
+        std::to_chars_result Result{ Buffer, {} };
+
+        switch (_Type.kType)
+        {
+        case kType_Bool:
+            return (_uBits & 1u) != 0u ? "true" : "false";
+        case kType_Int:
+            Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), static_cast<int64_t>(Extend(_uBits, _Type.uElementBits, true)));
+            break;
+        case kType_UInt:
+            Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), Extend(_uBits, _Type.uElementBits, false));
+            break;
+        case kType_Float:
+            if (_Type.uElementBits == 16u)
+            {
+                Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), HalfToFloat(static_cast<uint32_t>(_uBits & 0xffffu)));
+            }
+            else if (_Type.uElementBits == 32u)
+            {
+                float fValue;
+                const uint32_t uBits32 = static_cast<uint32_t>(_uBits);
+                std::memcpy(&fValue, &uBits32, sizeof(float));
+                Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), fValue);
+            }
+            else if (_Type.uElementBits == 64u)
+            {
+                double fValue;
+                std::memcpy(&fValue, &_uBits, sizeof(double));
+                Result = std::to_chars(Buffer, Buffer + sizeof(Buffer), fValue);
+            }
+            break;
+        default:
+            break;
+        }
+
+        return std::string(Buffer, Result.ptr);
+    }
+
+    // scalar and vector types only, pointers are not allowed with logical addressing. returns 0 if there is no SPIR-V equivalent
+    uint32_t DeclareType(SPIRVModule& _Module, const TypeInfo& _Type)
+    {
+        uint32_t uElement = 0u;
+
+        switch (_Type.kType)
+        {
+        case kType_Void:
+            return _Module.Declare(kSPIRVOp_TypeVoid, 0u, {});
+        case kType_Bool:
+            uElement = _Module.Declare(kSPIRVOp_TypeBool, 0u, {});
+            break;
+        case kType_Int:
+        case kType_UInt:
+            if (_Type.uElementBits == 8u)
+                _Module.Capability(kSPIRVCapability_Int8, "Int8");
+            else if (_Type.uElementBits == 16u)
+                _Module.Capability(kSPIRVCapability_Int16, "Int16");
+            else if (_Type.uElementBits == 64u)
+                _Module.Capability(kSPIRVCapability_Int64, "Int64");
+            else if (_Type.uElementBits != 32u)
+                return 0u;
+            uElement = _Module.Declare(kSPIRVOp_TypeInt, 0u, { Literal(_Type.uElementBits), Literal(_Type.kType == kType_Int ? 1u : 0u) });
+            break;
+        case kType_Float:
+            if (_Type.uElementBits == 16u)
+                _Module.Capability(kSPIRVCapability_Float16, "Float16");
+            else if (_Type.uElementBits == 64u)
+                _Module.Capability(kSPIRVCapability_Float64, "Float64");
+            else if (_Type.uElementBits != 32u)
+                return 0u;
+            uElement = _Module.Declare(kSPIRVOp_TypeFloat, 0u, { Literal(_Type.uElementBits) });
+            break;
+        case kType_Array:
+        {
+            // the element count is the array length
+            const uint32_t uSub = DeclareType(_Module, _Type.SubTypes.front());
+            if (uSub == 0u)
+                return 0u;
+
+            const uint32_t uLengthType = _Module.Declare(kSPIRVOp_TypeInt, 0u, { Literal(32u), Literal(0u) });
+            const uint32_t uLength = _Module.Declare(kSPIRVOp_Constant, uLengthType, { Literal(_Type.uElementCount) }, std::to_string(_Type.uElementCount));
+            return _Module.Declare(kSPIRVOp_TypeArray, 0u, { Id(uSub), Id(uLength) });
+        }
+        case kType_Struct:
+        {
+            std::vector<SPIRVOperand> Members;
+            for (const TypeInfo& Sub : _Type.SubTypes)
+            {
+                Members.push_back(Id(DeclareType(_Module, Sub)));
+                if (Members.back().uValue == 0u)
+                    return 0u;
+            }
+            uElement = _Module.Declare(kSPIRVOp_TypeStruct, 0u, std::move(Members));
+            break;
+        }
+        case kType_Pointer:
+        default:
+            return 0u;
+        }
+
+        if (_Type.uElementCount <= 1u)
+            return uElement;
+
+        // larger vectors need the Vector16 capability of kernels
+        if (_Type.kType == kType_Struct || _Type.uElementCount > 4u)
+            return 0u;
+
+        return _Module.Declare(kSPIRVOp_TypeVector, 0u, { Id(uElement), Literal(_Type.uElementCount) });
+    }
+
+    enum EMerge : uint32_t
+    {
+        kMerge_None = 0u,
+        kMerge_Selection,
+        kMerge_Loop
+    };
+
+    struct MergeInfo
+    {
+        EMerge kMerge = kMerge_None;
+        const BasicBlock* pMerge = nullptr;
+        const BasicBlock* pContinue = nullptr; // loops only
+    };
+
+    // the edges from Sources to pTarget are routed through a new block
+    struct EdgeSplit
+    {
+        const BasicBlock* pTarget;
+        std::vector<const BasicBlock*> Sources;
+        const char* sSuffix; // of the new block name
+    };
+
+    // true if every path from _pEntry to _pBlock passes _pDominator
+    bool Dominates(const BasicBlock* _pEntry, const BasicBlock* _pDominator, const BasicBlock* _pBlock, std::vector<uint8_t>& _Visited)
+    {
+        if (_pDominator == _pBlock || _pDominator == _pEntry)
+            return true;
+
+        std::fill(_Visited.begin(), _Visited.end(), uint8_t(0u));
+        _Visited[_pDominator->GetIdentifier()] = 1u;
+        _Visited[_pEntry->GetIdentifier()] = 1u;
+
+        std::vector<const BasicBlock*> Stack = { _pEntry };
+        while (Stack.empty() == false)
+        {
+            const BasicBlock* pBB = Stack.back();
+            Stack.pop_back();
+
+            for (const BasicBlock* pSucc : pBB->GetSuccesors())
+            {
+                if (pSucc == _pBlock)
+                    return false;
+
+                if (_Visited[pSucc->GetIdentifier()] == 0u)
+                {
+                    _Visited[pSucc->GetIdentifier()] = 1u;
+                    Stack.push_back(pSucc);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // _Order is the reverse post order from the entry followed by the unreachable blocks, _Merges is indexed by block identifier.
+    // _Splits are the edge splits that give a violating header its own merge or continue block.
+    // returns the number of headers violating the structured control flow rules
+    uint32_t StructuredMerges(const Function& _Function, std::vector<const BasicBlock*>& _Order, std::vector<MergeInfo>& _Merges, std::vector<EdgeSplit>& _Splits)
+    {
+        const ControlFlowGraph& cfg = _Function.GetCFG();
+        const size_t uNumBlocks = cfg.GetNodes().size();
+        const BasicBlock* pEntry = _Function.GetEntryBlock();
+
+        enum EState : uint8_t { kState_New = 0u, kState_Active, kState_Done };
+
+        struct Frame
+        {
+            const BasicBlock* pBB;
+            size_t uNext; // successor index
+        };
+
+        // back edges target a block on the DFS stack
+        std::vector<uint8_t> State(uNumBlocks, kState_New);
+        std::vector<std::pair<const BasicBlock*, const BasicBlock*>> BackEdges;
+        std::vector<Frame> Stack = { { pEntry, 0u } };
+        State[pEntry->GetIdentifier()] = kState_Active;
+        _Order.clear();
+
+        while (Stack.empty() == false)
+        {
+            Frame& Top = Stack.back();
+            if (Top.uNext < Top.pBB->GetSuccesors().size())
+            {
+                const BasicBlock* pSucc = Top.pBB->GetSuccesors()[Top.uNext++];
+                if (State[pSucc->GetIdentifier()] == kState_New)
+                {
+                    State[pSucc->GetIdentifier()] = kState_Active;
+                    Stack.push_back({ pSucc, 0u });
+                }
+                else if (State[pSucc->GetIdentifier()] == kState_Active)
+                {
+                    BackEdges.emplace_back(Top.pBB, pSucc);
+                }
+            }
+            else
+            {
+                State[Top.pBB->GetIdentifier()] = kState_Done;
+                _Order.push_back(Top.pBB);
+                Stack.pop_back();
+            }
+        }
+
+        std::reverse(_Order.begin(), _Order.end());
+        for (const BasicBlock& BB : cfg)
+        {
+            if (State[BB.GetIdentifier()] == kState_New)
+                _Order.push_back(&BB);
+        }
+
+        // loops: the header and all blocks on a path from the header to one of its back edge blocks
+        std::vector<InstrId> LoopIndex(uNumBlocks, InvalidId); // by header
+        std::vector<const BasicBlock*> Headers;
+        std::vector<std::vector<const BasicBlock*>> Latches;
+
+        for (const auto& [pLatch, pHeader] : BackEdges)
+        {
+            if (LoopIndex[pHeader->GetIdentifier()] == InvalidId)
+            {
+                LoopIndex[pHeader->GetIdentifier()] = static_cast<InstrId>(Headers.size());
+                Headers.push_back(pHeader);
+                Latches.emplace_back();
+            }
+            Latches[LoopIndex[pHeader->GetIdentifier()]].push_back(pLatch);
+        }
+
+        std::vector<std::vector<uint8_t>> Bodies(Headers.size(), std::vector<uint8_t>(uNumBlocks, 0u));
+        std::vector<size_t> BodySizes(Headers.size(), 1u);
+
+        std::vector<uint8_t> Reachable(uNumBlocks, 0u);
+        std::vector<uint8_t> MultipleEntries(Headers.size(), 0u);
+
+        for (size_t l = 0u; l < Headers.size(); ++l)
+        {
+            const InstrId uHeader = Headers[l]->GetIdentifier();
+
+            std::fill(Reachable.begin(), Reachable.end(), uint8_t(0u));
+            Reachable[uHeader] = 1u;
+
+            std::vector<const BasicBlock*> Work = { Headers[l] };
+            while (Work.empty() == false)
+            {
+                const BasicBlock* pBB = Work.back();
+                Work.pop_back();
+
+                for (const BasicBlock* pSucc : pBB->GetSuccesors())
+                {
+                    if (Reachable[pSucc->GetIdentifier()] == 0u)
+                    {
+                        Reachable[pSucc->GetIdentifier()] = 1u;
+                        Work.push_back(pSucc);
+                    }
+                }
+            }
+
+            std::vector<uint8_t>& Body = Bodies[l];
+            Body[uHeader] = 1u;
+
+            Work.assign(Latches[l].begin(), Latches[l].end());
+            while (Work.empty() == false)
+            {
+                const BasicBlock* pBB = Work.back();
+                Work.pop_back();
+
+                if (Body[pBB->GetIdentifier()] != 0u || Reachable[pBB->GetIdentifier()] == 0u)
+                    continue;
+
+                Body[pBB->GetIdentifier()] = 1u;
+                ++BodySizes[l];
+                Work.insert(Work.end(), pBB->GetPredecessors().begin(), pBB->GetPredecessors().end());
+            }
+
+            // irreducible: the loop is also entered past its header
+            for (size_t b = 0u; b < uNumBlocks && MultipleEntries[l] == 0u; ++b)
+            {
+                if (Body[b] == 0u || b == uHeader)
+                    continue;
+
+                for (const BasicBlock* pPred : cfg.GetNode(static_cast<InstrId>(b))->GetPredecessors())
+                {
+                    if (Body[pPred->GetIdentifier()] == 0u && State[pPred->GetIdentifier()] != kState_New)
+                        MultipleEntries[l] = 1u;
+                }
+            }
+        }
+
+        // innermost loop of each block, larger loops are assigned first
+        std::vector<size_t> BySize(Headers.size());
+        for (size_t l = 0u; l < Headers.size(); ++l)
+        {
+            BySize[l] = l;
+        }
+        std::sort(BySize.begin(), BySize.end(), [&](const size_t l, const size_t r) { return BodySizes[l] > BodySizes[r]; });
+
+        std::vector<InstrId> InnermostLoop(uNumBlocks, InvalidId);
+        for (const size_t l : BySize)
+        {
+            for (size_t b = 0u; b < uNumBlocks; ++b)
+            {
+                if (Bodies[l][b] != 0u)
+                    InnermostLoop[b] = static_cast<InstrId>(l);
+            }
+        }
+
+        const PostDominators PDom(_Function.GetExitBlock(), uNumBlocks);
+        std::vector<uint8_t> Claimed(uNumBlocks, 0u);
+        std::vector<uint8_t> Visited(uNumBlocks, 0u);
+        uint32_t uViolations = 0u;
+
+        _Merges.assign(uNumBlocks, {});
+        _Splits.clear();
+
+        // blocks of the construct branching to its merge, empty if one of them is not dominated by the header
+        const auto MergeSources = [&](const BasicBlock* pHeader, const BasicBlock* pMerge)
+        {
+            std::vector<const BasicBlock*> Sources;
+            std::fill(Reachable.begin(), Reachable.end(), uint8_t(0u));
+            Reachable[pHeader->GetIdentifier()] = 1u;
+
+            std::vector<const BasicBlock*> Work = { pHeader };
+            while (Work.empty() == false)
+            {
+                const BasicBlock* pBB = Work.back();
+                Work.pop_back();
+
+                for (const BasicBlock* pSucc : pBB->GetSuccesors())
+                {
+                    if (pSucc == pMerge)
+                    {
+                        Sources.push_back(pBB);
+                    }
+                    else if (Reachable[pSucc->GetIdentifier()] == 0u)
+                    {
+                        Reachable[pSucc->GetIdentifier()] = 1u;
+                        Work.push_back(pSucc);
+                    }
+                }
+            }
+
+            for (const BasicBlock* pSource : Sources)
+            {
+                if (Dominates(pEntry, pHeader, pSource, Visited) == false)
+                    return std::vector<const BasicBlock*>();
+            }
+
+            return Sources;
+        };
+
+        const auto SplitMerge = [&](const BasicBlock* pHeader, const BasicBlock* pMerge)
+        {
+            if (std::vector<const BasicBlock*> Sources = MergeSources(pHeader, pMerge); Sources.empty() == false)
+                _Splits.push_back({ pMerge, std::move(Sources), "_MERGE" });
+        };
+
+        const auto Violation = [&](const BasicBlock* pHeader, const std::string& sReason)
+        {
+            HLOGV("Header %s of function %s: %s", WCSTR(pHeader->GetName()), WCSTR(_Function.GetName()), WCSTR(sReason));
+            ++uViolations;
+        };
+
+        // dominating headers come first and claim their merge blocks before nested headers
+        for (const BasicBlock* pBB : _Order)
+        {
+            const InstrId uId = pBB->GetIdentifier();
+            MergeInfo& Merge = _Merges[uId];
+
+            if (LoopIndex[uId] != InvalidId)
+            {
+                const size_t l = LoopIndex[uId];
+                const BasicBlock* pMerge = PDom.GetImmediate(pBB);
+                while (pMerge != nullptr && Bodies[l][pMerge->GetIdentifier()] != 0u)
+                {
+                    pMerge = PDom.GetImmediate(pMerge);
+                }
+
+                if (pMerge == nullptr)
+                {
+                    Violation(pBB, "the loop never reaches the exit");
+                    continue;
+                }
+
+                if (MultipleEntries[l] != 0u)
+                    Violation(pBB, "the loop is entered past its header");
+                if (Latches[l].size() > 1u)
+                {
+                    Violation(pBB, "the loop has multiple back edges");
+                    if (MultipleEntries[l] == 0u)
+                        _Splits.push_back({ pBB, Latches[l], "_CONTINUE" });
+                }
+                if (Claimed[pMerge->GetIdentifier()] != 0u)
+                {
+                    Violation(pBB, "the loop merge block is shared with another header");
+                    SplitMerge(pBB, pMerge);
+                }
+
+                Claimed[pMerge->GetIdentifier()] = 1u;
+                Merge = { kMerge_Loop, pMerge, Latches[l].front() };
+                continue;
+            }
+
+            const Instruction* pTerminator = pBB->GetTerminator();
+            if (pTerminator == nullptr || pTerminator->Is(kInstruction_BranchCond) == false)
+                continue;
+
+            const BasicBlock* pTrue = pTerminator->GetOperandBB(1u);
+            const BasicBlock* pFalse = pTerminator->GetOperandBB(2u);
+
+            // back edges, breaks and continues of the innermost loop need no merge
+            if (const InstrId l = InnermostLoop[uId]; l != InvalidId)
+            {
+                const MergeInfo& Loop = _Merges[Headers[l]->GetIdentifier()];
+                const auto Exits = [&](const BasicBlock* pTarget) { return pTarget == Headers[l] || pTarget == Loop.pMerge || pTarget == Loop.pContinue; };
+                if (Exits(pTrue) || Exits(pFalse))
+                    continue;
+            }
+
+            const BasicBlock* pMerge = PDom.GetImmediate(pBB);
+            if (pMerge == nullptr)
+            {
+                Violation(pBB, "the branch never reaches the exit");
+                continue;
+            }
+
+            const bool bShared = Claimed[pMerge->GetIdentifier()] != 0u;
+            if (bShared)
+            {
+                // breaks to the merge of an enclosing selection
+                if (pTrue == pMerge || pFalse == pMerge)
+                    continue;
+
+                Violation(pBB, "the selection merge block is shared with another header");
+            }
+
+            const bool bDominated = Dominates(pEntry, pBB, pMerge, Visited);
+            if (bDominated == false)
+                Violation(pBB, "the header does not dominate its merge block");
+
+            // a selection in a loop keeps its merge inside the loop
+            const InstrId uLoop = InnermostLoop[uId];
+            if ((bShared || bDominated == false) && (uLoop == InvalidId || Bodies[uLoop][pMerge->GetIdentifier()] != 0u))
+                SplitMerge(pBB, pMerge);
+
+            Claimed[pMerge->GetIdentifier()] = 1u;
+            Merge = { kMerge_Selection, pMerge, nullptr };
+        }
+
+        return uViolations;
+    }
+
+    // the incoming values of the split edges move to a phi of the new block
+    void Split(Function& _Function, const EdgeSplit& _Split)
+    {
+        ControlFlowGraph& cfg = _Function.GetCFG();
+        BasicBlock* pTarget = cfg.GetNode(_Split.pTarget->GetIdentifier());
+        BasicBlock* pBlock = cfg.NewNode(pTarget->GetName() + _Split.sSuffix);
+
+        const auto IsSource = [&](const InstrId uBlock)
+        {
+            return std::any_of(_Split.Sources.begin(), _Split.Sources.end(), [uBlock](const BasicBlock* pSource) { return pSource->GetIdentifier() == uBlock; });
+        };
+
+        for (Instruction& Instr : *pTarget)
+        {
+            if (Instr.Is(kInstruction_Phi) == false)
+                continue;
+
+            const std::vector<Operand>& Operands = Instr.GetOperands();
+            const InstrId uCount = Operands[0].uId;
+
+            std::vector<Instruction*> Values, MovedValues;
+            std::vector<BasicBlock*> Origins, MovedOrigins;
+            for (InstrId i = 0u; i < uCount; ++i)
+            {
+                Instruction* pValue = cfg.GetInstruction(Operands[1u + i].uId);
+                BasicBlock* pOrigin = cfg.GetNode(Operands[1u + uCount + i].uId);
+                if (IsSource(pOrigin->GetIdentifier()))
+                {
+                    MovedValues.push_back(pValue);
+                    MovedOrigins.push_back(pOrigin);
+                }
+                else
+                {
+                    Values.push_back(pValue);
+                    Origins.push_back(pOrigin);
+                }
+            }
+
+            if (MovedValues.empty())
+                continue;
+
+            Values.push_back(pBlock->AddInstruction()->Phi(MovedValues, MovedOrigins));
+            Origins.push_back(pBlock);
+            Instr.Reset()->Phi(Values, Origins);
+        }
+
+        for (const BasicBlock* pSource : _Split.Sources)
+        {
+            Instruction* pTerminator = cfg.GetNode(pSource->GetIdentifier())->GetTerminator();
+            if (pTerminator->Is(kInstruction_Branch))
+            {
+                pTerminator->Reset()->Branch(pBlock);
+            }
+            else
+            {
+                const Instruction* pCondition = pTerminator->GetOperandInstr(0u);
+                BasicBlock* pTrue = pTerminator->GetOperandBB(1u);
+                BasicBlock* pFalse = pTerminator->GetOperandBB(2u);
+                pTerminator->Reset()->BranchCond(pCondition, pTrue == pTarget ? pBlock : pTrue, pFalse == pTarget ? pBlock : pFalse);
+            }
+        }
+
+        pBlock->AddInstruction()->Branch(pTarget);
+    }
+
+    bool IsValue(const Instruction* _pInstr)
+    {
+        switch (_pInstr->GetInstruction())
+        {
+        case kInstruction_Phi:
+        case kInstruction_Not:
+        case kInstruction_Equal:
+        case kInstruction_NotEqual:
+        case kInstruction_Less:
+        case kInstruction_LessEqual:
+        case kInstruction_Greater:
+        case kInstruction_GreaterEqual:
+        case kInstruction_Add:
+        case kInstruction_Sub:
+        case kInstruction_Mul:
+        case kInstruction_Div:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // interface variables hold numeric scalars and vectors
+    bool IsInterfaceType(const TypeInfo& _Type)
+    {
+        return (_Type.kType == kType_Int || _Type.kType == kType_UInt || _Type.kType == kType_Float) && _Type.uElementCount <= 4u;
+    }
+
+    bool Emit(const Function& _Function, const std::vector<const BasicBlock*>& _Order, const std::vector<MergeInfo>& _Merges, SPIRVModule& _Module)
+    {
+        const ControlFlowGraph& cfg = _Function.GetCFG();
+
+        _Module.Capability(kSPIRVCapability_Shader, "Shader");
+        _Module.Add(kSPIRVSection_MemoryModel, kSPIRVOp_MemoryModel, 0u, 0u, { Literal(uSPIRVAddressingLogical, "Logical"), Literal(uSPIRVMemoryModelGLSL450, "GLSL450") });
+
+        std::unordered_map<InstrId, uint32_t> TypeIds;
+
+        const auto GetType = [&](const InstrId uTypeId) -> uint32_t
+        {
+            auto it = TypeIds.find(uTypeId);
+            if (it != TypeIds.end())
+                return it->second;
+
+            const uint32_t uType = DeclareType(_Module, cfg.ResolveType(uTypeId));
+            TypeIds.emplace(uTypeId, uType);
+            return uType;
+        };
+
+        const auto GetPointer = [&](const uint32_t uStorageClass, const char* sStorageClass, const uint32_t uType)
+        {
+            return _Module.Declare(kSPIRVOp_TypePointer, 0u, { Literal(uStorageClass, sStorageClass), Id(uType) });
+        };
+
+        std::vector<uint32_t> Ids(cfg.GetInstructions().size(), 0u);
+        std::vector<uint32_t> Labels(cfg.GetNodes().size(), 0u);
+        const uint32_t uFunction = _Module.NewId();
+
+        // divergent parameters are per lane inputs, uniform parameters are read from push constants
+        struct ParameterLoad
+        {
+            InstrId uParameter;
+            uint32_t uType;
+            uint32_t uVariable; // 0 for push constants
+            uint32_t uMember;
+        };
+
+        std::vector<ParameterLoad> Loads;
+        std::vector<SPIRVOperand> Interface;
+        std::vector<SPIRVOperand> Members;
+        std::vector<std::string> MemberNames;
+        std::vector<uint32_t> MemberOffsets;
+        uint32_t uOffset = 0u;
+        uint32_t uLocation = 0u;
+
+        for (const Instruction* pParam : _Function.GetParameters())
+        {
+            const TypeInfo Type = cfg.ResolveType(pParam->GetResultTypeId());
+            const uint32_t uType = GetType(pParam->GetResultTypeId());
+
+            if (uType == 0u || IsInterfaceType(Type) == false)
+            {
+                HLOGE("Parameter %s of function %s can not be passed to a shader", WCSTR(pParam->GetAlias()), WCSTR(_Function.GetName()));
+                return false;
+            }
+
+            Ids[pParam->GetIdentifier()] = _Module.NewId();
+
+            if (pParam->Is(kDecoration_Divergent))
+            {
+                const uint32_t uVariable = _Module.NewId();
+                _Module.Add(kSPIRVSection_Globals, kSPIRVOp_Variable, GetPointer(kSPIRVStorageClass_Input, "Input", uType), uVariable, { Literal(kSPIRVStorageClass_Input, "Input") });
+                _Module.Decorate(uVariable, kSPIRVDecoration_Location, "Location", { Literal(uLocation++) });
+
+                // integers and doubles are not interpolated
+                if (Type.kType != kType_Float || Type.uElementBits == 64u)
+                    _Module.Decorate(uVariable, kSPIRVDecoration_Flat, "Flat");
+
+                _Module.Name(uVariable, pParam->GetAlias());
+                Interface.push_back(Id(uVariable));
+                Loads.push_back({ pParam->GetIdentifier(), uType, uVariable, 0u });
+            }
+            else
+            {
+                // scalar alignment, vectors of three are aligned like four
+                const uint32_t uScalarBytes = Type.uElementBits / 8u;
+                const uint32_t uAlign = uScalarBytes * (Type.uElementCount == 1u ? 1u : (Type.uElementCount == 2u ? 2u : 4u));
+                uOffset = (uOffset + uAlign - 1u) / uAlign * uAlign;
+
+                Loads.push_back({ pParam->GetIdentifier(), uType, 0u, static_cast<uint32_t>(Members.size()) });
+                Members.push_back(Id(uType));
+                MemberNames.push_back(pParam->GetAlias());
+                MemberOffsets.push_back(uOffset);
+                uOffset += uScalarBytes * Type.uElementCount;
+            }
+        }
+
+        uint32_t uParameters = 0u;
+        if (Members.empty() == false)
+        {
+            // not deduplicated, the struct carries the block decoration
+            const uint32_t uBlock = _Module.NewId();
+            _Module.Add(kSPIRVSection_Globals, kSPIRVOp_TypeStruct, 0u, uBlock, std::move(Members));
+            _Module.Decorate(uBlock, kSPIRVDecoration_Block, "Block");
+            _Module.Name(uBlock, "Parameters");
+
+            for (uint32_t m = 0u; m < MemberOffsets.size(); ++m)
+            {
+                _Module.Add(kSPIRVSection_Decorations, kSPIRVOp_MemberDecorate, 0u, 0u, { Id(uBlock), Literal(m), Literal(kSPIRVDecoration_Offset, "Offset"), Literal(MemberOffsets[m]) });
+                _Module.Add(kSPIRVSection_Names, kSPIRVOp_MemberName, 0u, 0u, { Id(uBlock), Literal(m), _Module.String(MemberNames[m]) });
+            }
+
+            uParameters = _Module.NewId();
+            _Module.Add(kSPIRVSection_Globals, kSPIRVOp_Variable, GetPointer(kSPIRVStorageClass_PushConstant, "PushConstant", uBlock), uParameters, { Literal(kSPIRVStorageClass_PushConstant, "PushConstant") });
+        }
+
+        // the return value is the fragment output
+        uint32_t uOutput = 0u;
+        if (const Instruction* pReturnType = _Function.GetReturnType(); pReturnType != nullptr && cfg.ResolveType(pReturnType).kType != kType_Void)
+        {
+            const uint32_t uType = GetType(pReturnType->GetIdentifier());
+            if (uType == 0u || IsInterfaceType(cfg.ResolveType(pReturnType)) == false)
+            {
+                HLOGE("Function %s returns a type that can not be a shader output", WCSTR(_Function.GetName()));
+                return false;
+            }
+
+            uOutput = _Module.NewId();
+            _Module.Add(kSPIRVSection_Globals, kSPIRVOp_Variable, GetPointer(kSPIRVStorageClass_Output, "Output", uType), uOutput, { Literal(kSPIRVStorageClass_Output, "Output") });
+            _Module.Decorate(uOutput, kSPIRVDecoration_Location, "Location", { Literal(0u) });
+            Interface.push_back(Id(uOutput));
+        }
+
+        const uint32_t uVoid = _Module.Declare(kSPIRVOp_TypeVoid, 0u, {});
+        const uint32_t uFunctionType = _Module.Declare(kSPIRVOp_TypeFunction, 0u, { Id(uVoid) });
+
+        std::vector<SPIRVOperand> EntryPoint = { Literal(uSPIRVExecutionModelFragment, "Fragment"), Id(uFunction), _Module.String("main") };
+        EntryPoint.insert(EntryPoint.end(), Interface.begin(), Interface.end());
+        _Module.Add(kSPIRVSection_EntryPoints, kSPIRVOp_EntryPoint, 0u, 0u, std::move(EntryPoint));
+        _Module.Add(kSPIRVSection_ExecutionModes, kSPIRVOp_ExecutionMode, 0u, 0u, { Id(uFunction), Literal(uSPIRVExecutionModeOriginUpperLeft, "OriginUpperLeft") });
+        _Module.Name(uFunction, _Function.GetName());
+
+        for (const Instruction& Instr : *cfg.begin())
+        {
+            if (Instr.Is(kInstruction_Constant) == false)
+                continue;
+
+            const TypeInfo Type = cfg.ResolveType(Instr.GetResultTypeId());
+            const uint32_t uType = GetType(Instr.GetResultTypeId());
+            const uint64_t uBits = ConstantBits(Instr);
+
+            if (uType == 0u)
+                continue;
+
+            if (Type.uElementCount > 1u || Type.kType == kType_Void || Type.kType == kType_Array || Type.kType == kType_Struct)
+            {
+                Ids[Instr.GetIdentifier()] = _Module.Declare(kSPIRVOp_Undef, uType, {});
+            }
+            else if (Type.kType == kType_Bool)
+            {
+                Ids[Instr.GetIdentifier()] = _Module.Declare((uBits & 1u) != 0u ? kSPIRVOp_ConstantTrue : kSPIRVOp_ConstantFalse, uType, {});
+            }
+            else
+            {
+                // narrow signed integers are sign extended to the word, narrow floats zero extended
+                const uint64_t uValue = Extend(uBits, Type.uElementBits, Type.kType == kType_Int);
+                std::vector<SPIRVOperand> Literals = { Literal(static_cast<uint32_t>(uValue)) };
+                if (Type.uElementBits > 32u)
+                    Literals.push_back(Literal(static_cast<uint32_t>(uValue >> 32u)));
+
+                Ids[Instr.GetIdentifier()] = _Module.Declare(kSPIRVOp_Constant, uType, std::move(Literals), ConstantText(Type, uBits));
+            }
+        }
+
+        // mov forwards the value of its source
+        std::unordered_map<InstrId, InstrId> Forwards;
+        for (const Instruction* pInstr : cfg.GetInstructions())
+        {
+            if (pInstr != nullptr && pInstr->Is(kInstruction_Mov))
+                Forwards[pInstr->GetIdentifier()] = pInstr->GetOperands()[0].uId;
+        }
+
+        for (const BasicBlock* pBB : _Order)
+        {
+            Labels[pBB->GetIdentifier()] = _Module.NewId();
+            for (const Instruction& Instr : *pBB)
+            {
+                if (IsValue(&Instr))
+                {
+                    GetType(Instr.GetResultTypeId());
+                    Ids[Instr.GetIdentifier()] = _Module.NewId();
+                }
+            }
+        }
+
+        for (const auto& [uTypeId, uType] : TypeIds)
+        {
+            if (uType == 0u)
+            {
+                HLOGE("Function %s uses a type without SPIR-V equivalent", WCSTR(_Function.GetName()));
+                return false;
+            }
+        }
+
+        bool bValid = true;
+
+        const auto GetValue = [&](InstrId uId) -> SPIRVOperand
+        {
+            for (auto it = Forwards.find(uId); it != Forwards.end(); it = Forwards.find(uId))
+            {
+                uId = it->second;
+            }
+
+            const uint32_t uValue = uId < Ids.size() ? Ids[uId] : 0u;
+            bValid &= uValue != 0u;
+            return Id(uValue);
+        };
+
+        const auto OperandType = [&](const Instruction* pInstr) { return cfg.ResolveType(cfg.GetInstruction(pInstr->GetOperands()[0].uId)->GetResultTypeId()); };
+
+        _Module.Add(kSPIRVSection_Functions, kSPIRVOp_Function, uVoid, uFunction, { Literal(uSPIRVControlNone, "None"), Id(uFunctionType) });
+
+        for (const BasicBlock* pBB : _Order)
+        {
+            _Module.Add(kSPIRVSection_Functions, kSPIRVOp_Label, 0u, Labels[pBB->GetIdentifier()], {});
+            _Module.Name(Labels[pBB->GetIdentifier()], pBB->GetName());
+
+            if (pBB == _Order.front())
+            {
+                for (const ParameterLoad& Load : Loads)
+                {
+                    uint32_t uPointer = Load.uVariable;
+                    if (uPointer == 0u)
+                    {
+                        const uint32_t uIndexType = _Module.Declare(kSPIRVOp_TypeInt, 0u, { Literal(32u), Literal(1u) });
+                        const uint32_t uIndex = _Module.Declare(kSPIRVOp_Constant, uIndexType, { Literal(Load.uMember) }, std::to_string(Load.uMember));
+
+                        uPointer = _Module.NewId();
+                        _Module.Add(kSPIRVSection_Functions, kSPIRVOp_AccessChain, GetPointer(kSPIRVStorageClass_PushConstant, "PushConstant", Load.uType), uPointer,
+                            { Id(uParameters), Id(uIndex) }).uSource = Load.uParameter;
+                    }
+
+                    _Module.Add(kSPIRVSection_Functions, kSPIRVOp_Load, Load.uType, Ids[Load.uParameter], { Id(uPointer) }).uSource = Load.uParameter;
+                }
+            }
+
+            // phis are moved to the front of their block
+            std::vector<const Instruction*> Instrs;
+            for (const Instruction& Instr : *pBB)
+            {
+                if (Instr.Is(kInstruction_Phi))
+                    Instrs.push_back(&Instr);
+            }
+
+            for (const Instruction& Instr : *pBB)
+            {
+                if (IsValue(&Instr) && Instr.Is(kInstruction_Phi) == false)
+                    Instrs.push_back(&Instr);
+            }
+
+            for (const Instruction* pInstr : Instrs)
+            {
+                const std::vector<Operand>& Operands = pInstr->GetOperands();
+                const uint32_t uType = GetType(pInstr->GetResultTypeId());
+                const uint32_t uResult = Ids[pInstr->GetIdentifier()];
+                std::vector<SPIRVOperand> Args;
+                uint32_t uOpcode = 0u;
+
+                switch (pInstr->GetInstruction())
+                {
+                case kInstruction_Phi:
+                {
+                    const InstrId uCount = Operands[0].uId;
+                    for (InstrId i = 0u; i < uCount; ++i)
+                    {
+                        Args.push_back(GetValue(Operands[1u + i].uId));
+                        Args.push_back(Id(Labels[Operands[1u + uCount + i].uId]));
+                    }
+                    uOpcode = kSPIRVOp_Phi;
+                    break;
+                }
+                case kInstruction_Not:
+                {
+                    const EType kType = cfg.ResolveType(pInstr->GetResultTypeId()).kType;
+                    if (kType == kType_Bool)
+                        uOpcode = kSPIRVOp_LogicalNot;
+                    else if (kType == kType_Int || kType == kType_UInt)
+                        uOpcode = kSPIRVOp_Not;
+                    Args.push_back(GetValue(Operands[0].uId));
+                    break;
+                }
+                case kInstruction_Equal:
+                case kInstruction_NotEqual:
+                case kInstruction_Less:
+                case kInstruction_LessEqual:
+                case kInstruction_Greater:
+                case kInstruction_GreaterEqual:
+                {
+                    // same predicates as the LLVM backend: ordered float comparisons except for not equal
+                    static constexpr uint32_t SignedOps[] = { kSPIRVOp_IEqual, kSPIRVOp_INotEqual, kSPIRVOp_SLessThan, kSPIRVOp_SLessThanEqual, kSPIRVOp_SGreaterThan, kSPIRVOp_SGreaterThanEqual };
+                    static constexpr uint32_t UnsignedOps[] = { kSPIRVOp_IEqual, kSPIRVOp_INotEqual, kSPIRVOp_ULessThan, kSPIRVOp_ULessThanEqual, kSPIRVOp_UGreaterThan, kSPIRVOp_UGreaterThanEqual };
+                    static constexpr uint32_t FloatOps[] = { kSPIRVOp_FOrdEqual, kSPIRVOp_FUnordNotEqual, kSPIRVOp_FOrdLessThan, kSPIRVOp_FOrdLessThanEqual, kSPIRVOp_FOrdGreaterThan, kSPIRVOp_FOrdGreaterThanEqual };
+
+                    const uint32_t uPredicate = pInstr->GetInstruction() - kInstruction_Equal;
+                    switch (OperandType(pInstr).kType)
+                    {
+                    case kType_Bool:
+                        if (uPredicate < 2u)
+                            uOpcode = uPredicate == 0u ? kSPIRVOp_LogicalEqual : kSPIRVOp_LogicalNotEqual;
+                        break;
+                    case kType_Int:
+                        uOpcode = SignedOps[uPredicate];
+                        break;
+                    case kType_UInt:
+                        uOpcode = UnsignedOps[uPredicate];
+                        break;
+                    case kType_Float:
+                        uOpcode = FloatOps[uPredicate];
+                        break;
+                    default:
+                        break;
+                    }
+                    Args = { GetValue(Operands[0].uId), GetValue(Operands[1].uId) };
+                    break;
+                }
+                case kInstruction_Add:
+                case kInstruction_Sub:
+                case kInstruction_Mul:
+                case kInstruction_Div:
+                {
+                    static constexpr uint32_t IntOps[] = { kSPIRVOp_IAdd, kSPIRVOp_ISub, kSPIRVOp_IMul, kSPIRVOp_SDiv };
+                    static constexpr uint32_t FloatOps[] = { kSPIRVOp_FAdd, kSPIRVOp_FSub, kSPIRVOp_FMul, kSPIRVOp_FDiv };
+
+                    const uint32_t uOp = pInstr->GetInstruction() - kInstruction_Add;
+                    switch (cfg.ResolveType(pInstr->GetResultTypeId()).kType)
+                    {
+                    case kType_Int:
+                        uOpcode = IntOps[uOp];
+                        break;
+                    case kType_UInt:
+                        uOpcode = pInstr->Is(kInstruction_Div) ? kSPIRVOp_UDiv : IntOps[uOp];
+                        break;
+                    case kType_Float:
+                        uOpcode = FloatOps[uOp];
+                        break;
+                    default:
+                        break;
+                    }
+                    Args = { GetValue(Operands[0].uId), GetValue(Operands[1].uId) };
+                    break;
+                }
+                default:
+                    break;
+                }
+
+                if (uOpcode == 0u)
+                {
+                    HLOGE("Instruction %s of function %s has no SPIR-V equivalent for its operand types", WCSTR(pInstr->GetAlias()), WCSTR(_Function.GetName()));
+                    return false;
+                }
+
+                _Module.Add(kSPIRVSection_Functions, uOpcode, uType, uResult, std::move(Args)).uSource = pInstr->GetIdentifier();
+
+                const std::string& sAlias = pInstr->GetAlias();
+                if (std::all_of(sAlias.begin(), sAlias.end(), [](const char c) {return c >= '0' && c <= '9'; }) == false)
+                {
+                    _Module.Name(uResult, sAlias);
+                }
+            }
+
+            const Instruction* pTerminator = pBB->GetTerminator();
+            const std::vector<Operand>& Operands = pTerminator->GetOperands();
+            const MergeInfo& Merge = _Merges[pBB->GetIdentifier()];
+
+            if (Merge.kMerge == kMerge_Loop)
+            {
+                _Module.Add(kSPIRVSection_Functions, kSPIRVOp_LoopMerge, 0u, 0u,
+                    { Id(Labels[Merge.pMerge->GetIdentifier()]), Id(Labels[Merge.pContinue->GetIdentifier()]), Literal(uSPIRVControlNone, "None") }).uSource = pTerminator->GetIdentifier();
+            }
+            else if (Merge.kMerge == kMerge_Selection)
+            {
+                _Module.Add(kSPIRVSection_Functions, kSPIRVOp_SelectionMerge, 0u, 0u,
+                    { Id(Labels[Merge.pMerge->GetIdentifier()]), Literal(uSPIRVControlNone, "None") }).uSource = pTerminator->GetIdentifier();
+            }
+
+            switch (pTerminator->GetInstruction())
+            {
+            case kInstruction_Return:
+                if (Operands.size() == 1u && uOutput != 0u)
+                {
+                    _Module.Add(kSPIRVSection_Functions, kSPIRVOp_Store, 0u, 0u, { Id(uOutput), GetValue(Operands[0].uId) }).uSource = pTerminator->GetIdentifier();
+                }
+                _Module.Add(kSPIRVSection_Functions, kSPIRVOp_Return, 0u, 0u, {}).uSource = pTerminator->GetIdentifier();
+                break;
+            case kInstruction_Branch:
+                _Module.Add(kSPIRVSection_Functions, kSPIRVOp_Branch, 0u, 0u, { Id(Labels[Operands[0].uId]) }).uSource = pTerminator->GetIdentifier();
+                break;
+            case kInstruction_BranchCond:
+                _Module.Add(kSPIRVSection_Functions, kSPIRVOp_BranchConditional, 0u, 0u,
+                    { GetValue(Operands[0].uId), Id(Labels[Operands[1].uId]), Id(Labels[Operands[2].uId]) }).uSource = pTerminator->GetIdentifier();
+                break;
+            default:
+                HLOGE("Block %s of function %s ends with an unsupported terminator", WCSTR(pBB->GetName()), WCSTR(_Function.GetName()));
+                return false;
+            }
+        }
+
+        _Module.Add(kSPIRVSection_Functions, kSPIRVOp_FunctionEnd, 0u, 0u, {});
+
+        if (bValid == false)
+        {
+            HLOGE("Function %s uses values that are not defined", WCSTR(_Function.GetName()));
+        }
+
+        return bValid;
+    }
+
+    bool Translate(const Function& _Function, SPIRVModule& _Module)
+    {
+        for (const BasicBlock& BB : _Function.GetCFG())
+        {
+            if (BB.GetTerminator() == nullptr)
+            {
+                HLOGE("Block %s of function %s has no terminator, the function needs to be finalized", WCSTR(BB.GetName()), WCSTR(_Function.GetName()));
+                return false;
+            }
+        }
+
+        std::vector<const BasicBlock*> Order;
+        std::vector<MergeInfo> Merges;
+        std::vector<EdgeSplit> Splits;
+        uint32_t uViolations = StructuredMerges(_Function, Order, Merges, Splits);
+
+        // splits are applied to a copy, every round gives at least one header its own merge or continue block
+        std::optional<Function> Structured;
+        const size_t uMaxRounds = _Function.GetCFG().GetNodes().size();
+        for (size_t uRound = 0u; uViolations != 0u && Splits.empty() == false && uRound < uMaxRounds; ++uRound)
+        {
+            if (Structured.has_value() == false)
+            {
+                std::ostringstream Stream;
+                if (FunctionBinary::Write(_Function, Stream) == false)
+                    break;
+
+                const std::string sData = Stream.str();
+                std::vector<uint64_t> Binary((sData.size() + 7u) / 8u, 0u);
+                std::memcpy(Binary.data(), sData.data(), sData.size());
+                Structured.emplace(FunctionBinary::Load(FunctionView(Binary.data(), Binary.size() * sizeof(uint64_t))));
+            }
+
+            // a block is split once per round, the other splits are found again in the next round
+            std::vector<uint8_t> Touched(Structured->GetCFG().GetNodes().size(), 0u);
+            for (const EdgeSplit& Edges : Splits)
+            {
+                const auto IsTouched = [&](const BasicBlock* pBB) { return Touched[pBB->GetIdentifier()] != 0u; };
+                if (IsTouched(Edges.pTarget) || std::any_of(Edges.Sources.begin(), Edges.Sources.end(), IsTouched))
+                    continue;
+
+                Touched[Edges.pTarget->GetIdentifier()] = 1u;
+                for (const BasicBlock* pSource : Edges.Sources)
+                {
+                    Touched[pSource->GetIdentifier()] = 1u;
+                }
+
+                Split(*Structured, Edges);
+            }
+
+            uViolations = StructuredMerges(*Structured, Order, Merges, Splits);
+        }
+
+        if (uViolations != 0u)
+        {
+            // the module would not pass validation, Vulkan rejects unstructured control flow
+            HLOGE("%u headers of function %s violate the structured control flow rules", uViolations, WCSTR(_Function.GetName()));
+            return false;
+        }
+
+        if (Structured.has_value())
+        {
+            HLOGV("Function %s: %zu blocks inserted for structured control flow", WCSTR(_Function.GetName()), Structured->GetCFG().GetNodes().size() - _Function.GetCFG().GetNodes().size());
+            return Emit(*Structured, Order, Merges, _Module);
+        }
+
+        return Emit(_Function, Order, Merges, _Module);
+    }
+} // anonymous namespace
+
+std::string InstructionSetSPIRV::ResolveTypeName(const TypeInfo& _Type)
+{
+    std::string sType;
+
+    switch (_Type.kType)
+    {
+    case kType_Void:
+        return "void";
+    case kType_Bool:
+        sType = "bool";
+        break;
+    case kType_Int:
+    case kType_UInt:
+        sType = _Type.kType == kType_Int ? "int" : "uint";
+        if (_Type.uElementBits != 32u)
+            sType += std::to_string(_Type.uElementBits);
+        break;
+    case kType_Float:
+        if (_Type.uElementBits == 16u)
+            sType = "half";
+        else if (_Type.uElementBits == 32u)
+            sType = "float";
+        else if (_Type.uElementBits == 64u)
+            sType = "double";
+        break;
+    case kType_Pointer:
+        return "_ptr_" + ResolveTypeName(_Type.SubTypes.front());
+    case kType_Array:
+        return "_arr_" + ResolveTypeName(_Type.SubTypes.front()) + '_' + std::to_string(_Type.uElementCount);
+    case kType_Struct:
+        sType = "_struct";
+        for (const TypeInfo& Sub : _Type.SubTypes)
+        {
+            sType += '_' + ResolveTypeName(Sub);
+        }
+        return sType;
+    default:
+        break;
+    }
+
+    if (_Type.uElementCount > 1u)
+        sType = 'v' + std::to_string(_Type.uElementCount) + sType;
+
+    return sType;
+}
+
+std::string InstructionSetSPIRV::ResolveConstant(const Function& _Function, const Instruction& _Instruction)
+{
+    return ConstantText(_Function.GetCFG().ResolveType(_Instruction.GetResultTypeId()), ConstantBits(_Instruction));
+}
+
+bool InstructionSetSPIRV::SerializeInstruction(const Function& _Function, const Instruction& _Instruction, std::ostream& _OutStream)
+{
+    SPIRVModule Module;
+    if (Translate(_Function, Module) == false)
+        return false;
+
+    m_Buffer.clear();
+    const bool bWritten = Module.WriteListing(m_Buffer, _Instruction.GetIdentifier());
+    _OutStream.write(m_Buffer.data(), m_Buffer.size());
+
+    return bWritten;
+}
+
+bool InstructionSetSPIRV::SerializeListing(const Function& _Function, std::ostream& _OutStream)
+{
+    SPIRVModule Module;
+    if (Translate(_Function, Module) == false)
+        return false;
+
+    m_Buffer.clear();
+    Module.WriteListing(m_Buffer);
+    _OutStream.write(m_Buffer.data(), m_Buffer.size());
+
+    return _OutStream.good();
+}
+
+bool InstructionSetSPIRV::SerializeBinary(const Function& _Function, std::ostream& _OutStream)
+{
+    SPIRVModule Module;
+    if (Translate(_Function, Module) == false)
+        return false;
+
+    const std::vector<uint32_t> Words = Module.GetWords();
+    _OutStream.write(reinterpret_cast<const char*>(Words.data()), Words.size() * sizeof(uint32_t));
+
+    return _OutStream.good();
+}
@@ -0,0 +1,205 @@
+#include "LocalSocket.h"
+#include "LogLevel.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+    using NativeSocket = SOCKET;
+
+    int CloseNative(const NativeSocket _hSocket) { return closesocket(_hSocket); }
+
+    // winsock needs to be initialized once per process
+    bool StartupSockets()
+    {
+        static const bool bStarted = []()
+        {
+            WSADATA Data;
+            return WSAStartup(MAKEWORD(2, 2), &Data) == 0;
+        }();
+        return bStarted;
+    }
+#else
+    using NativeSocket = int;
+
+    int CloseNative(const NativeSocket _hSocket) { return close(_hSocket); }
+
+    bool StartupSockets() { return true; }
+#endif
+
+    NativeSocket ToNative(const SocketHandle _hSocket) { return static_cast<NativeSocket>(_hSocket); }
+
+    // partial reads and writes are allowed, <= 0 on failure or a closed connection
+    int64_t Receive(const SocketHandle _hSocket, char* _pData, const size_t _uSize)
+    {
+        return recv(ToNative(_hSocket), _pData, static_cast<int>(_uSize), 0);
+    }
+
+    int64_t Send(const SocketHandle _hSocket, const char* _pData, const size_t _uSize)
+    {
+        // a client disconnecting early must not terminate the server with SIGPIPE
+#ifdef MSG_NOSIGNAL
+        return send(ToNative(_hSocket), _pData, static_cast<int>(_uSize), MSG_NOSIGNAL);
+#else
+        return send(ToNative(_hSocket), _pData, static_cast<int>(_uSize), 0);
+#endif
+    }
+} // anonymous namespace
+
+SocketStream::Buffer::Buffer(const SocketHandle _hSocket) :
+    m_hSocket(_hSocket)
+{
+    setg(m_In, m_In, m_In);
+    setp(m_Out, m_Out + sizeof(m_Out));
+}
+
+SocketStream::Buffer::int_type SocketStream::Buffer::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    // the reply of the previous request needs to be sent before blocking on the next one
+    if (Flush() == false)
+        return traits_type::eof();
+
+    const int64_t iRead = Receive(m_hSocket, m_In, sizeof(m_In));
+    if (iRead <= 0)
+        return traits_type::eof();
+
+    setg(m_In, m_In, m_In + iRead);
+    return traits_type::to_int_type(*gptr());
+}
+
+SocketStream::Buffer::int_type SocketStream::Buffer::overflow(int_type _Char)
+{
+    if (Flush() == false)
+        return traits_type::eof();
+
+    if (traits_type::eq_int_type(_Char, traits_type::eof()) == false)
+    {
+        *pptr() = traits_type::to_char_type(_Char);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(_Char);
+}
+
+int SocketStream::Buffer::sync()
+{
+    return Flush() ? 0 : -1;
+}
+
+bool SocketStream::Buffer::Flush()
+{
+    for (const char* pData = pbase(); pData < pptr();)
+    {
+        const int64_t iSent = Send(m_hSocket, pData, static_cast<size_t>(pptr() - pData));
+        if (iSent <= 0)
+            return false;
+
+        pData += iSent;
+    }
+
+    setp(m_Out, m_Out + sizeof(m_Out));
+    return true;
+}
+
+SocketStream::SocketStream(const SocketHandle _hSocket) :
+    std::iostream(nullptr),
+    m_hSocket(_hSocket),
+    m_Buffer(_hSocket)
+{
+    rdbuf(&m_Buffer);
+}
+
+SocketStream::~SocketStream()
+{
+    flush();
+    CloseNative(ToNative(m_hSocket));
+}
+
+bool LocalSocketServer::Listen(const std::filesystem::path& _Path)
+{
+    Close();
+
+    if (StartupSockets() == false)
+    {
+        HLOGE("Failed to initialize sockets");
+        return false;
+    }
+
+    sockaddr_un Address;
+    std::memset(&Address, 0, sizeof(Address));
+    Address.sun_family = AF_UNIX;
+
+    const std::string sPath = _Path.string();
+    if (sPath.size() >= sizeof(Address.sun_path))
+    {
+        HLOGE("Socket path %s is too long", WCSTR(sPath));
+        return false;
+    }
+    std::memcpy(Address.sun_path, sPath.c_str(), sPath.size());
+
+    const NativeSocket hSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+#ifdef _WIN32
+    if (hSocket == INVALID_SOCKET)
+#else
+    if (hSocket < 0)
+#endif
+    {
+        HLOGE("Failed to create a socket");
+        return false;
+    }
+
+    // a file left behind by a previous server
+    std::error_code Error;
+    std::filesystem::remove(_Path, Error);
+
+    if (bind(hSocket, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address)) != 0 || listen(hSocket, SOMAXCONN) != 0)
+    {
+        HLOGE("Failed to listen on %s", WCSTR(sPath));
+        CloseNative(hSocket);
+        return false;
+    }
+
+    m_hSocket = static_cast<SocketHandle>(hSocket);
+    m_Path = _Path;
+    return true;
+}
+
+SocketHandle LocalSocketServer::Accept()
+{
+    if (m_hSocket == InvalidSocket)
+        return InvalidSocket;
+
+    const NativeSocket hClient = accept(ToNative(m_hSocket), nullptr, nullptr);
+#ifdef _WIN32
+    return hClient == INVALID_SOCKET ? InvalidSocket : static_cast<SocketHandle>(hClient);
+#else
+    return hClient < 0 ? InvalidSocket : static_cast<SocketHandle>(hClient);
+#endif
+}
+
+void LocalSocketServer::Close()
+{
+    if (m_hSocket != InvalidSocket)
+    {
+        CloseNative(ToNative(m_hSocket));
+        m_hSocket = InvalidSocket;
+
+        std::error_code Error;
+        std::filesystem::remove(m_Path, Error);
+    }
+}
@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& _Other) noexcept
+{
+    *this = std::move(_Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& _Other) noexcept
+{
+    if (this != &_Other)
+    {
+        Close();
+
+        std::swap(m_pData, _Other.m_pData);
+        std::swap(m_uSize, _Other.m_uSize);
+#ifdef _WIN32
+        std::swap(m_hFile, _Other.m_hFile);
+        std::swap(m_hMapping, _Other.m_hMapping);
+#endif
+    }
+
+    return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::filesystem::path& _Path)
+{
+    Close();
+
+    HANDLE hFile = CreateFileW(_Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER Size;
+    if (GetFileSizeEx(hFile, &Size) == FALSE || Size.QuadPart == 0)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* pView = hMapping != nullptr ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (pView == nullptr)
+    {
+        if (hMapping != nullptr)
+            CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    m_hFile = hFile;
+    m_hMapping = hMapping;
+    m_pData = static_cast<const uint8_t*>(pView);
+    m_uSize = static_cast<size_t>(Size.QuadPart);
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+        CloseHandle(m_hMapping);
+        CloseHandle(m_hFile);
+    }
+
+    m_pData = nullptr;
+    m_uSize = 0u;
+    m_hFile = nullptr;
+    m_hMapping = nullptr;
+}
+#else
+bool MappedFile::Open(const std::filesystem::path& _Path)
+{
+    Close();
+
+    const int iFile = open(_Path.c_str(), O_RDONLY);
+    if (iFile < 0)
+        return false;
+
+    struct stat Stat;
+    if (fstat(iFile, &Stat) != 0 || Stat.st_size == 0)
+    {
+        close(iFile);
+        return false;
+    }
+
+    // the mapping stays valid after closing the descriptor
+    void* pData = mmap(nullptr, static_cast<size_t>(Stat.st_size), PROT_READ, MAP_PRIVATE, iFile, 0);
+    close(iFile);
+
+    if (pData == MAP_FAILED)
+        return false;
+
+    m_pData = static_cast<const uint8_t*>(pData);
+    m_uSize = static_cast<size_t>(Stat.st_size);
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_pData), m_uSize);
+    }
+
+    m_pData = nullptr;
+    m_uSize = 0u;
+}
+#endif
@@ -19,14 +19,14 @@ NodeOrder NodeOrdering::Custom(ControlFlowGraph& _CFG, const std::string& _sCust
         }
         else
         {
-            HERROR("Block %s not found in CFG", WCSTR(sName));
+            HLOGE("Block %s not found in CFG", WCSTR(sName));
             break;
         }
     }
 
     if (Order.size() != _CFG.GetNodes().size() - 1)
     {
-        HERROR("Incomplete custom ordering %s for function with %d basic blocks", WCSTR(_sCustomOrdering), (uint32_t)_CFG.GetNodes().size());
+        HLOGE("Incomplete custom ordering %s for function with %d basic blocks", WCSTR(_sCustomOrdering), (uint32_t)_CFG.GetNodes().size());
     }
 
     return Order;
@@ -121,7 +121,7 @@ NodeOrder NodeOrdering::BreadthFirst(BasicBlock* _pRoot, const bool _bCheckDomin
 
     const auto Traverse = [&](std::list<Front>::iterator it) -> std::list<Front>::iterator
     {
-        HLOG("Traversed %s", WCSTR(it->pBB->GetName()));
+        HLOGV("Traversed %s", WCSTR(it->pBB->GetName()));
 
         traversed.insert(it->pBB);
         Order.push_back(it->pBB);
@@ -202,12 +202,15 @@ NodeOrder NodeOrdering::DepthFirstPostDom(BasicBlock* _pRoot, BasicBlock* _pExit
         if (ToVisit.empty())
             break;
 
-        std::string sNames;
-        for (BasicBlock* BB : ToVisit)
+        if (LogLevel::IsEnabled(kLogLevel_Verbose))
         {
-            sNames += ' ' + BB->GetName();
+            std::string sNames;
+            for (BasicBlock* BB : ToVisit)
+            {
+                sNames += ' ' + BB->GetName();
+            }
+            HLOGV("Traversing %s open:%s", WCSTR(A->GetName()), WCSTR(sNames));
         }
-        HLOG("Traversing %s open:%s", WCSTR(A->GetName()), WCSTR(sNames));
 
         BasicBlock* pNext = nullptr;
 
@@ -233,7 +236,7 @@ NodeOrder NodeOrdering::DepthFirstPostDom(BasicBlock* _pRoot, BasicBlock* _pExit
                         // a post-dominator of an unvisited successor of an ancestor of A (in the traversal tree?)
                         if (B == pSucc || PDT.Dominates(B, pSucc))
                         {
-                            HLOG("Rejected: %s", WCSTR(B->GetName()));
+                            HLOGV("Rejected: %s", WCSTR(B->GetName()));
                             pNext = nullptr;
                             break;
                         }
@@ -288,7 +291,7 @@ bool NodeOrdering::PrepareOrdering(NodeOrder& _Order, const bool _bPutVirtualFro
             _Order.erase(it);
             _Order.push_back(pExit);
 
-            HLOG("Enforcing exit block last");
+            HLOGV("Enforcing exit block last");
             //bChanged = true;
         }        
     }
@@ -326,14 +329,14 @@ bool NodeOrdering::PrepareOrdering(NodeOrder& _Order, const bool _bPutVirtualFro
 
                 if (_bPutVirtualFront)
                 {
-                    HLOG("Inserting %s before %s in ordering", WCSTR(pVirtual->GetName()), WCSTR(_Order.front()->GetName()));
+                    HLOGV("Inserting %s before %s in ordering", WCSTR(pVirtual->GetName()), WCSTR(_Order.front()->GetName()));
                     _Order.push_front(pVirtual);
                 }
                 else
                 {
                     // take the succuessor occuring first in the ordering  
                     auto it = pos1 < pos2 ? succ1 : succ2;
-                    HLOG("Inserting %s before %s in ordering", WCSTR(pVirtual->GetName()), WCSTR((*it)->GetName()));
+                    HLOGV("Inserting %s before %s in ordering", WCSTR(pVirtual->GetName()), WCSTR((*it)->GetName()));
                     _Order.insert(pos1 < pos2 ? succ1 : succ2, pVirtual);
                 }
 
@@ -5,16 +5,37 @@
 #include <deque>
 
 // for debugging 
-#include "DotWriter.h"
 #include "CFG2Dot.h"
 
-void FlowSuccessors::Add(OpenTreeNode* _pSource, OpenTreeNode* _pTarget, Instruction* _pCondition)
+void FlowSuccessors::Reset(const uint32_t _uRows, Instruction* _pDefault)
 {
-    if (Conditions.count(_pTarget) == 0u)
+    Vec.clear();
+    Origins.clear();
+    Conditions.clear();
+
+    uRows = _uRows;
+    pDefault = _pDefault;
+    ++uMark;
+}
+
+void FlowSuccessors::Add(const uint32_t _uRow, OpenTreeNode* _pTarget, Instruction* _pCondition)
+{
+    if (_pTarget->uFlowMark != uMark)
     {
-        Vec.emplace_back(_pTarget);
+        _pTarget->uFlowMark = uMark;
+        _pTarget->uFlowColumn = static_cast<uint32_t>(Vec.size());
+        Vec.push_back(_pTarget);
+        Conditions.resize(Conditions.size() + uRows, pDefault);
     }
-    Conditions[_pTarget][_pSource] = _pCondition;
+
+    Conditions[_pTarget->uFlowColumn * uRows + _uRow] = _pCondition;
+}
+
+const std::vector<Instruction*>& FlowSuccessors::GetValues(const uint32_t _uColumn)
+{
+    const auto Column = Conditions.begin() + _uColumn * uRows;
+    Values.assign(Column, Column + uRows);
+    return Values;
 }
 
 bool OpenTree::Process(const NodeOrder& _Ordering)
@@ -22,6 +43,8 @@ bool OpenTree::Process(const NodeOrder& _Ordering)
     bool bChanged = false;
 
     Initialize(_Ordering);
+    m_uStep = 0u;
+    m_uFailedStep = InvalidId;
 
     // input
     DumpCFGToFile("inputcfg.dot");
@@ -32,38 +55,44 @@ bool OpenTree::Process(const NodeOrder& _Ordering)
         uint32_t uStep = 0u;
         OpenTreeNode* pNode = GetNode(B);
 
-        HLOG(">>> Processing %s", WCSTR(pNode->sName));
+        HLOGV(">>> Processing %s", WCSTR(pNode->sName));
 
         //if (B->IsVirtual() == false)
         {
             // Let P be the set of armed predecessors of B (non-uniform node with 1 open edge)
-            std::vector<OpenTreeNode*> P = FilterNodes(pNode->Incoming, Armed, *this);
+            std::vector<OpenTreeNode*> P = FilterNodes(pNode->Incoming, Armed, Source);
 
             // If P is non-empty
             if (P.empty() == false)
             {
                 // Let S be the set of subtrees rooted at nodes in P
-                OpenSubTreeUnion S(P);
+                OpenSubTreeUnion S(*this, P);
 
                 // If S contains open outgoing edges that do not lead to B, reroute S Through a newly created basic block. FLOW
-                if (S.HasOutgoingNotLeadingTo(B))
+                if (S.HasOutgoingNotLeadingTo(pNode))
                 {
-                    HLOG("Condition 1:");
-                    Reroute(S);
+                    HLOGV("Condition 1:");
+                    OpenTreeNode* pFlowNode = Reroute(S);
                     bChanged = true;
-                    DumpOTDotToFile(B->GetName() + "_step" + std::to_string(uStep++) + ".dot");
+                    DumpOTDotToFile(B->GetName() + "_step" + std::to_string(uStep) + ".dot");
+
+                    if (Verify(B, uStep++, { pFlowNode, pFlowNode->pParent }, S.GetOutgoingNodes()) == false)
+                        return bChanged;
                 }
             }
         }
         
         AddNode(pNode);
 
-        DumpOTDotToFile(B->GetName() + "_step" + std::to_string(uStep++) + ".dot");
+        DumpOTDotToFile(B->GetName() + "_step" + std::to_string(uStep) + ".dot");
+
+        if (Verify(B, uStep++, { pNode, pNode->pParent }) == false)
+            return bChanged;
 
         // Let M be the set of unvisited successors of B
-        std::vector<OpenTreeNode*> M = FilterNodes(pNode->Outgoing, Unvisited, *this);
+        std::vector<OpenTreeNode*> M = FilterNodes(pNode->Outgoing, Unvisited, Target);
         // Let N be the set of visited successors of B, i.e. the targets of outgoing backward edges of N.
-        std::vector<OpenTreeNode*> N = FilterNodes(pNode->Outgoing, [pNode](OpenTreeNode* _pNode) {return _pNode != pNode && _pNode->bVisited; }, *this);
+        std::vector<OpenTreeNode*> N = FilterNodes(pNode->Outgoing, [pNode](OpenTreeNode* _pNode) {return _pNode != pNode && _pNode->bVisited; }, Target);
 
         // If N and M are non-empty
         if (M.empty() == false && N.empty() == false)
@@ -71,35 +100,48 @@ bool OpenTree::Process(const NodeOrder& _Ordering)
             N.push_back(pNode);
 
             // Let S be the set of subtrees routed at B and nodes in N.
-            OpenSubTreeUnion S(N);
+            OpenSubTreeUnion S(*this, N);
 
             // If S has multiple roots or open outgoing edges to multiple basic blocks, reroute S through a newly created basic block. FLOW
             if (S.HasMultiRootsOrOutgoing())
             {
-                HLOG("Condition 2:");
-                Reroute(S);
+                HLOGV("Condition 2:");
+                OpenTreeNode* pFlowNode = Reroute(S);
                 bChanged = true;
-                DumpOTDotToFile(B->GetName() + "_step" + std::to_string(uStep++) + ".dot");
+                DumpOTDotToFile(B->GetName() + "_step" + std::to_string(uStep) + ".dot");
+
+                if (Verify(B, uStep++, { pFlowNode, pFlowNode->pParent }, S.GetOutgoingNodes()) == false)
+                    return bChanged;
             }
         }
-        else
-        {
-            N.push_back(pNode);
-        }
 
-        // close B -> visited Succ 
-        for (OpenTreeNode* pSucc : N)
+        // close B -> visited Succ (N and self loops)
+        for (auto it = pNode->Outgoing.begin(); it != pNode->Outgoing.end();)
         {
-            pNode->Close(pSucc);
+            OpenEdge* pOut = *it;
+            ++it;
+
+            if (pOut->bTargetVisited)
+            {
+                pNode->Close(pOut);
+            }
         }
+
+        // remove B from the OT if all its edges are closed, its children move to the parent
+        OpenTreeNode* pParent = pNode->pParent;
+        pNode->Close();
+
+        if (Verify(B, uStep, { pNode, pParent }) == false)
+            return bChanged;
     }
 
-    for (OpenTreeNode& Node : m_Nodes)
+    for (uint32_t i = 0u; i < m_uNumNodes; ++i)
     {
-        HASSERT(Node.Incoming.size() + Node.Outgoing.size() + Node.FinalOutgoing.size() == 0, "%s has remaining open edges", WCSTR(Node.sName));
+        const OpenTreeNode& Node = m_Nodes[i];
+        HASSERT_SYNC(Node.Incoming.size() + Node.Outgoing.size() + Node.FinalOutgoing.size() == 0, "%s has remaining open edges", WCSTR(Node.sName));
     }
 
-    HASSERT(m_pRoot->Children.empty(), "Unresolved nodes");
+    HASSERT_SYNC(m_pRoot->Children.empty(), "Unresolved nodes");
 
     return bChanged;
 }
@@ -145,18 +187,19 @@ void OpenTree::SerializeOTDotGraph(std::ostream& _Out) const
 
         printNode(pNode);
 
-        for (const OpenTreeNode* pIn : pNode->Incoming)
+        for (const OpenEdge* pInEdge : pNode->Incoming)
         {
+            const OpenTreeNode* pIn = pInEdge->pSource;
             _Out << pIn->sName << " -> " << pNode->sName << "[style=dashed";
             if (pNode == pIn) _Out << ",dir=back";
             _Out << "];" << std::endl;
         }
 
-        for (const auto& flow : pNode->Outgoing)
+        for (const OpenEdge* pOut : pNode->Outgoing)
         {
-            printNode(flow.pTarget);
-            _Out << pNode->sName << " -> " << flow.pTarget->sName << "[style=dotted";
-            if (pNode == flow.pTarget) _Out << ",dir=back";
+            printNode(pOut->pTarget);
+            _Out << pNode->sName << " -> " << pOut->pTarget->sName << "[style=dotted";
+            if (pNode == pOut->pTarget) _Out << ",dir=back";
             _Out <<"];" << std::endl;
         }
 
@@ -180,6 +223,9 @@ void OpenTree::SerializeOTDotGraph(std::ostream& _Out) const
 
 void OpenTree::DumpOTDotToFile(const std::string& _sPath) const
 {
+    if (m_sDebugOutputPath.empty())
+        return;
+
     std::ofstream stream(m_sDebugOutputPath + _sPath);
     if (stream.is_open())
     {
@@ -190,11 +236,14 @@ void OpenTree::DumpOTDotToFile(const std::string& _sPath) const
 
 void OpenTree::DumpCFGToFile(const std::string& _sPath)
 {
+    if (m_sDebugOutputPath.empty())
+        return;
+
     std::ofstream dotout(m_sDebugOutputPath + _sPath);
 
-    if (dotout.is_open() && m_Nodes.size() > 1)
+    if (dotout.is_open() && m_uNumNodes > 1)
     {
-        DotWriter::WriteToStream(CFG2Dot::Convert(m_pFunction->GetCFG(), m_pFunction->GetName()), dotout);
+        CFG2Dot::WriteToStream(m_pFunction->GetCFG(), dotout, m_pFunction->GetName());
 
         dotout.close();
     }
@@ -205,16 +254,16 @@ void OpenTreeNode::LogTree(OpenTreeNode* _pNode, std::string _sTabs)
     if (_pNode != nullptr)
     {
         std::string sOut, sIn;
-        for (const OpenTreeNode* pIn : _pNode->Incoming)
+        for (const OpenEdge* pIn : _pNode->Incoming)
         {
-            sIn += ' ' + pIn->sName;
+            sIn += ' ' + pIn->pSource->sName;
         }
-        for (const auto& out : _pNode->Outgoing)
+        for (const OpenEdge* pOut : _pNode->Outgoing)
         {
-            sOut += ' ' + out.pTarget->sName;
+            sOut += ' ' + pOut->pTarget->sName;
         }
 
-        HLOG("%s%s [IN:%s OUT:%s] %s", WCSTR(_sTabs), WCSTR(_pNode->sName), WCSTR(sIn), WCSTR(sOut), (_pNode->pBB != nullptr && _pNode->Armed()) ? L"armed" : L"");
+        HLOGV("%s%s [IN:%s OUT:%s] %s", WCSTR(_sTabs), WCSTR(_pNode->sName), WCSTR(sIn), WCSTR(sOut), (_pNode->pBB != nullptr && _pNode->Armed()) ? L"armed" : L"");
         for (OpenTreeNode* pChild : _pNode->Children)
         {
             LogTree(pChild, _sTabs + '\t');
@@ -224,50 +273,169 @@ void OpenTreeNode::LogTree(OpenTreeNode* _pNode, std::string _sTabs)
 
 OpenTreeNode* OpenTree::GetNode(BasicBlock* _pBB) const
 {
-    if (auto it = m_BBToNode.find(_pBB); it != m_BBToNode.end())
+    if (const InstrId uId = _pBB->GetIdentifier(); uId < m_BBToNode.size() && m_BBToNode[uId] != InvalidId)
     {
-        return it->second;
+        return const_cast<OpenTreeNode*>(&m_Nodes[m_BBToNode[uId]]);
     }
 
     return nullptr;
 }
 
+OpenTreeNode* OpenTree::NewNode(BasicBlock* _pBB)
+{
+    const uint32_t uIndex = m_uNumNodes++;
+    OpenTreeNode* pNode = nullptr;
+
+    if (uIndex < m_Nodes.size())
+    {
+        pNode = &m_Nodes[uIndex];
+        pNode->Reset(this, _pBB);
+    }
+    else
+    {
+        pNode = &m_Nodes.emplace_back(this, _pBB);
+    }
+
+    if (_pBB != nullptr)
+    {
+        const InstrId uId = _pBB->GetIdentifier();
+        if (uId >= m_BBToNode.size())
+        {
+            m_BBToNode.resize(uId + 1u, InvalidId);
+        }
+
+        m_BBToNode[uId] = uIndex;
+    }
+
+    return pNode;
+}
+
+OpenEdge* OpenTree::NewEdge(OpenTreeNode* _pSource, OpenTreeNode* _pTarget, Instruction* _pCondition)
+{
+    OpenEdge* pEdge = m_pFreeEdges;
+
+    if (pEdge != nullptr)
+    {
+        m_pFreeEdges = pEdge->pNext[kEdgeList_Outgoing];
+        *pEdge = OpenEdge();
+    }
+    else if (m_uNumEdges < m_Edges.size())
+    {
+        pEdge = &m_Edges[m_uNumEdges++];
+        *pEdge = OpenEdge();
+    }
+    else
+    {
+        pEdge = &m_Edges.emplace_back();
+        ++m_uNumEdges;
+    }
+
+    pEdge->pSource = _pSource;
+    pEdge->pTarget = _pTarget;
+    pEdge->pCondition = _pCondition;
+    pEdge->bSourceVisited = _pSource->bVisited;
+    pEdge->bTargetVisited = _pTarget->bVisited;
+    pEdge->bSourceFlow = _pSource->bFlow;
+
+    return pEdge;
+}
+
+OpenEdge* OpenTree::Connect(OpenTreeNode* _pSource, OpenTreeNode* _pTarget, Instruction* _pCondition)
+{
+    OpenEdge* pEdge = NewEdge(_pSource, _pTarget, _pCondition);
+    _pSource->Outgoing.PushBack(pEdge);
+    _pTarget->Incoming.PushBack(pEdge);
+    return pEdge;
+}
+
+void OpenTree::Disconnect(OpenEdge* _pEdge)
+{
+    _pEdge->pSource->Outgoing.Remove(_pEdge);
+    _pEdge->pTarget->Incoming.Remove(_pEdge);
+
+    _pEdge->pNext[kEdgeList_Outgoing] = m_pFreeEdges;
+    m_pFreeEdges = _pEdge;
+}
+
+void OpenTree::Reset()
+{
+    m_uNumFlowBlocks = 0u;
+    m_uNumNodes = 0u;
+    m_uNumEdges = 0u;
+    m_pFreeEdges = nullptr;
+    m_pRoot = nullptr;
+    m_pFunction = nullptr;
+    m_pConstants[0] = m_pConstants[1] = nullptr;
+
+    m_BBToNode.clear();
+    m_UnionRoots.clear();
+    m_UnionNodes.clear();
+}
+
 void OpenTree::Initialize(const NodeOrder& _Ordering)
 {
-    // reserve enough space for root & flow blocks
-    m_Nodes.reserve(_Ordering.size() * 2u);
-    m_pRoot = &m_Nodes.emplace_back(this, nullptr);
+    Reset();
+
+    if (_Ordering.empty() == false)
+    {
+        m_pFunction = _Ordering.front()->GetCFG()->GetFunction();
+        m_BBToNode.resize(m_pFunction->GetCFG().GetNodes().size(), InvalidId);
+    }
+
+    m_pRoot = NewNode(nullptr);
     m_pRoot->sName = "ROOT";
     m_pRoot->bVisited = true;
 
-    HLOG("Node Order [%d]:", _Ordering.size());
+    HLOGV("Node Order [%d]:", _Ordering.size());
     for (BasicBlock* B : _Ordering)
     {
-        HLOG("\t%s %s", WCSTR(B->GetName()), B->IsDivergent() ? L"" : L"Uniform");
-        m_BBToNode[B] = &m_Nodes.emplace_back(this, B);
-
-        if (m_pFunction == nullptr)
-        {
-            m_pFunction = B->GetCFG()->GetFunction();
-        }
+        HLOGV("\t%s %s", WCSTR(B->GetName()), B->IsDivergent() ? L"" : L"Uniform");
+        NewNode(B);
     }
 
     // there is no outgoing edge from the ROOT to its successors (or incoming edge from the ROOT)
 
-    // initialize open incoming and outgoing edges
-    for (auto&[pBB, pNode] : m_BBToNode)
+    // initialize open outgoing edges in terminator order
+    for (BasicBlock* B : _Ordering)
     {
-        pNode->Incoming = FilterNodes(pBB->GetPredecessors(), True, *this);
-        GetOutgoingFlow(pNode->Outgoing, pNode);
+        ConnectOutgoing(GetNode(B), false);
+    }
+
+    // link the incoming edges in predecessor order
+    for (BasicBlock* B : _Ordering)
+    {
+        OpenTreeNode* pNode = GetNode(B);
+        for (BasicBlock* pPred : B->GetPredecessors())
+        {
+            if (OpenTreeNode* pSource = GetNode(pPred); pSource != nullptr)
+            {
+                for (OpenEdge* pOut : pSource->Outgoing)
+                {
+                    if (pOut->pTarget == pNode && pNode->Incoming.Contains(pOut) == false)
+                    {
+                        pNode->Incoming.PushBack(pOut);
+                        break;
+                    }
+                }
+            }
+        }
     }
 }
 
 void OpenTree::AddNode(OpenTreeNode* _pNode)
 {
-    HLOG("AddNode %s", WCSTR(_pNode->sName));
+    HLOGV("AddNode %s", WCSTR(_pNode->sName));
     // LLVM code checks for VISITED preds, node can only be attached to a visited ancestor!
     // in LLVM the predecessors are actually the open incoming edges from FLOW nodes only. (IS THIS CORRECT?)
-    const auto& Preds = FilterNodes(_pNode->Incoming, Visited, *this);
+    std::vector<OpenEdge*>& Preds = m_VisitedPreds;
+    Preds.clear();
+    for (OpenEdge* pIn : _pNode->Incoming)
+    {
+        if (pIn->bSourceVisited)
+        {
+            Preds.push_back(pIn);
+        }
+    }
 
     if (Preds.size() == 0u)
     {
@@ -279,58 +447,78 @@ void OpenTree::AddNode(OpenTreeNode* _pNode)
         // If a predecessor of B is already in OT, find the lowest predecessor(s).
         // If it is unique, add B as a child
 
-        _pNode->pParent = Preds[0];
+        _pNode->pParent = Preds[0]->pSource;
     }
     else
     {
-        _pNode->pParent = InterleavePathsTo(_pNode);
+        _pNode->pParent = InterleavePathsTo(_pNode, Preds);
     }
 
     // This should handle all cases:
     //pNode->pParent = InterleavePathsToBB(_pBB);
 
-    HLOG("Attaching Node %s -> %s", WCSTR(_pNode->pParent->sName), WCSTR(_pNode->sName));
+    HLOGV("Attaching Node %s -> %s", WCSTR(_pNode->pParent->sName), WCSTR(_pNode->sName));
     _pNode->pParent->Children.push_back(_pNode);
+    _pNode->uDepth = _pNode->pParent->uDepth + 1u;
+    _pNode->Invalidate();
 
-    OpenTreeNode::LogTree(m_pRoot);
+    if (LogLevel::IsEnabled(kLogLevel_Verbose))
+    {
+        OpenTreeNode::LogTree(m_pRoot);
+    }
 
     // close edge from Pred to BB
     // is this the right point to close the edge? LLVM code closes edges after adding for Predecessors and then for Successors.
     // this changes the visited preds, so after interleaving makes sense
-    for (OpenTreeNode* pPred : Preds)
+    for (OpenEdge* pIn : Preds)
     {
-        pPred->Close(_pNode);
+        pIn->pSource->Close(pIn);
     }
 
     // can not close the edges to visited successors here because set N depends on the open edges.
     // question is if this is actually correct.
 
     _pNode->bVisited = true;
+    for (OpenEdge* pIn : _pNode->Incoming)
+    {
+        pIn->bTargetVisited = true;
+    }
+    for (OpenEdge* pOut : _pNode->Outgoing)
+    {
+        pOut->bSourceVisited = true;
+    }
+
+    _pNode->Invalidate(); // self loops are no longer open outgoing targets
 }
 
-void OpenTree::Reroute(OpenSubTreeUnion& _Subtree)
+OpenTreeNode* OpenTree::Reroute(OpenSubTreeUnion& _Subtree)
 {
-    BasicBlock* pFlow = (*_Subtree.GetNodes().begin())->pBB->GetCFG()->NewNode("FLOW" + std::to_string(m_uNumFlowBlocks++));
-    OpenTreeNode* pFlowNode = &m_Nodes.emplace_back(this, pFlow);
+    BasicBlock* pFlow = m_pFunction->GetCFG().NewNode("FLOW" + std::to_string(m_uNumFlowBlocks++));
+    OpenTreeNode* pFlowNode = NewNode(pFlow);
     pFlowNode->bFlow = true;
-    m_BBToNode[pFlow] = pFlowNode;
-    FlowSuccessors S;
 
-    Function& Func(*pFlow->GetCFG()->GetFunction());
-    Instruction* pConstTrue = Func.Constant(true);
-    Instruction* pConstFalse = Func.Constant(false);
-        
+    Instruction* pConstTrue = ConstantBool(true);
+    Instruction* pConstFalse = ConstantBool(false);
+
+    const std::vector<OpenTreeNode*>& Preds = _Subtree.GetOutgoingNodes();
+    FlowSuccessors& S = m_FlowSuccessors;
+    S.Reset(static_cast<uint32_t>(Preds.size()), pConstFalse);
+
+    // only gathered for the verbose log
+    const bool bLog = LogLevel::IsEnabled(kLogLevel_Verbose);
     std::string sOuts, sIns;
     
     // accumulate all outgoing edges in the new flow node
-    for (OpenTreeNode* pNode : _Subtree.GetNodes())
+    for (uint32_t uRow = 0u; uRow < S.uRows; ++uRow)
     {
-        if (pNode->Outgoing.empty())
-            continue;
+        OpenTreeNode* pNode = Preds[uRow];
+        S.Origins.push_back(pNode->pBB);
 
-        // this predecessor (pNode) is now an incoming edge to the flow node
-        pFlowNode->Incoming.push_back(pNode);
-        sIns += ' ' + pNode->sName;
+        // this predecessor (pNode) gets an incoming edge to the flow node
+        if (bLog)
+        {
+            sIns += ' ' + pNode->sName;
+        }
 
         // pNode is (becomes) a predecessor of pFlow
         if (pNode->bFlow) // pNode is a flow node itself
@@ -347,32 +535,31 @@ void OpenTree::Reroute(OpenSubTreeUnion& _Subtree)
 
                 for (auto it = pNode->FinalOutgoing.begin()+1; it != pNode->FinalOutgoing.end();)
                 {
-                    S.Add(pNode, it->pTarget, it->pCondition);
+                    S.Add(uRow, it->pTarget, it->pCondition);
                     it = pNode->FinalOutgoing.erase(it);
                 }                
             }
 
-            for (auto it = pNode->Outgoing.begin(); it != pNode->Outgoing.end();)
+            while (pNode->Outgoing.empty() == false)
             {
-                S.Add(pNode, it->pTarget, it->pCondition); 
-                it = pNode->Outgoing.erase(it);
+                OpenEdge* pOut = pNode->Outgoing.front();
+                S.Add(uRow, pOut->pTarget, pOut->pCondition);
+                Disconnect(pOut);
             }
 
             // always route through the new flow block
-            auto& remain = pNode->Outgoing.emplace_back();
-            remain.pCondition = pRemainderCond != nullptr ? pRemainderCond : pConstTrue;
-            remain.pTarget = pFlowNode;
+            Connect(pNode, pFlowNode, pRemainderCond != nullptr ? pRemainderCond : pConstTrue);
         }
         else // handle outgoing edges for non Flow Nodes
         {
             // Regular nodes can only have up to 2 open outgoing nodes (because the ISA only has cond-branch, no switch)
-            HASSERT(pNode->Outgoing.size() <= 2u, "Too many open outgoing edges");
+            HASSERT_SYNC(pNode->Outgoing.size() <= 2u, "Too many open outgoing edges");
             Instruction* pTerminator = pNode->pBB->GetTerminator();
               
             if (pTerminator->Is(kInstruction_Branch))
             {
-                HASSERT(pNode->Outgoing.size() == 1u, "Invalid number of outgoind edges");
-                S.Add(pNode, GetNode(pTerminator->GetOperandBB(0u)), pConstTrue);
+                HASSERT_SYNC(pNode->Outgoing.size() == 1u, "Invalid number of outgoind edges");
+                S.Add(uRow, GetNode(pTerminator->GetOperandBB(0u)), pConstTrue);
                 pTerminator->Reset()->Branch(pFlow);
             }
             else if(pTerminator->Is(kInstruction_BranchCond))
@@ -383,99 +570,90 @@ void OpenTree::Reroute(OpenSubTreeUnion& _Subtree)
 
                 if (pTrueNode->bVisited == false && pFalseNode->bVisited)
                 {
-                    S.Add(pNode, pTrueNode, pConstTrue);
+                    S.Add(uRow, pTrueNode, pConstTrue);
                     pTerminator->Reset()->BranchCond(pCond, pFlow, pFalseNode->pBB);
                 }
                 if (pFalseNode->bVisited == false && pTrueNode->bVisited)
                 {
-                    S.Add(pNode, pFalseNode, pConstTrue);
+                    S.Add(uRow, pFalseNode, pConstTrue);
                     pTerminator->Reset()->BranchCond(pCond, pTrueNode->pBB, pFlow);
                 }
                 if (pTrueNode->bVisited == false && pFalseNode->bVisited == false)
                 {
                     // rerouted both outgoing to the flow node, can replace with unconditional branch instr
-                    S.Add(pNode, pTrueNode, pCond);
-                    S.Add(pNode, pFalseNode, pTerminator->Reset()->Not(pCond));
+                    S.Add(uRow, pTrueNode, pCond);
+                    S.Add(uRow, pFalseNode, pTerminator->Reset()->Not(pCond));
                     pNode->pBB->AddInstruction()->Branch(pFlow);
                 }
             }
 
             // SET outgoing flow pBB -> pFlow
-            pNode->Outgoing.clear();
-            GetOutgoingFlow(pNode->Outgoing, pNode); // now checks for unvisited
+            for (auto it = pNode->Outgoing.begin(); it != pNode->Outgoing.end();)
+            {
+                OpenEdge* pOut = *it;
+                ++it;
+
+                if (pOut->bTargetVisited == false)
+                {
+                    Disconnect(pOut);
+                }
+            }
+
+            ConnectOutgoing(pNode); // now checks for unvisited
         }
+
+        pNode->Invalidate();
     }
 
+    HASSERTD_SYNC(pFlowNode->Incoming.size() == S.uRows, "Flow predecessors do not match the condition table");
+
     // go over the unique successors of the flow block
-    for (OpenTreeNode* pFlowSucc : S.Vec)
+    for (uint32_t uColumn = 0u; uColumn < S.Vec.size(); ++uColumn)
     {
-        sOuts += ' ' + pFlowSucc->sName;
-
-        const FlowSuccessors::From& Conditions = S.Conditions[pFlowSucc];
+        OpenTreeNode* pFlowSucc = S.Vec[uColumn];
 
-        std::vector<Instruction*> Values; std::vector<BasicBlock*> Origins;
-        // create the conditons for the phi node
-        for (OpenTreeNode* pFlowPred : pFlowNode->Incoming)
+        if (bLog)
         {
-            if (auto it = Conditions.find(pFlowPred); it != Conditions.end())
-            {
-                Values.push_back(it->second);
-            }
-            else
-            {
-                Values.push_back(pConstFalse);
-            }
-
-            Origins.push_back(pFlowPred->pBB);
-
-            // remove the source form the incoming of successor (pFlow is the only successor)
-            if (auto it = std::remove(pFlowSucc->Incoming.begin(), pFlowSucc->Incoming.end(), pFlowPred); it != pFlowSucc->Incoming.end())
-            {
-                pFlowSucc->Incoming.erase(it);
-            }
+            sOuts += ' ' + pFlowSucc->sName;
         }
 
         // TODO: print PHI node
 
-
-        // flow successors
-        auto& out = pFlowNode->Outgoing.emplace_back();
-        out.pTarget = pFlowSucc;
-
-        // this phi node is the condition from all the Predecessors of the Target
-
-        out.pCondition = pFlow->AddInstruction()->Phi(Values, Origins);
-
+        // flow successors, this phi node is the condition from all the Predecessors of the Target (rows of the table)
         // Flow block is the incoming edge to the flow blocks outgoing BB
-        pFlowSucc->Incoming.push_back(pFlowNode);
+        Connect(pFlowNode, pFlowSucc, pFlow->AddInstruction()->Phi(S.GetValues(uColumn), S.Origins));
     }
 
-    HLOG("Reroute%s -> %s ->%s", WCSTR(sIns), WCSTR(pFlow->GetName()), WCSTR(sOuts));
+    HLOGV("Reroute%s -> %s ->%s", WCSTR(sIns), WCSTR(pFlow->GetName()), WCSTR(sOuts));
     
     // add node to OT
     AddNode(pFlowNode);
+
+    return pFlowNode;
 }
 
 // interleaves all node paths up until _pNode, returns last leave node (new ancestor)
-OpenTreeNode* OpenTree::InterleavePathsTo(OpenTreeNode* _pNode)
+OpenTreeNode* OpenTree::InterleavePathsTo(OpenTreeNode* _pNode, const std::vector<OpenEdge*>& _VisitedPreds)
 {
-    std::deque<OpenTreeNode*> Branches;
-    std::vector<OpenTreeNode*> Leaves;
+    std::vector<OpenTreeNode*>& Branches = m_Branches;
+    std::vector<OpenTreeNode*>& Leaves = m_Leaves;
+    Branches.clear();
+    Leaves.clear();
 
-    OpenTreeNode* pPrev = CommonAncestor(_pNode);
+    OpenTreeNode* pPrev = CommonAncestor(_VisitedPreds);
+    pPrev->Invalidate(); // the whole subtree is restructured
 
-    HLOG("%s is common ancestor of %s", WCSTR(pPrev->sName), WCSTR(_pNode->sName));
+    HLOGV("%s is common ancestor of %s", WCSTR(pPrev->sName), WCSTR(_pNode->sName));
 
     for (OpenTreeNode* pBranch : pPrev->Children)
     {
         Branches.push_back(pBranch);
     }
 
-    // traverse branches and concatenate
-    while (Branches.empty() == false)
+    // traverse branches (breadth first) and concatenate
+    for (size_t i = 0u; i < Branches.size(); ++i)
     {
-        OpenTreeNode* pBranch = Branches.front();
-        Branches.pop_front();
+        OpenTreeNode* pBranch = Branches[i];
 
         if (pBranch->Children.empty())
         {
@@ -494,6 +672,8 @@ OpenTreeNode* OpenTree::InterleavePathsTo(OpenTreeNode* _pNode)
         //HLOG("Attaching %s to %s", WCSTR(pBranch->sName), WCSTR(pPrev->sName));
         pPrev->Children = { pBranch };
         pBranch->pParent = pPrev;
+        pBranch->uDepth = pPrev->uDepth + 1u;
+        pBranch->bSubtreeDirty = true;
         pPrev = pBranch;
     }
 
@@ -508,6 +688,8 @@ OpenTreeNode* OpenTree::InterleavePathsTo(OpenTreeNode* _pNode)
         //HLOG("Attaching %s to %s", WCSTR(pLeave->sName), WCSTR(pPrev->sName));
         pPrev->Children = { pLeave };
         pLeave->pParent = pPrev;
+        pLeave->uDepth = pPrev->uDepth + 1u;
+        pLeave->bSubtreeDirty = true;
         pPrev = pLeave;
     }
 
@@ -515,67 +697,95 @@ OpenTreeNode* OpenTree::InterleavePathsTo(OpenTreeNode* _pNode)
 }
 
 // returns root if non is found
-OpenTreeNode* OpenTree::CommonAncestor(OpenTreeNode* _pNode) const
+OpenTreeNode* OpenTree::CommonAncestor(const std::vector<OpenEdge*>& _VisitedPreds) const
 {
-    std::unordered_set<OpenTreeNode*> Ancestors;
-
-    std::deque<OpenTreeNode*> Nodes;
-
-    auto VisitedPreds = FilterNodes(_pNode->Incoming, Visited, *this);
-
-    // find shared ancestor in visited predecessors
-    for (OpenTreeNode* pVA : VisitedPreds)
+    // find shared ancestor in visited predecessors by climbing the deeper node, or both if their depths are equal.
+    // the depths only increase along every path, a node with the larger depth can not be the ancestor of the other one
+    OpenTreeNode* pAncestor = _VisitedPreds.empty() ? nullptr : _VisitedPreds.front()->pSource;
+    for (const OpenEdge* pIn : _VisitedPreds)
     {
-        Nodes.push_back(pVA);
-    }
-
-    while (Nodes.empty() == false)
-    {
-        OpenTreeNode* pAncestor = Nodes.front();
-        Nodes.pop_front();
+        OpenTreeNode* pPred = pIn->pSource;
 
-        //HLOG("Checking ancestor %s", WCSTR(pAncestor->sName));
-
-        bool bIsCommanAncestor = true;
-
-        // check if this ancestor is an ancestor of all predecessors
-        for (OpenTreeNode* pPred : VisitedPreds)
+        while (pAncestor != pPred && pAncestor != nullptr && pPred != nullptr)
         {
-            bool bAncestor = false;
-            if (pPred != pAncestor)
+            const uint32_t uPredDepth = pPred->uDepth;
+            const uint32_t uAncestorDepth = pAncestor->uDepth;
+
+            if (uPredDepth >= uAncestorDepth)
             {
-                bAncestor = pAncestor->AncestorOf(pPred);
-                HLOG("%s %s ancestor of %s", WCSTR(pAncestor->sName), bAncestor ? L"is" : L"is not", WCSTR(pPred->sName));
+                pPred = pPred->pParent;
+            }
+            if (uAncestorDepth >= uPredDepth)
+            {
+                pAncestor = pAncestor->pParent;
             }
-
-            bIsCommanAncestor &= bAncestor;
         }
 
-        if (bIsCommanAncestor)
+        // climbed past the root
+        if (pAncestor != pPred)
         {
-            return pAncestor;
+            pAncestor = nullptr;
+            break;
         }
+    }
 
-        // add the ancestors ancestor
-        if (pAncestor->pParent != nullptr)
-        {
-            Nodes.push_back(pAncestor->pParent);
-        }
+    // the ancestor must not be one of the predecessors itself
+    if (pAncestor != nullptr && std::any_of(_VisitedPreds.begin(), _VisitedPreds.end(), [pAncestor](const OpenEdge* _pIn) { return _pIn->pSource == pAncestor; }))
+    {
+        pAncestor = pAncestor->pParent;
     }
 
-    // todo: select lowest common ancestor?
-    HWARNING("Did not find a commong ancestor, using root");
+    if (pAncestor != nullptr)
+    {
+        return pAncestor;
+    }
+
+    HLOGW("Did not find a commong ancestor, using root");
 
     return m_pRoot;
 }
 
-OpenTreeNode::OpenTreeNode(OpenTree* _pOT, BasicBlock* _pBB) :
-    pOT(_pOT), pBB(_pBB)
+OpenTreeNode::OpenTreeNode(OpenTree* _pOT, BasicBlock* _pBB)
 {
+    Reset(_pOT, _pBB);
+}
+
+void OpenTreeNode::Reset(OpenTree* _pOT, BasicBlock* _pBB)
+{
+    pOT = _pOT;
+    pBB = _pBB;
+    pParent = nullptr;
+
     if (_pBB != nullptr)
     {
         sName = _pBB->GetName();
     }
+    else
+    {
+        sName.clear();
+    }
+
+    Children.clear();
+    Incoming = {};
+    Outgoing = {};
+    FinalOutgoing.clear();
+#ifdef _DEBUG
+    Closed.clear();
+#endif
+
+    uClosedOutgoing = 0u;
+    uDepth = 0u;
+    bVisited = false;
+    bFlow = false;
+
+    uSubtreeOutgoing = 0u;
+    pSubtreeTarget = nullptr;
+    bSubtreeMultipleTargets = false;
+    bSubtreeDirty = true;
+
+    uUnionMark = 0u;
+    uFlowMark = 0u;
+    uFlowColumn = 0u;
 }
 
 bool OpenTreeNode::AncestorOf(const OpenTreeNode* _pSuccessor) const
@@ -594,101 +804,175 @@ bool OpenTreeNode::AncestorOf(const OpenTreeNode* _pSuccessor) const
 
 OpenTreeNode* OpenTreeNode::GetRoot()
 {
-    if (pParent == nullptr)
+    OpenTreeNode* pRoot = this;
+    while (pRoot->pParent != nullptr)
     {
-        return this;
+        pRoot = pRoot->pParent;
     }
 
-    return pParent->GetRoot();
+    return pRoot;
 }
 
-// close connection from predecessor (this) to the successor
-void OpenTreeNode::Close(OpenTreeNode* _pSuccessor)
+void OpenTreeNode::Invalidate()
 {
-    if (_pSuccessor != nullptr) 
+    // if a node is dirty, all its ancestors are dirty as well
+    bSubtreeDirty = true;
+    for (OpenTreeNode* pNode = pParent; pNode != nullptr && pNode->bSubtreeDirty == false; pNode = pNode->pParent)
     {
-        HLOG("Closing edge %s -> %s", WCSTR(sName), WCSTR(_pSuccessor->sName));    
+        pNode->bSubtreeDirty = true;
     }
+}
+
+void OpenTreeNode::UpdateSubtree()
+{
+    if (bSubtreeDirty == false)
+        return;
+
+    // the tree can be as deep as the function has blocks, the dirty nodes are gathered in pre-order
+    // and recomputed in reverse so that every child is up to date before its parent
+    std::vector<OpenTreeNode*>& Stack = pOT->m_NodeStack;
+    std::vector<OpenTreeNode*>& Dirty = pOT->m_DirtyNodes;
+    Stack.assign(1u, this);
+    Dirty.clear();
 
-    if (_pSuccessor != nullptr)
+    while (Stack.empty() == false)
     {
-        // this is the predecessor node, remove the successor
-        if (auto it = std::find_if(Outgoing.begin(), Outgoing.end(), [&](const Flow& _Flow) -> bool {return _Flow.pTarget == _pSuccessor; }); it != Outgoing.end())
+        OpenTreeNode* pNode = Stack.back();
+        Stack.pop_back();
+        Dirty.push_back(pNode);
+
+        for (OpenTreeNode* pChild : pNode->Children)
         {
-            if (bFlow)
+            if (pChild->bSubtreeDirty)
             {
-                FinalOutgoing.push_back(*it);
+                Stack.push_back(pChild);
             }
+        }
+    }
 
-#ifdef _DEBUG
-            Closed.push_back(_pSuccessor);
-#endif
+    for (auto it = Dirty.rbegin(); it != Dirty.rend(); ++it)
+    {
+        OpenTreeNode* pNode = *it;
+        pNode->uSubtreeOutgoing = static_cast<uint32_t>(pNode->Outgoing.size());
+        pNode->pSubtreeTarget = nullptr;
+        pNode->bSubtreeMultipleTargets = false;
+
+        const auto AddTarget = [pNode](OpenTreeNode* _pTarget)
+        {
+            if (pNode->pSubtreeTarget == nullptr)
+            {
+                pNode->pSubtreeTarget = _pTarget;
+            }
+            else if (pNode->pSubtreeTarget != _pTarget)
+            {
+                pNode->bSubtreeMultipleTargets = true;
+            }
+        };
 
-            ++uClosedOutgoing;
-            Outgoing.erase(it);
+        for (const OpenEdge* pOut : pNode->Outgoing)
+        {
+            if (pOut->bTargetVisited == false)
+            {
+                AddTarget(pOut->pTarget);
+            }
         }
 
-        // remove the predecessor from the successors incoming 
-        if (auto it = std::remove(_pSuccessor->Incoming.begin(), _pSuccessor->Incoming.end(), this); it != _pSuccessor->Incoming.end())
+        for (const OpenTreeNode* pChild : pNode->Children)
         {
-            _pSuccessor->Incoming.erase(it);
+            pNode->uSubtreeOutgoing += pChild->uSubtreeOutgoing;
+            pNode->bSubtreeMultipleTargets |= pChild->bSubtreeMultipleTargets;
+
+            if (pChild->pSubtreeTarget != nullptr)
+            {
+                AddTarget(pChild->pSubtreeTarget);
+            }
         }
+
+        pNode->bSubtreeDirty = false;
     }
+}
 
-    if (_pSuccessor != nullptr && _pSuccessor->Incoming.empty() && _pSuccessor->Outgoing.empty())
+// close the open edge from predecessor (this) to the successor
+void OpenTreeNode::Close(OpenEdge* _pEdge)
+{
+    if (_pEdge != nullptr)
     {
-        _pSuccessor->Close(nullptr);
+        OpenTreeNode* pSuccessor = _pEdge->pTarget;
+        HLOGV("Closing edge %s -> %s", WCSTR(sName), WCSTR(pSuccessor->sName));
+
+        if (_pEdge->bSourceFlow)
+        {
+            FinalOutgoing.push_back({ pSuccessor, _pEdge->pCondition });
+        }
+
+#ifdef _DEBUG
+        Closed.push_back(pSuccessor);
+#endif
+
+        ++uClosedOutgoing;
+        pOT->Disconnect(_pEdge);
+        Invalidate();
+
+        if (pSuccessor->Incoming.empty() && pSuccessor->Outgoing.empty())
+        {
+            pSuccessor->Close();
+        }
     }
 
     // remove the node from the OT if all edges are closed
     if (pOT->m_bRemoveClosed && Outgoing.empty() && Incoming.empty())
     {
-        OpenTreeNode* pRoot = GetRoot();
+        // root is only needed for the verbose log
+        OpenTreeNode* pRoot = LogLevel::IsEnabled(kLogLevel_Verbose) ? GetRoot() : nullptr;
+
         // LLVM code keeps track of all open in/out edges AND flow out edges seperately
         // here the final outgoing flow is moved to FinalOutgoing when the edge is closed
         if (bFlow)
         {
-            HASSERT(FinalOutgoing.size() <= 2u, "Too many open outgoing flow edges");
+            HASSERT_SYNC(FinalOutgoing.size() <= 2u, "Too many open outgoing flow edges");
 
             // create branch for out flow
             if (FinalOutgoing.size() == 2u)
             {
                 Instruction* pCondition = FinalOutgoing[0].pCondition;
-                HASSERT(pCondition != nullptr, "Invalid condtion (unconditional open edge)");
+                HASSERT_SYNC(pCondition != nullptr, "Invalid condtion (unconditional open edge)");
                 pBB->AddInstruction()->BranchCond(pCondition, FinalOutgoing[0].pTarget->pBB, FinalOutgoing[1].pTarget->pBB);
-                HLOG("BranchCond %s -> %s %s", WCSTR(pBB->GetName()), WCSTR(FinalOutgoing[0].pTarget->sName), WCSTR(FinalOutgoing[1].pTarget->sName));
+                HLOGV("BranchCond %s -> %s %s", WCSTR(pBB->GetName()), WCSTR(FinalOutgoing[0].pTarget->sName), WCSTR(FinalOutgoing[1].pTarget->sName));
             }
             else if (FinalOutgoing.size() == 1u)
             {
                 pBB->AddInstruction()->Branch(FinalOutgoing[0].pTarget->pBB);
-                HLOG("Branch %s -> %s", WCSTR(pBB->GetName()), WCSTR(FinalOutgoing[0].pTarget->sName));
+                HLOGV("Branch %s -> %s", WCSTR(pBB->GetName()), WCSTR(FinalOutgoing[0].pTarget->sName));
             }
 
             FinalOutgoing.clear();
         }
 
-        HLOG("Closing node %s", WCSTR(sName));
+        HLOGV("Closing node %s", WCSTR(sName));
         // move this nodes children to the parent
         for (OpenTreeNode* pChild : Children)
         {
             if (pParent != nullptr)
             {
-                HLOG("Moving child %s to %s", WCSTR(pChild->sName), WCSTR(pParent->sName));
+                HLOGV("Moving child %s to %s", WCSTR(pChild->sName), WCSTR(pParent->sName));
                 pParent->Children.push_back(pChild);
             }
 
+            // the subtree keeps its depths, they still increase along every path
             pChild->pParent = pParent;
         }
 
         // remove the child from the parent
         if (pParent != nullptr)
         {
+            pParent->Invalidate();
+
             if (auto it = std::remove(pParent->Children.begin(), pParent->Children.end(), this); it != pParent->Children.end())
             {
                 pParent->Children.erase(it);
             }
 
-            HASSERTD(std::find(pParent->Children.begin(), pParent->Children.end(), this) == pParent->Children.end(), "Duplicate");
+            HASSERTD_SYNC(std::find(pParent->Children.begin(), pParent->Children.end(), this) == pParent->Children.end(), "Duplicate");
         }
 
         // this node is removed from the OT, it has no ancestor or successor
@@ -699,7 +983,7 @@ void OpenTreeNode::Close(OpenTreeNode* _pSuccessor)
     }
 }
 
-void OpenTree::GetOutgoingFlow(std::vector<OpenTreeNode::Flow>& _OutFlow, OpenTreeNode* _pSource) const
+void OpenTree::ConnectOutgoing(OpenTreeNode* _pSource, const bool _bLinkIncoming)
 {
     Instruction* pTerminator = _pSource->pBB->GetTerminator();
 
@@ -708,117 +992,266 @@ void OpenTree::GetOutgoingFlow(std::vector<OpenTreeNode::Flow>& _OutFlow, OpenTr
         return;    
     }
 
+    const auto Open = [&](OpenTreeNode* _pTarget, Instruction* _pCondition)
+    {
+        OpenEdge* pEdge = NewEdge(_pSource, _pTarget, _pCondition);
+        _pSource->Outgoing.PushBack(pEdge);
+
+        if (_bLinkIncoming)
+        {
+            _pTarget->Incoming.PushBack(pEdge);
+        }
+    };
+
     if (pTerminator->Is(kInstruction_Branch))
     {
         if (OpenTreeNode* pTarget = GetNode(pTerminator->GetOperandBB(0u)); pTarget->bVisited == false)
         {
-            auto& TrueFlow = _OutFlow.emplace_back();
-            TrueFlow.pCondition = _pSource->pBB->GetCFG()->GetFunction()->Constant(true);
-            TrueFlow.pTarget = pTarget;
+            Open(pTarget, ConstantBool(true));
         }
     }
     else if (pTerminator->Is(kInstruction_BranchCond))
     {
         if (OpenTreeNode* pTarget = GetNode(pTerminator->GetOperandBB(1u)); pTarget->bVisited == false)
         {
-            auto& TrueFlow = _OutFlow.emplace_back();
-            TrueFlow.pCondition = pTerminator->GetOperandInstr(0u);
-            TrueFlow.pTarget = pTarget;
+            Open(pTarget, pTerminator->GetOperandInstr(0u));
         }
 
         if (OpenTreeNode* pTarget = GetNode(pTerminator->GetOperandBB(2u)); pTarget->bVisited == false)
         {
-            auto& FalseFlow = _OutFlow.emplace_back();
-            FalseFlow.pCondition = pTerminator->GetOperandInstr(0u); // same condition instr
-            FalseFlow.pTarget = pTarget; // false branch target
+            Open(pTarget, pTerminator->GetOperandInstr(0u)); // same condition instr, false branch target
         }
     }
 }
 
-OpenSubTreeUnion::OpenSubTreeUnion(const std::vector<OpenTreeNode*>& _Roots)
+const char* OpenTree::VerifyNode(const OpenTreeNode* _pNode) const
 {
-    for (OpenTreeNode* pRoot : _Roots)
+    // every open edge is linked into the outgoing list of its source and the incoming list of its target
+    uint32_t uOutgoing = 0u;
+    for (const OpenEdge* pOut : _pNode->Outgoing)
     {
-        // skip duplicates (backwardeges from armed preds)
-        if (m_Nodes.count(pRoot) != 0)
-            continue;
+        const OpenEdge* pPrev = pOut->pPrev[kEdgeList_Incoming];
+        const OpenEdge* pNext = pOut->pNext[kEdgeList_Incoming];
 
-        m_Roots.insert(pRoot);
+        if (pOut->pSource != _pNode)
+            return "outgoing edge of another source";
+        if ((pPrev != nullptr ? pPrev->pTarget != pOut->pTarget : pOut->pTarget->Incoming.front() != pOut) || (pNext != nullptr && pNext->pTarget != pOut->pTarget))
+            return "outgoing edge is not an incoming edge of its target";
+        if (pOut->bSourceVisited != _pNode->bVisited || pOut->bTargetVisited != pOut->pTarget->bVisited || pOut->bSourceFlow != _pNode->bFlow)
+            return "outgoing edge caches a stale node state";
 
-        std::deque<OpenTreeNode*> Stack = { pRoot }; // traversal stack
-        
-        while (Stack.empty() == false)
+        ++uOutgoing;
+    }
+
+    uint32_t uIncoming = 0u;
+    for (const OpenEdge* pIn : _pNode->Incoming)
+    {
+        const OpenEdge* pPrev = pIn->pPrev[kEdgeList_Outgoing];
+        const OpenEdge* pNext = pIn->pNext[kEdgeList_Outgoing];
+
+        if (pIn->pTarget != _pNode)
+            return "incoming edge of another target";
+        if ((pPrev != nullptr ? pPrev->pSource != pIn->pSource : pIn->pSource->Outgoing.front() != pIn) || (pNext != nullptr && pNext->pSource != pIn->pSource))
+            return "incoming edge is not an outgoing edge of its source";
+        if (pIn->bTargetVisited != _pNode->bVisited || pIn->bSourceVisited != pIn->pSource->bVisited)
+            return "incoming edge caches a stale node state";
+
+        ++uIncoming;
+    }
+
+    if (uOutgoing != _pNode->Outgoing.size() || uIncoming != _pNode->Incoming.size())
+        return "edge count does not match the edge list";
+
+    // only visited nodes are part of the OT, closed nodes are removed with all their edges
+    if (_pNode == m_pRoot)
+    {
+        if (_pNode->pParent != nullptr || _pNode->uDepth != 0u)
+            return "root has a parent";
+    }
+    else if (_pNode->pParent != nullptr)
+    {
+        if (_pNode->bVisited == false)
+            return "unvisited node is part of the OT";
+        if (_pNode->uDepth <= _pNode->pParent->uDepth)
+            return "depth is not below the parent";
+    }
+    else if (_pNode->Children.empty() == false)
+    {
+        return "node outside of the OT has children";
+    }
+    else if (_pNode->bVisited && m_bRemoveClosed && (uOutgoing != 0u || uIncoming != 0u))
+    {
+        return "removed node has open edges";
+    }
+
+    // the children of the root are checked when they are verified themselves, the root has too many
+    if (_pNode != m_pRoot)
+    {
+        for (const OpenTreeNode* pChild : _pNode->Children)
         {
-            OpenTreeNode* pNode = Stack.back();
-            Stack.pop_back();
+            if (pChild->pParent != _pNode)
+                return "child does not point to its parent";
+        }
+    }
 
-            m_Nodes.insert(pNode);
+    // armed nodes have closed an outgoing edge after being visited, the closed and open edges of a block are bounded by its branch targets
+    if (_pNode->uClosedOutgoing != 0u && _pNode->bVisited == false)
+        return "unvisited node has closed outgoing edges";
 
-            for (OpenTreeNode* pChild : pNode->Children)
-            {
-                if (m_Nodes.count(pChild) == 0)
-                {
-                    Stack.push_back(pChild);
-                }
-                else // node is a child => cannot be a root
-                {
-                    m_Roots.erase(pChild);
-                }
-            }
+    if (_pNode->bFlow)
+    {
+        if (_pNode->FinalOutgoing.size() > _pNode->uClosedOutgoing)
+            return "more flow targets than closed outgoing edges";
+    }
+    else if (_pNode != m_pRoot && _pNode->pBB->GetTerminator() != nullptr)
+    {
+        const Instruction* pTerminator = _pNode->pBB->GetTerminator();
+        const uint32_t uTargets = pTerminator->Is(kInstruction_BranchCond) ? 2u : pTerminator->Is(kInstruction_Branch) ? 1u : 0u;
+
+        if (_pNode->uClosedOutgoing + uOutgoing > uTargets)
+            return "more open and closed outgoing edges than branch targets";
+    }
+
+    return nullptr;
+}
+
+bool OpenTree::Verify(const BasicBlock* _pBB, const uint32_t _uStep, std::initializer_list<const OpenTreeNode*> _Nodes, const std::vector<OpenTreeNode*>& _Touched)
+{
+    if (m_bVerify == false)
+        return true;
+
+    const uint32_t uStep = m_uStep++;
+
+    const auto Check = [&](const OpenTreeNode* _pNode)
+    {
+        const char* sError = _pNode != nullptr ? VerifyNode(_pNode) : nullptr;
+
+        if (sError != nullptr)
+        {
+            HLOGE("OT verification failed at step %u (%s_step%u) on %s: %s", uStep, WCSTR(_pBB->GetName()), _uStep, WCSTR(_pNode->sName), WCSTR(std::string(sError)));
+            m_uFailedStep = uStep;
+        }
+
+        return sError == nullptr;
+    };
+
+    return std::all_of(_Nodes.begin(), _Nodes.end(), Check) && std::all_of(_Touched.begin(), _Touched.end(), Check);
+}
+
+Instruction* OpenTree::ConstantBool(const bool _bValue)
+{
+    Instruction*& pConstant = m_pConstants[_bValue ? 1u : 0u];
+
+    if (pConstant == nullptr)
+    {
+        pConstant = m_pFunction->Constant(_bValue);
+    }
+
+    return pConstant;
+}
+
+OpenSubTreeUnion::OpenSubTreeUnion(OpenTree& _OT, const std::vector<OpenTreeNode*>& _Roots) :
+    m_uMark(++_OT.m_uUnionMark), m_Roots(_OT.m_UnionRoots), m_Nodes(_OT.m_UnionNodes)
+{
+    m_Roots.clear();
+    m_Nodes.clear();
+
+    for (OpenTreeNode* pRoot : _Roots)
+    {
+        pRoot->uUnionMark = m_uMark;
+    }
+
+    for (OpenTreeNode* pRoot : _Roots)
+    {
+        // skip duplicates (backwardeges from armed preds) and roots within the subtree of another root
+        if (Contains(pRoot->pParent) == false && std::find(m_Roots.begin(), m_Roots.end(), pRoot) == m_Roots.end())
+        {
+            m_Roots.push_back(pRoot);
         }
     }
 }
 
-const bool OpenSubTreeUnion::HasOutgoingNotLeadingTo(BasicBlock* _pBB) const
+// appends the nodes with open outgoing edges in pre-order, the aggregates of the subtree are up to date
+static void GatherOutgoing(OpenTreeNode* _pNode, std::vector<OpenTreeNode*>& _Stack, std::vector<OpenTreeNode*>& _Nodes)
 {
-    for (OpenTreeNode* pNode : m_Nodes)
+    _Stack.assign(1u, _pNode);
+    while (_Stack.empty() == false)
     {
-        for (auto& Out : pNode->Outgoing)
+        OpenTreeNode* pNode = _Stack.back();
+        _Stack.pop_back();
+
+        if (pNode->Outgoing.empty() == false)
+        {
+            _Nodes.push_back(pNode);
+        }
+
+        // reversed to visit the children in order
+        for (auto it = pNode->Children.rbegin(); it != pNode->Children.rend(); ++it)
         {
-            if (Out.pTarget->pBB != _pBB) // LLVM code also checks if target is UNVISITED (should be the case here)
+            if ((*it)->uSubtreeOutgoing != 0u)
             {
-                return true;
+                _Stack.push_back(*it);
             }
         }
     }
+}
+
+const std::vector<OpenTreeNode*>& OpenSubTreeUnion::GetOutgoingNodes()
+{
+    if (m_Nodes.empty())
+    {
+        for (OpenTreeNode* pRoot : m_Roots)
+        {
+            pRoot->UpdateSubtree();
+            GatherOutgoing(pRoot, pRoot->pOT->m_NodeStack, m_Nodes);
+        }
+    }
+
+    return m_Nodes;
+}
+
+bool OpenSubTreeUnion::Contains(const OpenTreeNode* _pNode) const
+{
+    for (; _pNode != nullptr; _pNode = _pNode->pParent)
+    {
+        if (_pNode->uUnionMark == m_uMark)
+            return true;
+    }
 
     return false;
 }
 
-const bool OpenSubTreeUnion::HasMultiRootsOrOutgoing() const
+const bool OpenSubTreeUnion::HasOutgoingNotLeadingTo(const OpenTreeNode* _pNode) const
 {
-    //// TODO: check if roots have open outgoing edges, otherwise theres nothing to reroute
-    //if (m_Roots.size() > 1u)
-    //{
-    //    for (OpenTreeNode* pNode : m_Nodes)
-    //    {
-    //        if (pNode->Outgoing.empty() == false)
-    //            return true;
-    //    }
+    uint32_t uOutgoing = 0u;
+    for (OpenTreeNode* pRoot : m_Roots)
+    {
+        pRoot->UpdateSubtree();
+        uOutgoing += pRoot->uSubtreeOutgoing;
+    }
 
-    //    HLOG("Subtree containing %d roots without open outoing edges", static_cast<uint32_t>(m_Roots.size()));
-    //}
+    // every open edge to _pNode is also an incoming edge of _pNode
+    uint32_t uLeadingTo = 0u;
+    for (const OpenEdge* pIn : _pNode->Incoming)
+    {
+        if (Contains(pIn->pSource))
+        {
+            ++uLeadingTo;
+        }
+    }
+
+    return uOutgoing > uLeadingTo;
+}
 
+const bool OpenSubTreeUnion::HasMultiRootsOrOutgoing() const
+{
     if (m_Roots.size() > 1u)
         return true;
 
-    OpenTreeNode* pFirstOut = nullptr;
-    for (OpenTreeNode* pNode : m_Nodes)
+    for (OpenTreeNode* pRoot : m_Roots)
     {
-        for (const auto& Out : pNode->Outgoing)
-        {
-            if (Out.pTarget->bVisited == false)
-            {
-                if (pFirstOut == nullptr)
-                {
-                    pFirstOut = Out.pTarget;
-                }
-                else if (pFirstOut != Out.pTarget)
-                {
-                    return true;
-                }
-            }
-        }
+        pRoot->UpdateSubtree();
+        return pRoot->bSubtreeMultipleTargets;
     }
 
     return false;
@@ -826,15 +1259,22 @@ const bool OpenSubTreeUnion::HasMultiRootsOrOutgoing() const
 
 const bool OpenSubTreeUnion::IsReconverging() const
 {
-    if (m_Nodes.empty()) return false;
+    if (m_Roots.empty()) return false;
+
+    Function* pFunc = m_Roots.front()->pOT->m_pFunction;
+    const PostDominators PDom(pFunc->GetExitBlock(), pFunc->GetCFG().GetNodes().size());
 
-    Function* pFunc = (*m_Nodes.begin())->pBB->GetCFG()->GetFunction();
-    DominatorTree PDT{ pFunc->GetPostDominatorTree() };
+    std::vector<OpenTreeNode*> Stack(m_Roots.begin(), m_Roots.end());
 
-    for (OpenTreeNode* pNode : m_Nodes)
+    while (Stack.empty() == false)
     {
-        if (CheckReconvergence::IsReconverging(pNode->pBB, PDT) == false)
+        OpenTreeNode* pNode = Stack.back();
+        Stack.pop_back();
+
+        if (CheckReconvergence::IsReconverging(pNode->pBB, PDom) == false)
             return false;
+
+        Stack.insert(Stack.end(), pNode->Children.begin(), pNode->Children.end());
     }
 
     return true;
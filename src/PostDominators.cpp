@@ -0,0 +1,82 @@
+#include "PostDominators.h"
+
+PostDominators::PostDominators(const BasicBlock* _pExit, const size_t _uNumBlocks)
+{
+    m_IPDom.assign(_uNumBlocks, nullptr);
+
+    if (_pExit == nullptr || _pExit->GetIdentifier() >= _uNumBlocks)
+        return;
+
+    // the exit is its own post dominator while iterating
+    BasicBlock* pExit = const_cast<BasicBlock*>(_pExit);
+
+    // post order of the reversed CFG
+    std::vector<uint32_t> PostOrder(_uNumBlocks, InvalidId);
+    std::vector<BasicBlock*> Blocks;
+    std::vector<std::pair<BasicBlock*, uint32_t>> Stack = { {pExit, 0u} };
+    std::vector<bool> Visited(_uNumBlocks, false);
+    Visited[pExit->GetIdentifier()] = true;
+
+    while (Stack.empty() == false)
+    {
+        auto& [pBB, uPred] = Stack.back();
+
+        if (uPred < pBB->GetPredecessors().size())
+        {
+            BasicBlock* pPred = pBB->GetPredecessors()[uPred++];
+            if (Visited[pPred->GetIdentifier()] == false)
+            {
+                Visited[pPred->GetIdentifier()] = true;
+                Stack.push_back({ pPred, 0u });
+            }
+        }
+        else
+        {
+            PostOrder[pBB->GetIdentifier()] = static_cast<uint32_t>(Blocks.size());
+            Blocks.push_back(pBB);
+            Stack.pop_back();
+        }
+    }
+
+    const auto Intersect = [&](BasicBlock* pA, BasicBlock* pB) -> BasicBlock*
+    {
+        while (pA != pB)
+        {
+            while (PostOrder[pA->GetIdentifier()] < PostOrder[pB->GetIdentifier()])
+                pA = m_IPDom[pA->GetIdentifier()];
+            while (PostOrder[pB->GetIdentifier()] < PostOrder[pA->GetIdentifier()])
+                pB = m_IPDom[pB->GetIdentifier()];
+        }
+        return pA;
+    };
+
+    m_IPDom[pExit->GetIdentifier()] = pExit;
+
+    for (bool bChanged = true; bChanged;)
+    {
+        bChanged = false;
+
+        // reverse post order, skipping the exit
+        for (auto it = Blocks.rbegin() + 1; it < Blocks.rend(); ++it)
+        {
+            BasicBlock* pBB = *it;
+            BasicBlock* pIPDom = nullptr;
+
+            for (BasicBlock* pSucc : pBB->GetSuccesors())
+            {
+                if (m_IPDom[pSucc->GetIdentifier()] != nullptr)
+                {
+                    pIPDom = pIPDom == nullptr ? pSucc : Intersect(pSucc, pIPDom);
+                }
+            }
+
+            if (m_IPDom[pBB->GetIdentifier()] != pIPDom)
+            {
+                m_IPDom[pBB->GetIdentifier()] = pIPDom;
+                bChanged = true;
+            }
+        }
+    }
+
+    m_IPDom[pExit->GetIdentifier()] = nullptr;
+}
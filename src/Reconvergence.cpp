@@ -0,0 +1,194 @@
+#include "Reconvergence.h"
+#include "Dot2CFG.h"
+#include "CFG2Dot.h"
+#include "OpenTree.h"
+#include "RegionReconvergence.h"
+#include "CheckReconvergence.h"
+#include "InstructionSetLLVMAMD.h"
+#include "InstructionSetSPIRV.h"
+#include "FunctionBinary.h"
+
+namespace
+{
+    size_t CountBlocks(const Function& _Func)
+    {
+        size_t uBlocks = 0u;
+        for (const BasicBlock& BB : _Func.GetCFG().GetNodes())
+        {
+            if (BB.IsVirtual() == false)
+            {
+                ++uBlocks;
+            }
+        }
+        return uBlocks;
+    }
+} // anonymous namespace
+
+ReconvergeStats Reconvergence::Run(Function& _Func, const ReconvergeOptions& _Options, OpenTree* _pOT, RegionReconvergence* _pRegions)
+{
+    const ScopedLogLimit Limit(_Options.kLogLevel);
+
+    ReconvergeStats Stats;
+    Stats.bInputReconverging = CheckReconvergence::Check(_Func); // without logging the violations
+    Stats.uInputBlocks = CountBlocks(_Func);
+
+    NodeOrder InputOrdering;
+
+    switch (_Options.kOrder)
+    {
+    case NodeOrdering::Order_DepthFirst:
+        InputOrdering = NodeOrdering::DepthFirst(_Func.GetEntryBlock());
+        break;
+    case NodeOrdering::Order_BreadthFirst:
+        InputOrdering = NodeOrdering::BreadthFirst(_Func.GetEntryBlock(), false);
+        break;
+    case NodeOrdering::Order_BreadthFirstDom:
+        InputOrdering = NodeOrdering::BreadthFirst(_Func.GetEntryBlock(), true);
+        break;
+    case NodeOrdering::Order_PostOrder:
+        InputOrdering = NodeOrdering::PostOrderTraversal(_Func.GetEntryBlock(), false);
+        break;
+    case NodeOrdering::Order_ReversePostOrder:
+        InputOrdering = NodeOrdering::PostOrderTraversal(_Func.GetEntryBlock(), true);
+        break;
+    case NodeOrdering::Order_DominanceRegion:
+        InputOrdering = NodeOrdering::DominanceRegion(_Func.GetEntryBlock());
+        break;
+    case NodeOrdering::Order_Custom:
+        InputOrdering = NodeOrdering::Custom(_Func.GetCFG(), _Options.sCustomOrder);
+        break;
+    case NodeOrdering::Order_DepthFirstDom:
+    default:
+        InputOrdering = NodeOrdering::DepthFirstPostDom(_Func.GetEntryBlock(), _Func.GetExitBlock());
+        break;
+    }
+
+    if (InputOrdering.size() != Stats.uInputBlocks)
+    {
+        HLOG_SYNC(HFATALD, "Ordering is not a valid traversal of the input CFG!");
+        return Stats;
+    }
+
+    for (BasicBlock* pBB : InputOrdering)
+    {
+        Stats.BlockOrder.push_back(pBB->GetIdentifier());
+    }
+
+    // only execute if nodes in ordering are not reconverging already
+    Stats.bChanged = !Stats.bInputReconverging ? NodeOrdering::PrepareOrdering(InputOrdering, _Options.bPutVirtualFront, true) : false;
+
+    // reconverge using InputOrdering
+    bool bVerificationFailed = false;
+
+    if (_pRegions != nullptr)
+    {
+        Stats.bChanged |= _pRegions->Process(_Func, InputOrdering);
+        bVerificationFailed = _pRegions->VerificationFailed();
+    }
+    else
+    {
+        // no debug dumps
+        OpenTree LocalOT(true, std::string(), _Options.bVerify);
+        OpenTree& OT = _pOT != nullptr ? *_pOT : LocalOT;
+
+        Stats.bChanged |= OT.Process(InputOrdering);
+        bVerificationFailed = OT.GetFailedStep() != InvalidId;
+        OT.Reset();
+    }
+
+    // the failing step has been logged, the function is only partially processed
+    if (bVerificationFailed)
+        return Stats;
+
+    _Func.Finalize();
+
+    Stats.bReconverging = CheckReconvergence::IsReconverging(_Func, true);
+    if (Stats.bReconverging)
+    {
+        HLOGI("Function is reconverging!\n");
+    }
+    else
+    {
+        HLOGE("Function is NOT reconverging!\n");
+    }
+
+    // empty if the function is reconverging
+    if (_Options.Sinks.pViolations != nullptr)
+    {
+        std::vector<ReconvergenceViolation> Violations;
+        CheckReconvergence::Check(_Func, &Violations);
+
+        CheckReconvergence::WriteReport(_Func, Violations, *_Options.Sinks.pViolations);
+    }
+
+    if (_Options.Sinks.pDot != nullptr)
+    {
+        CFG2Dot::WriteToStream(_Func.GetCFG(), *_Options.Sinks.pDot, _Func.GetName());
+    }
+
+    Stats.uOutputBlocks = CountBlocks(_Func);
+    Stats.bValid = Serialize(_Func, _Options.Sinks);
+
+    return Stats;
+}
+
+ReconvergeStats Reconvergence::Run(const std::string_view _sDot, const ReconvergeOptions& _Options, OpenTree* _pOT, RegionReconvergence* _pRegions)
+{
+    const ScopedLogLimit Limit(_Options.kLogLevel);
+
+    Function func = Dot2CFG::Convert(_sDot);
+
+    // no user blocks, the source could not be parsed
+    if (func.EnforceUniqueEntryPoint() == false || func.EnforceUniqueExitPoint() == false)
+        return {};
+
+    return Run(func, _Options, _pOT, _pRegions);
+}
+
+bool Reconvergence::Serialize(Function& _Func, const ReconvergeSinks& _Sinks)
+{
+    _Func.Finalize();
+
+    bool bSuccess = true;
+
+    if (_Sinks.pListing != nullptr || _Sinks.pBitcode != nullptr)
+    {
+        InstructionSetLLVMAMD isa;
+
+        if (_Sinks.pListing != nullptr)
+        {
+            bSuccess &= isa.SerializeListing(_Func, *_Sinks.pListing);
+        }
+
+        if (_Sinks.pBitcode != nullptr)
+        {
+            bSuccess &= isa.SerializeBinary(_Func, *_Sinks.pBitcode);
+        }
+    }
+
+    if (_Sinks.pBinary != nullptr)
+    {
+        bSuccess &= FunctionBinary::Write(_Func, *_Sinks.pBinary);
+    }
+
+    if (_Sinks.pSPIRV != nullptr || _Sinks.pSPIRVListing != nullptr)
+    {
+        InstructionSetSPIRV spirv;
+        bool bSPIRV = true;
+
+        if (_Sinks.pSPIRV != nullptr)
+        {
+            bSPIRV = spirv.SerializeBinary(_Func, *_Sinks.pSPIRV);
+        }
+
+        // a function without structured control flow is only reported once
+        if (_Sinks.pSPIRVListing != nullptr && bSPIRV)
+        {
+            bSPIRV = spirv.SerializeListing(_Func, *_Sinks.pSPIRVListing);
+        }
+
+        bSuccess &= bSPIRV;
+    }
+
+    return bSuccess;
+}
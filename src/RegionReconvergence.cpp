@@ -0,0 +1,456 @@
+#include "RegionReconvergence.h"
+#include "RegionTree.h"
+#include "ParallelFor.h"
+
+RegionReconvergence::RegionReconvergence(const uint32_t _uWorkers, const bool _bVerify) :
+    m_uWorkers(std::max(1u, _uWorkers)),
+    m_uActiveWorkers(m_uWorkers)
+{
+    // debug dumps are named after the blocks, regions are processed concurrently
+    m_Trees.reserve(m_uWorkers);
+    for (uint32_t w = 0u; w < m_uWorkers; ++w)
+    {
+        m_Trees.emplace_back(true, std::string(), _bVerify);
+    }
+}
+
+bool RegionReconvergence::Process(Function& _Func, const NodeOrder& _Ordering)
+{
+    const RegionTree Regions(_Func, &_Ordering);
+    const std::vector<Region>& Items = Regions.GetRegions();
+    const uint32_t uNumRegions = static_cast<uint32_t>(Items.size());
+    m_bVerificationFailed = false;
+
+    // the function is reconverging already
+    if (Items.front().bReconverging)
+    {
+        HLOGI("Skipping reconverging function %s", WCSTR(_Func.GetName()));
+        return false;
+    }
+
+    // no nested region, process the function as a whole
+    if (uNumRegions == 1u)
+    {
+        const bool bChanged = m_Trees.front().Process(_Ordering);
+        m_bVerificationFailed = m_Trees.front().GetFailedStep() != InvalidId;
+        m_Trees.front().Reset();
+        return bChanged;
+    }
+
+    const uint32_t uSkipped = static_cast<uint32_t>(std::count_if(Items.begin(), Items.end(), [](const Region& R) {return R.bReconverging; }));
+    HLOGI("Reconverging %s in %u SESE regions, %u are collapsed without processing", WCSTR(_Func.GetName()), uNumRegions - uSkipped, uSkipped);
+
+    const size_t uNumBlocks = _Func.GetCFG().GetNodes().size();
+
+    Build(_Func, Regions, _Ordering);
+
+    std::vector<uint8_t> Failed(uNumRegions, 0u);
+
+    // the workers log like the calling thread
+    const ELogLevel kLogLimit = LogLevel::GetThreadLimit();
+
+    ParallelFor(uNumRegions, m_uActiveWorkers, [&](const uint32_t _uRegion, const uint32_t _uWorker)
+    {
+        if (Items[_uRegion].bReconverging == false)
+        {
+            const ScopedLogLimit Limit(kLogLimit);
+            m_Trees[_uWorker].Process(m_Subs[_uRegion].Ordering);
+            Failed[_uRegion] = m_Trees[_uWorker].GetFailedStep() != InvalidId;
+            m_Trees[_uWorker].Reset();
+        }
+    });
+
+    // the sub functions of failed regions are incomplete
+    if (const auto it = std::find(Failed.begin(), Failed.end(), 1u); it != Failed.end())
+    {
+        HLOGE("OT verification failed in region %u of %s", static_cast<uint32_t>(it - Failed.begin()), WCSTR(_Func.GetName()));
+        m_bVerificationFailed = true;
+        m_Subs.clear();
+        return false;
+    }
+
+    Stitch(_Func, Regions);
+    m_Subs.clear();
+
+    // flow blocks or region exits were inserted
+    return _Func.GetCFG().GetNodes().size() != uNumBlocks;
+}
+
+void RegionReconvergence::Build(Function& _Func, const RegionTree& _Regions, const NodeOrder& _Ordering)
+{
+    const std::vector<Region>& Regions = _Regions.GetRegions();
+    ControlFlowGraph& CFG = _Func.GetCFG();
+
+    m_Subs.clear();
+
+    for (uint32_t r = 0u; r < Regions.size(); ++r)
+    {
+        SubFunction& Sub = m_Subs.emplace_back(_Func.GetName() + "_R" + std::to_string(r));
+
+        // entry points of sub and parent function
+        Sub.Blocks.push_back(&*CFG.begin());
+        Sub.Targets.push_back(&*CFG.begin());
+        Sub.Proxies.push_back(InvalidId);
+    }
+
+    const auto AddBlock = [](SubFunction& _Sub, const std::string& _sName, BasicBlock* _pParentBB, BasicBlock* _pTarget, const uint32_t _uProxy) -> BasicBlock*
+    {
+        _Sub.Blocks.push_back(_pParentBB);
+        _Sub.Targets.push_back(_pTarget);
+        _Sub.Proxies.push_back(_uProxy);
+        return _Sub.Func.GetCFG().NewNode(_sName);
+    };
+
+    // parent block id -> block in the sub function of the innermost region
+    std::vector<BasicBlock*> Mirrors(CFG.GetNodes().size(), nullptr);
+    // region -> proxy block in the sub function of the parent region
+    std::vector<BasicBlock*> Proxies(Regions.size(), nullptr);
+
+    for (auto it = CFG.begin() + 1, end = CFG.end(); it != end; ++it)
+    {
+        BasicBlock* pBB = &*it;
+        const uint32_t uRegion = _Regions.GetRegion(pBB);
+
+        if (uRegion != 0u && pBB == Regions[uRegion].pEntry)
+        {
+            BasicBlock* pProxy = AddBlock(m_Subs[Regions[uRegion].uParent], pBB->GetName() + "_REGION", nullptr, pBB, uRegion);
+            pProxy->SetDivergent(false);
+            Proxies[uRegion] = pProxy;
+        }
+
+        // reconverging regions are only represented by their proxy
+        if (Regions[uRegion].bReconverging == false)
+        {
+            BasicBlock* pMirror = AddBlock(m_Subs[uRegion], pBB->GetName(), pBB, pBB, InvalidId);
+            pMirror->SetDivergent(pBB->GetDivergenceQualifier());
+            Mirrors[pBB->GetIdentifier()] = pMirror;
+        }
+    }
+
+    for (uint32_t r = 1u; r < Regions.size(); ++r)
+    {
+        if (Regions[r].bReconverging == false)
+        {
+            m_Subs[r].pSink = AddBlock(m_Subs[r], Regions[r].pExit->GetName(), nullptr, nullptr, InvalidId);
+        }
+    }
+
+    // block of sub function _uRegion representing _pBB
+    const auto SubBlock = [&](BasicBlock* _pBB, const uint32_t _uRegion) -> BasicBlock*
+    {
+        if (_pBB == Regions[_uRegion].pExit)
+        {
+            return m_Subs[_uRegion].pSink;
+        }
+
+        uint32_t uRegion = _Regions.GetRegion(_pBB);
+        if (uRegion == _uRegion)
+        {
+            return Mirrors[_pBB->GetIdentifier()];
+        }
+
+        // edges only enter nested regions at their entry
+        while (uRegion != 0u && Regions[uRegion].uParent != _uRegion)
+        {
+            uRegion = Regions[uRegion].uParent;
+        }
+
+        HASSERT_SYNC(uRegion != 0u, "%s is not part of region %u", WCSTR(_pBB->GetName()), _uRegion);
+        return Proxies[uRegion];
+    };
+
+    const auto Seed = [](SubFunction& _Sub, const Instruction* _pSubInstr, Instruction* _pParentInstr)
+    {
+        if (_Sub.Instructions.size() <= _pSubInstr->GetIdentifier())
+        {
+            _Sub.Instructions.resize(_pSubInstr->GetIdentifier() + 1u, nullptr);
+        }
+
+        _Sub.Instructions[_pSubInstr->GetIdentifier()] = _pParentInstr;
+    };
+
+    // copy the terminators, conditions are replaced by boolean parameters of the sub function
+    for (auto it = CFG.begin() + 1, end = CFG.end(); it != end; ++it)
+    {
+        BasicBlock* pBB = &*it;
+        const uint32_t uRegion = _Regions.GetRegion(pBB);
+        SubFunction& Sub = m_Subs[uRegion];
+
+        Instruction* pTerminator = pBB->GetTerminator();
+        BasicBlock* pMirror = Mirrors[pBB->GetIdentifier()];
+        Instruction* pCopy = nullptr;
+
+        if (pTerminator == nullptr || pMirror == nullptr)
+        {
+            continue;
+        }
+        else if (pTerminator->Is(kInstruction_Branch))
+        {
+            pCopy = pMirror->AddInstruction()->Branch(SubBlock(pTerminator->GetOperandBB(0u), uRegion));
+        }
+        else if (pTerminator->Is(kInstruction_BranchCond))
+        {
+            Instruction* pCondition = pTerminator->GetOperandInstr(0u);
+            Instruction*& pPlaceholder = Sub.Conditions[pCondition];
+
+            if (pPlaceholder == nullptr)
+            {
+                pPlaceholder = Sub.Func.AddParameter(Sub.Func.Type<bool>());
+                Seed(Sub, pPlaceholder, pCondition);
+            }
+
+            pCopy = pMirror->AddInstruction()->BranchCond(pPlaceholder,
+                SubBlock(pTerminator->GetOperandBB(1u), uRegion),
+                SubBlock(pTerminator->GetOperandBB(2u), uRegion));
+        }
+
+        // returns stay in the parent
+        if (pCopy != nullptr)
+        {
+            Seed(Sub, pCopy, pTerminator);
+        }
+    }
+
+    for (uint32_t r = 1u; r < Regions.size(); ++r)
+    {
+        Proxies[r]->AddInstruction()->Branch(SubBlock(Regions[r].pExit, Regions[r].uParent));
+    }
+
+    // nested regions are processed in the order of their first block, the sink of a region comes last
+    std::vector<bool> Ordered(Regions.size(), false);
+
+    for (BasicBlock* pBB : _Ordering)
+    {
+        uint32_t uRegion = _Regions.GetRegion(pBB);
+
+        if (BasicBlock* pMirror = Mirrors[pBB->GetIdentifier()]; pMirror != nullptr)
+        {
+            m_Subs[uRegion].Ordering.push_back(pMirror);
+        }
+
+        for (; uRegion != 0u && Ordered[uRegion] == false; uRegion = Regions[uRegion].uParent)
+        {
+            Ordered[uRegion] = true;
+            m_Subs[Regions[uRegion].uParent].Ordering.push_back(Proxies[uRegion]);
+        }
+    }
+
+    for (uint32_t r = 1u; r < Regions.size(); ++r)
+    {
+        if (m_Subs[r].pSink != nullptr)
+        {
+            m_Subs[r].Ordering.push_back(m_Subs[r].pSink);
+        }
+    }
+}
+
+void RegionReconvergence::Stitch(Function& _Func, const RegionTree& _Regions)
+{
+    const std::vector<Region>& Regions = _Regions.GetRegions();
+    ControlFlowGraph& CFG = _Func.GetCFG();
+    const InstrId uNumParentBlocks = static_cast<InstrId>(CFG.GetNodes().size());
+
+    // region -> block targeted by the edges leaving the region
+    std::vector<BasicBlock*> Exits(Regions.size(), nullptr);
+    std::vector<BasicBlock*> Collapsed;
+
+    // create the blocks of the sub functions which are not mirrored, parents are stitched before their nested regions
+    for (uint32_t r = 0u; r < Regions.size(); ++r)
+    {
+        SubFunction& Sub = m_Subs[r];
+        const size_t uNumBlocks = Sub.Func.GetCFG().GetNodes().size();
+        const std::string sPrefix = r == 0u ? std::string() : Regions[r].pEntry->GetName() + "_";
+        const size_t uNumCopied = Sub.Blocks.size(); // blocks after this were added by the OT
+
+        Sub.Blocks.resize(uNumBlocks, nullptr);
+        Sub.Targets.resize(uNumBlocks, nullptr);
+        Sub.Proxies.resize(uNumBlocks, InvalidId);
+
+        for (BasicBlock& BB : Sub.Func.GetCFG())
+        {
+            const InstrId uId = BB.GetIdentifier();
+
+            if (Sub.Blocks[uId] != nullptr)
+            {
+                continue;
+            }
+            else if (&BB == Sub.pSink)
+            {
+                Sub.Blocks[uId] = Sub.Targets[uId] = Exits[r];
+            }
+            else if (const uint32_t uProxy = Sub.Proxies[uId]; uProxy != InvalidId && Regions[uProxy].bReconverging)
+            {
+                // the sink of this region is not resolved yet
+                Collapsed.push_back(&BB);
+            }
+            else if (uProxy != InvalidId)
+            {
+                // branches to the proxy enter the region, instructions of the proxy leave it
+                Exits[uProxy] = Sub.Blocks[uId] = CFG.NewNode(Regions[uProxy].pEntry->GetName() + "_EXIT");
+                Exits[uProxy]->SetDivergent(BB.GetDivergenceQualifier());
+            }
+            else
+            {
+                Sub.Blocks[uId] = Sub.Targets[uId] = CFG.NewNode(sPrefix + BB.GetName());
+                Sub.Blocks[uId]->SetDivergent(BB.GetDivergenceQualifier());
+            }
+        }
+
+        // collapsed regions keep their blocks, an exit block is only needed if the proxy was rerouted through a FLOW block
+        for (BasicBlock* pProxy : Collapsed)
+        {
+            const InstrId uId = pProxy->GetIdentifier();
+            const uint32_t uProxy = Sub.Proxies[uId];
+            const Instruction* pTerminator = pProxy->GetTerminator();
+
+            if (pProxy->GetInstructions().size() == 1u && pTerminator->Is(kInstruction_Branch) && pTerminator->GetOperandBB(0u)->GetIdentifier() < uNumCopied)
+            {
+                Exits[uProxy] = Sub.Targets[pTerminator->GetOperandBB(0u)->GetIdentifier()];
+            }
+            else
+            {
+                Exits[uProxy] = Sub.Blocks[uId] = CFG.NewNode(Regions[uProxy].pEntry->GetName() + "_EXIT");
+                Exits[uProxy]->SetDivergent(pProxy->GetDivergenceQualifier());
+            }
+        }
+
+        Collapsed.clear();
+    }
+
+    // redirect the edges leaving collapsed regions
+    for (InstrId i = 1u; i < uNumParentBlocks; ++i)
+    {
+        BasicBlock* pBB = CFG.GetNode(i);
+        const uint32_t uRegion = _Regions.GetRegion(pBB);
+        const Region& R = Regions[uRegion];
+        Instruction* pTerminator = pBB->GetTerminator();
+
+        if (R.bReconverging == false || Exits[uRegion] == R.pExit || R.pExit->IsSuccessorOf(pBB) == false)
+            continue;
+
+        const auto Retarget = [&](BasicBlock* _pTarget) { return _pTarget == R.pExit ? Exits[uRegion] : _pTarget; };
+
+        if (pTerminator->Is(kInstruction_Branch))
+        {
+            BasicBlock* pTarget = Retarget(pTerminator->GetOperandBB(0u));
+            pTerminator->Reset()->Branch(pTarget);
+        }
+        else if (pTerminator->Is(kInstruction_BranchCond))
+        {
+            Instruction* pCondition = pTerminator->GetOperandInstr(0u);
+            BasicBlock* pTrue = Retarget(pTerminator->GetOperandBB(1u));
+            BasicBlock* pFalse = Retarget(pTerminator->GetOperandBB(2u));
+            pTerminator->Reset()->BranchCond(pCondition, pTrue, pFalse);
+        }
+    }
+
+    // allocate the instructions at the same position relative to the previous instruction of the sub block
+    for (SubFunction& Sub : m_Subs)
+    {
+        const ControlFlowGraph& SubCFG = Sub.Func.GetCFG();
+        const size_t uNumInstructions = SubCFG.GetInstructions().size();
+
+        Sub.Instructions.resize(uNumInstructions, nullptr);
+        Sub.Fill.assign(uNumInstructions, false);
+
+        for (const BasicBlock& BB : SubCFG)
+        {
+            BasicBlock* pParentBB = Sub.Blocks[BB.GetIdentifier()];
+            Instruction* pPrev = nullptr;
+
+            // unchanged proxy of a collapsed region
+            if (pParentBB == nullptr)
+                continue;
+
+            for (const Instruction& I : BB)
+            {
+                const InstrId uId = I.GetIdentifier();
+                Instruction*& pInstr = Sub.Instructions[uId];
+
+                if (pInstr != nullptr) // copied terminator or condition placeholder
+                {
+                    Sub.Fill[uId] = I.Is(kInstruction_FunctionParameter) == false;
+                }
+                else if (I.Is(kInstruction_Type))
+                {
+                    pInstr = _Func.Type(SubCFG.ResolveType(&I));
+                }
+                else if (I.Is(kInstruction_Constant))
+                {
+                    HASSERT_SYNC(SubCFG.ResolveType(I.GetResultTypeId()).kType == kType_Bool, "Unsupported constant in sub function");
+                    pInstr = _Func.Constant<bool>(I.GetOperands()[0].uId != 0u);
+                }
+                else
+                {
+                    if (pPrev != nullptr)
+                    {
+                        pInstr = pPrev->GetBasicBlock()->InsertInstructionAfter(pPrev);
+                    }
+                    else if (pParentBB->GetTerminator() != nullptr)
+                    {
+                        pInstr = pParentBB->InsertInstructionBefore(pParentBB->GetTerminator());
+                    }
+                    else
+                    {
+                        pInstr = pParentBB->AddInstruction();
+                    }
+
+                    Sub.Fill[uId] = true;
+                }
+
+                pPrev = pInstr;
+            }
+        }
+    }
+
+    // translate the instructions in creation order, operands are defined before they are used
+    for (SubFunction& Sub : m_Subs)
+    {
+        const std::vector<Instruction*>& SubInstructions = Sub.Func.GetCFG().GetInstructions();
+
+        const auto Value = [&](const Instruction* _pSubInstr) { return Sub.Instructions[_pSubInstr->GetIdentifier()]; };
+        const auto Target = [&](const BasicBlock* _pSubBB) { return Sub.Targets[_pSubBB->GetIdentifier()]; };
+
+        for (size_t i = 0u; i < SubInstructions.size(); ++i)
+        {
+            if (Sub.Fill[i] == false)
+                continue;
+
+            const Instruction* pSubInstr = SubInstructions[i];
+            Instruction* pInstr = Sub.Instructions[i]->Reset();
+            Instruction* pResult = nullptr;
+
+            switch (pSubInstr->GetInstruction())
+            {
+            case kInstruction_Branch:
+                pResult = pInstr->Branch(Target(pSubInstr->GetOperandBB(0u)));
+                break;
+            case kInstruction_BranchCond:
+                pResult = pInstr->BranchCond(Value(pSubInstr->GetOperandInstr(0u)), Target(pSubInstr->GetOperandBB(1u)), Target(pSubInstr->GetOperandBB(2u)));
+                break;
+            case kInstruction_Not:
+                pResult = pInstr->Not(Value(pSubInstr->GetOperandInstr(0u)));
+                break;
+            case kInstruction_Phi:
+            {
+                const InstrId uCount = pSubInstr->GetOperands()[0].uId;
+                std::vector<Instruction*> Values;
+                std::vector<BasicBlock*> Origins;
+
+                for (InstrId v = 0u; v < uCount; ++v)
+                {
+                    Values.push_back(Value(pSubInstr->GetOperandInstr(1u + v)));
+                    Origins.push_back(Sub.Blocks[pSubInstr->GetOperandBB(1u + uCount + v)->GetIdentifier()]);
+                }
+
+                pResult = pInstr->Phi(Values, Origins);
+                break;
+            }
+            default:
+                break;
+            }
+
+            HASSERT_SYNC(pResult != nullptr, "Failed to stitch instruction %s of %s", WCSTR(pSubInstr->GetAlias()), WCSTR(Sub.Func.GetName()));
+        }
+    }
+}
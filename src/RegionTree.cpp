@@ -0,0 +1,153 @@
+#include "RegionTree.h"
+#include "Function.h"
+#include "CheckReconvergence.h"
+#include <algorithm>
+
+RegionTree::RegionTree(Function& _Func, const NodeOrder* _pOrdering, const uint32_t _uMinBlocks) :
+    m_PDom(_Func.GetExitBlock(), _Func.GetCFG().GetNodes().size())
+{
+    ControlFlowGraph& CFG = _Func.GetCFG();
+    const uint32_t uNumBlocks = static_cast<uint32_t>(CFG.GetNodes().size());
+
+    const auto Reconverging = [this](const BasicBlock* pBB)
+    {
+        return CheckReconvergence::IsReconverging(pBB, m_PDom);
+    };
+
+    // root region, all blocks belong to it until a nested region claims them
+    m_Regions.push_back({ _Func.GetEntryBlock(), nullptr, InvalidId, uNumBlocks, false, {} });
+    m_Regions.front().bReconverging = std::all_of(CFG.begin(), CFG.end(), [&](const BasicBlock& BB) {return Reconverging(&BB); });
+    m_BlockRegion.assign(uNumBlocks, 0u);
+
+    struct Candidate
+    {
+        BasicBlock* pEntry;
+        BasicBlock* pExit;
+        bool bReconverging;
+        std::vector<BasicBlock*> Blocks;
+    };
+
+    // a collapsed region is a uniform block branching to its exit, which is a back edge if the exit is ordered first
+    std::vector<uint32_t> Position(uNumBlocks, 0u);
+    if (_pOrdering != nullptr)
+    {
+        uint32_t uPosition = 0u;
+        for (const BasicBlock* pBB : *_pOrdering)
+        {
+            Position[pBB->GetIdentifier()] = uPosition++;
+        }
+    }
+
+    std::vector<Candidate> Candidates;
+    std::vector<uint32_t> Marks(uNumBlocks, InvalidId);
+    std::vector<BasicBlock*> Stack;
+
+    // a scan costs the blocks of its region, nested regions are scanned again for every enclosing H.
+    // the sum is O(N * E) for deeply nested regions (a chain of N nested regions scans N^2 / 2 blocks),
+    // the test graphs scan at most 9 blocks per block. once the budget is spent no further H is scanned
+    const uint64_t uScanBudget = uScanBlocksPerBlock * uNumBlocks;
+    uint64_t uScanned = 0u;
+
+    // every block H with ipdom T spans the candidate region of all blocks reachable from H without passing T.
+    // all edges leaving the region target T, it is a SESE region if no edge from outside enters any other block than H
+    for (BasicBlock& H : CFG)
+    {
+        // the virtual entry point holding types and constants is shared with the sub functions of the regions
+        BasicBlock* pT = GetImmediatePostDominator(&H);
+        if (pT == nullptr || H.GetIdentifier() == 0u)
+            continue;
+
+        const uint32_t uMark = H.GetIdentifier();
+        std::vector<BasicBlock*> Blocks;
+        bool bValid = true;
+
+        Marks[uMark] = uMark;
+        Stack.assign(1u, &H);
+
+        while (Stack.empty() == false && bValid && uScanned < uScanBudget)
+        {
+            BasicBlock* pBB = Stack.back();
+            Stack.pop_back();
+            Blocks.push_back(pBB);
+            ++uScanned;
+
+            // blocks not reaching the exit can not be reconverged on their own
+            bValid = GetImmediatePostDominator(pBB) != nullptr;
+
+            for (BasicBlock* pSucc : pBB->GetSuccesors())
+            {
+                if (pSucc != pT && Marks[pSucc->GetIdentifier()] != uMark)
+                {
+                    Marks[pSucc->GetIdentifier()] = uMark;
+                    Stack.push_back(pSucc);
+                }
+            }
+        }
+
+        if (bValid && Stack.empty() == false)
+        {
+            HLOGI("Region scan of function %s stopped at block %s after %llu blocks", WCSTR(_Func.GetName()), WCSTR(H.GetName()), static_cast<unsigned long long>(uScanned));
+            break;
+        }
+
+        if (bValid == false || Blocks.size() < _uMinBlocks)
+            continue;
+
+        bool bReconverging = true;
+        bool bOrdered = true;
+
+        for (BasicBlock* pBB : Blocks)
+        {
+            for (BasicBlock* pPred : pBB->GetPredecessors())
+            {
+                bValid &= pBB == &H || Marks[pPred->GetIdentifier()] == uMark;
+            }
+
+            bReconverging &= Reconverging(pBB);
+            bOrdered &= Position[pBB->GetIdentifier()] <= Position[pT->GetIdentifier()];
+        }
+
+        // reconverging regions are only worth collapsing, which requires the exit to be ordered after the region
+        if (bValid && (bReconverging == false || bOrdered))
+        {
+            Candidates.push_back({ &H, pT, bReconverging, std::move(Blocks) });
+        }
+    }
+
+    // largest regions first, a candidate is nested in a region if all of its blocks belong to it.
+    // candidates partially overlapping an accepted region, containing its entry or nested in a reconverging region are dropped
+    std::vector<uint32_t> Order(Candidates.size());
+    for (uint32_t i = 0u; i < Order.size(); ++i)
+    {
+        Order[i] = i;
+    }
+
+    std::sort(Order.begin(), Order.end(), [&](const uint32_t l, const uint32_t r)
+    {
+        const Candidate& L = Candidates[l];
+        const Candidate& R = Candidates[r];
+        return L.Blocks.size() != R.Blocks.size() ? L.Blocks.size() > R.Blocks.size() : L.pEntry->GetIdentifier() < R.pEntry->GetIdentifier();
+    });
+
+    for (const uint32_t c : Order)
+    {
+        Candidate& C = Candidates[c];
+        const uint32_t uParent = m_BlockRegion[C.pEntry->GetIdentifier()];
+
+        if (m_Regions[uParent].bReconverging || std::all_of(C.Blocks.begin(), C.Blocks.end(), [&](BasicBlock* pBB)
+            {return m_BlockRegion[pBB->GetIdentifier()] == uParent && pBB != m_Regions[uParent].pEntry; }) == false)
+            continue;
+
+        const uint32_t uRegion = static_cast<uint32_t>(m_Regions.size());
+        m_Regions.push_back({ C.pEntry, C.pExit, uParent, static_cast<uint32_t>(C.Blocks.size()), C.bReconverging, {} });
+        m_Regions[uParent].Children.push_back(uRegion);
+
+        for (BasicBlock* pBB : C.Blocks)
+        {
+            m_BlockRegion[pBB->GetIdentifier()] = uRegion;
+        }
+
+        HLOGV("Region %u: %s -> %s [%u blocks] in region %u%s", uRegion, WCSTR(C.pEntry->GetName()), WCSTR(C.pExit->GetName()),
+            static_cast<uint32_t>(C.Blocks.size()), uParent, C.bReconverging ? L" reconverging" : L"");
+    }
+}
@@ -0,0 +1,262 @@
+#include "ResultCache.h"
+#include "MappedFile.h"
+#include "LogLevel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t uMagic = 0x434c3244u; // "D2LC"
+    constexpr uint64_t uFNVOffset = 14695981039346656037ull;
+    constexpr uint64_t uFNVPrime = 1099511628211ull;
+
+    uint64_t FNV1a(uint64_t _uHash, const void* _pData, const size_t _uSize)
+    {
+        const uint8_t* pBytes = static_cast<const uint8_t*>(_pData);
+        for (size_t i = 0u; i < _uSize; ++i)
+        {
+            _uHash = (_uHash ^ pBytes[i]) * uFNVPrime;
+        }
+        return _uHash;
+    }
+
+#ifndef DOT2LL_BUILD_ID
+    std::filesystem::path GetExecutablePath()
+    {
+#ifdef _WIN32
+        wchar_t sPath[MAX_PATH];
+        const DWORD uLength = GetModuleFileNameW(nullptr, sPath, MAX_PATH);
+        return uLength != 0u && uLength < MAX_PATH ? std::filesystem::path(sPath) : std::filesystem::path();
+#else
+        std::error_code Error;
+        return std::filesystem::read_symlink("/proc/self/exe", Error);
+#endif
+    }
+#endif
+
+    // identifies the code producing the outputs: the DOT2LL_BUILD_ID definition (e.g. a git hash) if the build sets one,
+    // otherwise the contents of the executable, which change with any change to the tool. false if neither is available
+    bool ComputeBuildId(uint64_t& _uBuildId)
+    {
+#ifdef DOT2LL_BUILD_ID
+        const std::string_view sBuildId = DOT2LL_BUILD_ID;
+        _uBuildId = FNV1a(uFNVOffset, sBuildId.data(), sBuildId.size());
+        return true;
+#else
+        MappedFile Executable(GetExecutablePath());
+        if (Executable.IsOpen() == false)
+            return false;
+
+        _uBuildId = FNV1a(uFNVOffset, Executable.GetData(), Executable.GetSize());
+        return true;
+#endif
+    }
+
+    struct EntryHeader
+    {
+        uint32_t uMagic;
+        uint32_t uVersion;
+        uint32_t uIdBytes; // sizeof(InstrId)
+        uint32_t uNumFiles;
+        uint64_t uKey;
+        uint64_t uNumBlocks; // InstrId[uNumBlocks] follow the header
+    };
+
+    // followed by the name and the data
+    struct FileHeader
+    {
+        uint32_t uBinary;
+        uint32_t uNameLength;
+        uint64_t uDataLength;
+    };
+
+    // bounds checked reads of a mapped entry
+    class EntryReader
+    {
+    public:
+        EntryReader(const uint8_t* _pData, const size_t _uSize) : m_pData(_pData), m_uSize(_uSize) {}
+
+        bool Read(void* _pDest, const size_t _uSize)
+        {
+            if (_uSize > m_uSize - m_uPos)
+                return false;
+
+            std::memcpy(_pDest, m_pData + m_uPos, _uSize);
+            m_uPos += _uSize;
+            return true;
+        }
+
+        bool Read(std::string& _sDest, const size_t _uSize)
+        {
+            if (_uSize > m_uSize - m_uPos)
+                return false;
+
+            _sDest.assign(reinterpret_cast<const char*>(m_pData) + m_uPos, _uSize);
+            m_uPos += _uSize;
+            return true;
+        }
+
+        bool AtEnd() const { return m_uPos == m_uSize; }
+
+    private:
+        const uint8_t* m_pData;
+        size_t m_uSize;
+        size_t m_uPos = 0u;
+    };
+} // anonymous namespace
+
+ResultCache::ResultCache(const std::filesystem::path& _Dir) :
+    m_Dir(_Dir)
+{
+    if (m_Dir.empty())
+        return;
+
+    // entries of an unknown build could have been written by different code
+    if (ComputeBuildId(m_uBuildId) == false)
+    {
+        HLOGW("Failed to read the executable and DOT2LL_BUILD_ID is not defined, the result cache is disabled");
+        m_Dir.clear();
+        return;
+    }
+
+    std::error_code Error;
+    std::filesystem::create_directories(m_Dir, Error);
+}
+
+uint64_t ResultCache::ComputeKey(const std::string_view _sSource, const std::string_view _sOptions) const
+{
+    const uint32_t Tool[] = { uVersion, static_cast<uint32_t>(sizeof(InstrId)) };
+    const uint64_t uSourceLength = _sSource.size();
+
+    uint64_t uHash = FNV1a(uFNVOffset, Tool, sizeof(Tool));
+    uHash = FNV1a(uHash, &m_uBuildId, sizeof(m_uBuildId));
+    uHash = FNV1a(uHash, &uSourceLength, sizeof(uSourceLength));
+    uHash = FNV1a(uHash, _sSource.data(), _sSource.size());
+    return FNV1a(uHash, _sOptions.data(), _sOptions.size());
+}
+
+std::filesystem::path ResultCache::GetPath(const uint64_t _uKey) const
+{
+    char Name[32];
+    std::snprintf(Name, sizeof(Name), "%016llx.d2lc", static_cast<unsigned long long>(_uKey));
+    return m_Dir / Name;
+}
+
+bool ResultCache::Load(const uint64_t _uKey, CachedResult& _Result) const
+{
+    if (IsEnabled() == false)
+        return false;
+
+    const std::filesystem::path Path = GetPath(_uKey);
+
+    std::error_code Error;
+    if (std::filesystem::exists(Path, Error) == false)
+        return false;
+
+    MappedFile File(Path);
+    if (File.IsOpen() == false)
+        return false;
+
+    EntryReader Reader(File.GetData(), File.GetSize());
+
+    EntryHeader Header;
+    if (Reader.Read(&Header, sizeof(Header)) == false ||
+        Header.uMagic != uMagic || Header.uVersion != uVersion || Header.uIdBytes != sizeof(InstrId) || Header.uKey != _uKey)
+    {
+        HLOGW("Ignoring invalid cache entry %s", WCSTR(Path.string()));
+        return false;
+    }
+
+    _Result = {};
+    _Result.BlockOrder.resize(Header.uNumBlocks < File.GetSize() ? Header.uNumBlocks : 0u);
+    bool bValid = Header.uNumBlocks < File.GetSize() && Reader.Read(_Result.BlockOrder.data(), _Result.BlockOrder.size() * sizeof(InstrId));
+
+    for (uint32_t f = 0u; bValid && f < Header.uNumFiles; ++f)
+    {
+        FileHeader FH;
+        CachedFile& Entry = _Result.Files.emplace_back();
+
+        bValid = Reader.Read(&FH, sizeof(FH)) && Reader.Read(Entry.sName, FH.uNameLength) && Reader.Read(Entry.sData, FH.uDataLength);
+        Entry.bBinary = FH.uBinary != 0u;
+    }
+
+    if (bValid == false || Reader.AtEnd() == false)
+    {
+        HLOGW("Ignoring corrupted cache entry %s", WCSTR(Path.string()));
+        _Result = {};
+        return false;
+    }
+
+    return true;
+}
+
+bool ResultCache::Store(const uint64_t _uKey, const CachedResult& _Result) const
+{
+    if (IsEnabled() == false)
+        return false;
+
+    const std::filesystem::path Path = GetPath(_uKey);
+
+    // unique per writer, the rename replaces an entry written concurrently for the same key
+    std::ostringstream Suffix;
+    Suffix << ".tmp" << std::this_thread::get_id() << '_' << std::chrono::steady_clock::now().time_since_epoch().count();
+    std::filesystem::path TempPath = Path;
+    TempPath += Suffix.str();
+
+    {
+        std::ofstream out(TempPath, std::ios::binary);
+        if (out.is_open() == false)
+        {
+            HLOGW("Failed to write cache entry %s", WCSTR(TempPath.string()));
+            return false;
+        }
+
+        EntryHeader Header;
+        std::memset(&Header, 0, sizeof(Header));
+        Header.uMagic = uMagic;
+        Header.uVersion = uVersion;
+        Header.uIdBytes = sizeof(InstrId);
+        Header.uNumFiles = static_cast<uint32_t>(_Result.Files.size());
+        Header.uKey = _uKey;
+        Header.uNumBlocks = _Result.BlockOrder.size();
+
+        out.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(_Result.BlockOrder.data()), _Result.BlockOrder.size() * sizeof(InstrId));
+
+        for (const CachedFile& Entry : _Result.Files)
+        {
+            const FileHeader FH{ Entry.bBinary ? 1u : 0u, static_cast<uint32_t>(Entry.sName.size()), Entry.sData.size() };
+            out.write(reinterpret_cast<const char*>(&FH), sizeof(FH));
+            out.write(Entry.sName.data(), Entry.sName.size());
+            out.write(Entry.sData.data(), Entry.sData.size());
+        }
+
+        if (out.good() == false)
+        {
+            out.close();
+            std::error_code Error;
+            std::filesystem::remove(TempPath, Error);
+            return false;
+        }
+    }
+
+    std::error_code Error;
+    std::filesystem::rename(TempPath, Path, Error);
+    if (Error)
+    {
+        std::filesystem::remove(TempPath, Error);
+        return false;
+    }
+
+    return true;
+}
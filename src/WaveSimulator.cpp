@@ -0,0 +1,421 @@
+#include "WaveSimulator.h"
+#include "PostDominators.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint32_t LowestLane(const uint64_t _uMask)
+    {
+#ifdef _MSC_VER
+        unsigned long uIndex = 0u;
+        _BitScanForward64(&uIndex, _uMask);
+        return static_cast<uint32_t>(uIndex);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(_uMask));
+#endif
+    }
+
+    uint32_t CountLanes(const uint64_t _uMask)
+    {
+#ifdef _MSC_VER
+        return static_cast<uint32_t>(__popcnt64(_uMask));
+#else
+        return static_cast<uint32_t>(__builtin_popcountll(_uMask));
+#endif
+    }
+
+    // calls _Func(uLane) for every set bit
+    template <class Func>
+    void ForEachLane(uint64_t _uMask, const Func& _Func)
+    {
+        for (; _uMask != 0u; _uMask &= _uMask - 1u)
+        {
+            _Func(LowestLane(_uMask));
+        }
+    }
+
+    // splitmix64
+    uint64_t Mix(uint64_t _uValue)
+    {
+        _uValue += 0x9e3779b97f4a7c15ull;
+        _uValue = (_uValue ^ (_uValue >> 30u)) * 0xbf58476d1ce4e5b9ull;
+        _uValue = (_uValue ^ (_uValue >> 27u)) * 0x94d049bb133111ebull;
+        return _uValue ^ (_uValue >> 31u);
+    }
+
+    // -1, 0, 1 for the operand type, unordered floats compare as 2
+    int32_t Compare(const TypeInfo& _Type, const uint64_t _uLeft, const uint64_t _uRight)
+    {
+        const uint32_t uBits = _Type.kType == kType_Bool ? 1u : std::min(_Type.uElementBits, 64u);
+        const uint64_t uMask = uBits < 64u ? (uint64_t(1u) << uBits) - 1u : ~uint64_t(0u);
+
+        switch (_Type.kType)
+        {
+        case kType_Int:
+        {
+            const uint32_t uShift = 64u - uBits;
+            const int64_t iLeft = static_cast<int64_t>(_uLeft << uShift) >> uShift;
+            const int64_t iRight = static_cast<int64_t>(_uRight << uShift) >> uShift;
+            return iLeft < iRight ? -1 : (iLeft > iRight ? 1 : 0);
+        }
+        case kType_Float:
+            if (uBits == 32u || uBits == 64u)
+            {
+                double fLeft, fRight;
+                if (uBits == 32u)
+                {
+                    float f32Left, f32Right;
+                    const uint32_t uLeft32 = static_cast<uint32_t>(_uLeft), uRight32 = static_cast<uint32_t>(_uRight);
+                    std::memcpy(&f32Left, &uLeft32, sizeof(float));
+                    std::memcpy(&f32Right, &uRight32, sizeof(float));
+                    fLeft = f32Left;
+                    fRight = f32Right;
+                }
+                else
+                {
+                    std::memcpy(&fLeft, &_uLeft, sizeof(double));
+                    std::memcpy(&fRight, &_uRight, sizeof(double));
+                }
+                return fLeft < fRight ? -1 : (fLeft > fRight ? 1 : (fLeft == fRight ? 0 : 2));
+            }
+            [[fallthrough]];
+        default:
+            return (_uLeft & uMask) < (_uRight & uMask) ? -1 : ((_uLeft & uMask) > (_uRight & uMask) ? 1 : 0);
+        }
+    }
+
+    bool Predicate(const EInstruction _kInstr, const int32_t _iOrder)
+    {
+        switch (_kInstr)
+        {
+        case kInstruction_Equal: return _iOrder == 0;
+        case kInstruction_NotEqual: return _iOrder != 0;
+        case kInstruction_Less: return _iOrder == -1;
+        case kInstruction_LessEqual: return _iOrder == -1 || _iOrder == 0;
+        case kInstruction_Greater: return _iOrder == 1;
+        case kInstruction_GreaterEqual: return _iOrder == 1 || _iOrder == 0;
+        default: return false;
+        }
+    }
+
+    uint64_t Arithmetic(const EInstruction _kInstr, const TypeInfo& _Type, const uint64_t _uLeft, const uint64_t _uRight)
+    {
+        switch (_kInstr)
+        {
+        case kInstruction_Add: return _uLeft + _uRight;
+        case kInstruction_Sub: return _uLeft - _uRight;
+        case kInstruction_Mul: return _uLeft * _uRight;
+        case kInstruction_Div:
+            // no traps, division by zero yields zero
+            if (_uRight == 0u)
+                return 0u;
+            if (_Type.kType == kType_Int)
+                return static_cast<uint64_t>(static_cast<int64_t>(_uLeft) / static_cast<int64_t>(_uRight));
+            return _uLeft / _uRight;
+        default:
+            return 0u;
+        }
+    }
+} // anonymous namespace
+
+WaveSimulator::WaveSimulator(const SimulationOptions& _Options) :
+    m_Options(_Options)
+{
+    m_Options.uLanes = std::min(std::max(m_Options.uLanes, 1u), 64u);
+    m_Options.uRandomRange = std::max(m_Options.uRandomRange, 1u);
+    m_uFullMask = m_Options.uLanes == 64u ? ~uint64_t(0u) : (uint64_t(1u) << m_Options.uLanes) - 1u;
+}
+
+uint64_t WaveSimulator::GetLane(const InstrId _uId, const uint32_t _uLane)
+{
+    const InstrId uParam = m_ParamIndex[_uId];
+
+    if (uParam == InvalidId)
+    {
+        return m_Types[_uId].kType == kType_Bool ? (m_Masks[_uId] >> _uLane) & 1u : m_Lanes[_uId * m_Options.uLanes + _uLane];
+    }
+
+    if (const std::vector<uint64_t>* pValues = m_ParamValues[uParam]; pValues != nullptr)
+    {
+        return (*pValues)[pValues->size() == 1u ? 0u : _uLane];
+    }
+
+    // uniform parameters draw the same value for all lanes that read them equally often
+    const bool bUniform = m_pFunction->GetParameters()[uParam]->Is(kDecoration_Divergent) == false;
+    uint64_t& uReads = m_ReadCounts[uParam * m_Options.uLanes + _uLane];
+
+    return Mix(m_Options.uSeed ^ Mix(uParam ^ Mix((bUniform ? 0u : _uLane + 1u) ^ Mix(uReads++)))) % m_Options.uRandomRange;
+}
+
+uint64_t WaveSimulator::GetMask(const InstrId _uId, const uint64_t _uMask)
+{
+    if (m_ParamIndex[_uId] == InvalidId)
+        return m_Masks[_uId] & _uMask;
+
+    uint64_t uResult = 0u;
+    ForEachLane(_uMask, [&](const uint32_t l) { uResult |= (GetLane(_uId, l) != 0u ? uint64_t(1u) : 0u) << l; });
+    return uResult;
+}
+
+void WaveSimulator::SetMask(const InstrId _uId, const uint64_t _uMask, const uint64_t _uValue)
+{
+    m_Masks[_uId] = (m_Masks[_uId] & ~_uMask) | (_uValue & _uMask);
+}
+
+void WaveSimulator::Execute(const BasicBlock& _BB, const uint64_t _uMask)
+{
+    const uint32_t uLanes = m_Options.uLanes;
+
+    for (const Instruction& Instr : _BB)
+    {
+        const InstrId uId = Instr.GetIdentifier();
+        const std::vector<Operand>& Operands = Instr.GetOperands();
+        const bool bBool = m_Types[uId].kType == kType_Bool;
+
+        switch (Instr.GetInstruction())
+        {
+        case kInstruction_Phi:
+        {
+            const InstrId uCount = Operands[0].uId;
+            for (InstrId i = 0u; i < uCount; ++i)
+            {
+                const InstrId uValue = Operands[1u + i].uId;
+                const InstrId uOrigin = Operands[1u + uCount + i].uId;
+
+                uint64_t uFrom = 0u;
+                ForEachLane(_uMask, [&](const uint32_t l) { uFrom |= (m_PrevBlock[l] == uOrigin ? uint64_t(1u) : 0u) << l; });
+
+                if (bBool)
+                {
+                    SetMask(uId, uFrom, GetMask(uValue, uFrom));
+                }
+                else
+                {
+                    ForEachLane(uFrom, [&](const uint32_t l) { m_Lanes[uId * uLanes + l] = GetLane(uValue, l); });
+                }
+            }
+            break;
+        }
+        case kInstruction_Not:
+            if (bBool)
+                SetMask(uId, _uMask, ~GetMask(Operands[0].uId, _uMask));
+            else
+                ForEachLane(_uMask, [&](const uint32_t l) { m_Lanes[uId * uLanes + l] = ~GetLane(Operands[0].uId, l); });
+            break;
+        case kInstruction_Mov:
+            if (bBool)
+                SetMask(uId, _uMask, GetMask(Operands[0].uId, _uMask));
+            else
+                ForEachLane(_uMask, [&](const uint32_t l) { m_Lanes[uId * uLanes + l] = GetLane(Operands[0].uId, l); });
+            break;
+        case kInstruction_Equal:
+        case kInstruction_NotEqual:
+        case kInstruction_Less:
+        case kInstruction_LessEqual:
+        case kInstruction_Greater:
+        case kInstruction_GreaterEqual:
+        {
+            const InstrId uLeft = Operands[0].uId;
+            const InstrId uRight = Operands[1].uId;
+            const TypeInfo& Type = m_Types[uLeft];
+            uint64_t uResult = 0u;
+
+            if (Type.kType == kType_Bool && Instr.Is(kInstruction_Equal))
+            {
+                uResult = ~(GetMask(uLeft, _uMask) ^ GetMask(uRight, _uMask));
+            }
+            else if (Type.kType == kType_Bool && Instr.Is(kInstruction_NotEqual))
+            {
+                uResult = GetMask(uLeft, _uMask) ^ GetMask(uRight, _uMask);
+            }
+            else
+            {
+                ForEachLane(_uMask, [&](const uint32_t l)
+                {
+                    uResult |= (Predicate(Instr.GetInstruction(), Compare(Type, GetLane(uLeft, l), GetLane(uRight, l))) ? uint64_t(1u) : 0u) << l;
+                });
+            }
+
+            SetMask(uId, _uMask, uResult);
+            break;
+        }
+        case kInstruction_Add:
+        case kInstruction_Sub:
+        case kInstruction_Mul:
+        case kInstruction_Div:
+            ForEachLane(_uMask, [&](const uint32_t l)
+            {
+                m_Lanes[uId * uLanes + l] = Arithmetic(Instr.GetInstruction(), m_Types[uId], GetLane(Operands[0].uId, l), GetLane(Operands[1].uId, l));
+            });
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+SimulationStats WaveSimulator::Run(const Function& _Function)
+{
+    const ControlFlowGraph& cfg = _Function.GetCFG();
+    const uint32_t uLanes = m_Options.uLanes;
+    const size_t uNumInstructions = cfg.GetInstructions().size();
+    const size_t uNumBlocks = cfg.GetNodes().size();
+
+    SimulationStats Stats;
+    Stats.uLanes = uLanes;
+    Stats.BlockExecutions.assign(uNumBlocks, 0u);
+    Stats.BlockActiveLanes.assign(uNumBlocks, 0u);
+
+    m_pFunction = &_Function;
+    m_Types.assign(uNumInstructions, TypeInfo());
+    m_Masks.assign(uNumInstructions, 0u);
+    m_Lanes.assign(uNumInstructions * uLanes, 0u);
+    m_ParamIndex.assign(uNumInstructions, InvalidId);
+    m_ParamValues.assign(_Function.GetParameters().size(), nullptr);
+    m_ReadCounts.assign(_Function.GetParameters().size() * uLanes, 0u);
+    m_PrevBlock.assign(uLanes, InvalidId);
+
+    for (const Instruction* pInstr : cfg.GetInstructions())
+    {
+        if (pInstr == nullptr || pInstr->Is(kInstruction_Type) || pInstr->GetResultTypeId() == InvalidId)
+            continue;
+
+        const InstrId uId = pInstr->GetIdentifier();
+        m_Types[uId] = cfg.ResolveType(pInstr->GetResultTypeId());
+
+        if (pInstr->Is(kInstruction_Constant))
+        {
+            // constant data is stored in InstrId sized chunks
+            uint64_t uBits = 0u;
+            uint32_t uShift = 0u;
+            for (auto it = pInstr->GetOperands().begin(), end = pInstr->GetOperands().end(); it != end && uShift < 64u; ++it, uShift += sizeof(InstrId) * 8u)
+            {
+                uBits |= static_cast<uint64_t>(it->uId) << uShift;
+            }
+
+            m_Masks[uId] = (uBits & 1u) != 0u ? m_uFullMask : 0u;
+            std::fill_n(m_Lanes.begin() + uId * uLanes, uLanes, uBits);
+        }
+    }
+
+    for (InstrId p = 0u; p < _Function.GetParameters().size(); ++p)
+    {
+        const Instruction* pParam = _Function.GetParameters()[p];
+        m_ParamIndex[pParam->GetIdentifier()] = p;
+
+        if (auto it = m_Options.Values.find(pParam->GetAlias()); it != m_Options.Values.end() && (it->second.size() == 1u || it->second.size() >= uLanes))
+        {
+            m_ParamValues[p] = &it->second;
+        }
+        else if (it != m_Options.Values.end())
+        {
+            HLOGW("Ignoring %u values for parameter %s, expected 1 or %u", static_cast<uint32_t>(it->second.size()), WCSTR(pParam->GetAlias()), uLanes);
+        }
+    }
+
+    const PostDominators PDom(_Function.GetExitBlock(), uNumBlocks);
+
+    struct StackEntry
+    {
+        const BasicBlock* pBlock;
+        const BasicBlock* pReconvergence; // the entry is popped when reaching this block, its lanes continue with the entry below
+        uint64_t uMask;
+    };
+
+    std::vector<StackEntry> Stack = { { _Function.GetEntryBlock(), nullptr, m_uFullMask } };
+
+    while (Stack.empty() == false)
+    {
+        StackEntry& Top = Stack.back();
+
+        if (Top.pBlock == nullptr || Top.pBlock == Top.pReconvergence || Top.uMask == 0u)
+        {
+            Stack.pop_back();
+            continue;
+        }
+
+        if (Stats.uBlockExecutions >= m_Options.uMaxBlockExecutions)
+            break;
+
+        const BasicBlock& BB = *Top.pBlock;
+        const uint64_t uMask = Top.uMask;
+
+        Execute(BB, uMask);
+
+        // the virtual blocks only hold types, constants and the unique exit
+        if (BB.IsVirtual() == false)
+        {
+            const uint32_t uActive = CountLanes(uMask);
+            ++Stats.BlockExecutions[BB.GetIdentifier()];
+            Stats.BlockActiveLanes[BB.GetIdentifier()] += uActive;
+            ++Stats.uBlockExecutions;
+            Stats.uActiveLanes += uActive;
+            Stats.uSerializedExecutions += uMask != m_uFullMask;
+        }
+
+        ForEachLane(uMask, [&](const uint32_t l) { m_PrevBlock[l] = BB.GetIdentifier(); });
+
+        const Instruction* pTerminator = BB.GetTerminator();
+
+        if (pTerminator == nullptr || pTerminator->Is(kInstruction_Return))
+        {
+            Stack.pop_back();
+        }
+        else if (pTerminator->Is(kInstruction_Branch))
+        {
+            Top.pBlock = pTerminator->GetOperandBB(0u);
+        }
+        else if (pTerminator->Is(kInstruction_BranchCond))
+        {
+            const uint64_t uTrue = GetMask(pTerminator->GetOperands()[0].uId, uMask);
+            const uint64_t uFalse = uMask & ~uTrue;
+
+            if (uFalse == 0u)
+            {
+                Top.pBlock = pTerminator->GetOperandBB(1u);
+            }
+            else if (uTrue == 0u)
+            {
+                Top.pBlock = pTerminator->GetOperandBB(2u);
+            }
+            else
+            {
+                // the current entry waits at the reconvergence point for both sides, the true side runs first
+                const BasicBlock* pReconvergence = PDom.GetImmediate(&BB);
+                Top.pBlock = pReconvergence;
+
+                Stack.push_back({ pTerminator->GetOperandBB(2u), pReconvergence, uFalse });
+                Stack.push_back({ pTerminator->GetOperandBB(1u), pReconvergence, uTrue });
+                ++Stats.uDivergentBranches;
+            }
+        }
+        else
+        {
+            HLOGE("Block %s ends with an unsupported terminator", WCSTR(BB.GetName()));
+            break;
+        }
+    }
+
+    Stats.bCompleted = Stack.empty();
+
+    return Stats;
+}
+
+void WaveSimulator::WriteReport(const Function& _Function, const SimulationStats& _Stats, std::ostream& _OutStream)
+{
+    for (const BasicBlock& BB : _Function.GetCFG())
+    {
+        const InstrId uId = BB.GetIdentifier();
+        if (BB.IsVirtual() || uId >= _Stats.BlockExecutions.size())
+            continue;
+
+        const uint64_t uExecutions = _Stats.BlockExecutions[uId];
+        _OutStream << _Function.GetName() << '\t' << BB.GetName() << '\t' << uExecutions << '\t'
+            << (uExecutions != 0u ? double(_Stats.BlockActiveLanes[uId]) / double(uExecutions) : 0.0) << '\n';
+    }
+}
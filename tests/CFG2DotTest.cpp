@@ -0,0 +1,60 @@
+#include "Dot2CFG.h"
+#include "CFG2Dot.h"
+#include "DotWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// locks the text of CFG2Dot::WriteToStream to the golden file and to DotWriter::WriteToStream(CFG2Dot::Convert(...)).
+// the golden file is the reference, regenerate it only on an intended format change
+namespace
+{
+    std::string ReadFile(const std::filesystem::path& _Path)
+    {
+        std::ifstream File(_Path, std::ios::binary);
+        std::ostringstream Stream;
+        Stream << File.rdbuf();
+        return Stream.str();
+    }
+
+    bool Expect(const std::string& _sWhat, const std::string& _sActual, const std::string& _sExpected)
+    {
+        if (_sActual == _sExpected)
+            return true;
+
+        std::cerr << _sWhat << " does not match the golden file:\n" << _sActual << "expected:\n" << _sExpected;
+        return false;
+    }
+} // anonymous namespace
+
+int main()
+{
+    const std::filesystem::path Data = std::filesystem::path(__FILE__).parent_path() / "data";
+
+    const std::string sGolden = ReadFile(Data / "cfg2dot_golden.dot");
+    if (sGolden.empty())
+    {
+        std::cerr << "missing " << (Data / "cfg2dot_golden.dot").string() << '\n';
+        return 1;
+    }
+
+    // the virtual exit point joining F and G is only written as a successor
+    Function func = Dot2CFG::Convert(ReadFile(Data / "cfg2dot.dot"));
+    if (func.EnforceUniqueEntryPoint() == false || func.EnforceUniqueExitPoint() == false)
+    {
+        std::cerr << "failed to convert cfg2dot.dot\n";
+        return 1;
+    }
+
+    std::ostringstream Streamed, Written;
+    CFG2Dot::WriteToStream(func.GetCFG(), Streamed, func.GetName());
+    DotWriter::WriteToStream(CFG2Dot::Convert(func.GetCFG(), func.GetName()), Written);
+
+    bool bPassed = true;
+    bPassed &= Expect("CFG2Dot::WriteToStream", Streamed.str(), sGolden);
+    bPassed &= Expect("DotWriter::WriteToStream", Written.str(), sGolden);
+
+    std::cout << (bPassed ? "passed\n" : "FAILED\n");
+    return bPassed ? 0 : 1;
+}
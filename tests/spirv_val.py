@@ -0,0 +1,37 @@
+# validates the SPIR-V modules dot2ll writes for a directory of dot graphs.
+# usage: spirv_val.py <dot2ll> <input dir> [output dir], needs spirv-val of SPIRV-Tools on the PATH.
+# graphs without structured control flow write no module, they are counted but do not fail the check
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def main():
+    if len(sys.argv) < 3:
+        print('usage: spirv_val.py <dot2ll> <input dir> [output dir]')
+        return 2
+
+    dot2ll, inputs = sys.argv[1], sys.argv[2]
+    out = sys.argv[3] if len(sys.argv) > 3 else tempfile.mkdtemp(prefix='dot2ll_spirv_')
+
+    os.makedirs(out, exist_ok=True)
+    files = len([f for f in os.listdir(inputs) if f.endswith('.dot')])
+    subprocess.run([dot2ll, inputs, '-r', '-spirv', '-quiet', '-out', out], stdout=subprocess.DEVNULL, check=False)
+
+    modules = sorted(f for f in os.listdir(out) if f.endswith('.spv'))
+    failures = 0
+    for module in modules:
+        # dot2ll emits SPIR-V 1.3, the version of Vulkan 1.1
+        result = subprocess.run(['spirv-val', '--target-env', 'vulkan1.1', os.path.join(out, module)], capture_output=True, text=True)
+        if result.returncode != 0:
+            failures += 1
+            print('FAILED ' + module)
+            print(result.stdout + result.stderr)
+
+    print('%d dot files, %d modules, %d invalid' % (files, len(modules), failures))
+    return 1 if failures != 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())